@@ -92,6 +92,49 @@ void CompactorStack::AddWithWeight(int64_t value, int weight) {
     }
 }
 
+void CompactorStack::AddBatch(const std::vector<int64_t>& values) {
+    if (sampler_ != nullptr) {
+        for (const int64_t value : values) {
+            sampler_->Add(value);
+        }
+        return;
+    }
+    compactors_[0].insert(compactors_[0].end(), values.begin(), values.end());
+    num_items_in_compactors_ += static_cast<int>(values.size());
+    CompactStack();
+}
+
+void CompactorStack::Merge(const CompactorStack& other) {
+    if (&other == this) {
+        return;
+    }
+    while (compactors_.size() < other.compactors_.size()) {
+        AddLevel();
+    }
+
+    // Levels below lowest_active_level() are replaced by the sampler, so their
+    // items are added with their weight once the compactors have been merged.
+    const int lowest_level = lowest_active_level();
+    for (size_t h = lowest_level; h < other.compactors_.size(); h++) {
+        const std::vector<int64_t>& other_compactor = other.compactors_[h];
+        compactors_[h].insert(compactors_[h].end(), other_compactor.begin(),
+                              other_compactor.end());
+        num_items_in_compactors_ += static_cast<int>(other_compactor.size());
+    }
+    CompactStack();
+
+    for (int h = 0; h < lowest_level && h < static_cast<int>(other.compactors_.size()); h++) {
+        for (const int64_t value : other.compactors_[h]) {
+            AddWithWeight(value, 1 << h);
+        }
+    }
+    const auto other_sampled_item_and_weight = other.sampled_item_and_weight();
+    if (other_sampled_item_and_weight.has_value()) {
+        AddWithWeight(other_sampled_item_and_weight->first,
+                      static_cast<int>(other_sampled_item_and_weight->second));
+    }
+}
+
 void CompactorStack::SortCompactorContents() {
     for (std::vector<int64_t>& compactor : compactors_) {
         std::sort(compactor.begin(), compactor.end());
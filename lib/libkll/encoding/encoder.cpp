@@ -15,6 +15,7 @@
  */
 #include "encoder.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -56,10 +57,31 @@ void Encoder::AppendToString(const int64_t src, std::string* dst) {
 void Encoder::SerializeToPackedStringAll(std::vector<int64_t>::const_iterator begin,
                                          std::vector<int64_t>::const_iterator end,
                                          std::string* dst) {
-    dst->clear();
+    // Encode into dst directly, sized for the worst case, instead of appending
+    // the items one by one.
+    dst->resize(static_cast<size_t>(end - begin) * kMaxLength);
+    Encoder enc(dst->data(), dst->size());
     for (; begin != end; ++begin) {
-        Encoder::AppendToString(*begin, dst);
+        enc.put_varint64(static_cast<uint64_t>(*begin));
     }
+    dst->resize(enc.length());
+}
+
+void Encoder::SerializeToDiffEncodedPackedStringAll(std::vector<int64_t>::const_iterator begin,
+                                                    std::vector<int64_t>::const_iterator end,
+                                                    std::string* dst) {
+    assert(std::is_sorted(begin, end));
+    dst->resize(static_cast<size_t>(end - begin) * kMaxLength);
+    Encoder enc(dst->data(), dst->size());
+    // The first value is encoded as a difference to 0. Differences are computed
+    // on uint64s, so that they do not overflow for values of opposite signs.
+    uint64_t previous = 0;
+    for (; begin != end; ++begin) {
+        const uint64_t value = static_cast<uint64_t>(*begin);
+        enc.put_varint64(value - previous);
+        previous = value;
+    }
+    dst->resize(enc.length());
 }
 
 }  // namespace encoding
@@ -35,6 +35,15 @@ public:
                                            std::vector<int64_t>::const_iterator end,
                                            std::string* dst);
 
+    // Encodes values that are sorted in ascending order as the first value,
+    // followed by the (non-negative) differences between consecutive values,
+    // each as a varint. For dense compactors, most differences fit in one or
+    // two bytes, whereas the values themselves, in particular negative ones,
+    // take up to kMaxLength bytes.
+    static void SerializeToDiffEncodedPackedStringAll(std::vector<int64_t>::const_iterator begin,
+                                                      std::vector<int64_t>::const_iterator end,
+                                                      std::string* dst);
+
 private:
     // Max number of bytes needed to encode 64 bits as a varint (= ceil(64 / 7)).
     static const int8_t kMaxLength = 10;
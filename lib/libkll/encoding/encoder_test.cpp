@@ -136,6 +136,60 @@ TEST(EncoderTest, SerializeToPackedStringAllClearsPrepopulatedString) {
     EXPECT_EQ(empty, prepopulated);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// ------------ Tests for SerializeToDiffEncodedPackedStringAll ------------- //
+
+class DiffEncodedSerializationTest : public ::testing::TestWithParam<PackedEncodingTupleParam> {};
+
+TEST_P(DiffEncodedSerializationTest, CorrectDiffEncoding) {
+    PackedEncodingTupleParam params = GetParam();
+    std::string packed;
+
+    Encoder::SerializeToDiffEncodedPackedStringAll(params.values.begin(), params.values.end(),
+                                                   &packed);
+    std::string_view expected(params.encoding, params.encoding_length);
+    EXPECT_EQ(packed, expected);
+    EXPECT_EQ(packed.length(), params.encoding_length);
+}
+
+const PackedEncodingTupleParam diffEncodedCases[] = {
+        {{}, "", 0},
+        // Encoding one item should be identical to AppendToString.
+        {{0x0LL}, "\0", 1},
+        {{0x80LL}, "\x80\x01", 2},
+        {{-0x01LL}, "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01", 10},
+        // Deltas to the previous item.
+        {{0x80LL, 0x100LL}, "\x80\x01\x80\x01", 4},
+        {{0x80LL, 0x80LL}, "\x80\x01\0", 3},
+        {{-0x01LL, 0x0LL, 0x1LL}, "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01\x01\x01", 12},
+        {{std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()},
+         "\x80\x80\x80\x80\x80\x80\x80\x80\x80\x01\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01",
+         20},
+        {{1, 2, 3, 4, 5, 6, 7, 8, 9, 0xA, 0xB}, "\x1\x1\x1\x1\x1\x1\x1\x1\x1\x1\x1", 11}};
+
+INSTANTIATE_TEST_SUITE_P(DiffEncodedSerializationTestCases, DiffEncodedSerializationTest,
+                         ::testing::ValuesIn(diffEncodedCases));
+
+TEST(EncoderTest, SerializeToDiffEncodedPackedStringAllClearsPrepopulatedString) {
+    std::string prepopulated = "some leftovers";
+    std::vector<int64_t> v = {1, 2, 3};
+    Encoder::SerializeToDiffEncodedPackedStringAll(v.begin(), v.end(), &prepopulated);
+    EXPECT_EQ(prepopulated, "\x1\x1\x1");
+}
+
+TEST(EncoderTest, DiffEncodingIsSmallerForDenseNegativeValues) {
+    std::vector<int64_t> v;
+    for (int64_t i = -1000; i < 0; i++) {
+        v.push_back(i);
+    }
+    std::string packed;
+    std::string diffEncoded;
+    Encoder::SerializeToPackedStringAll(v.begin(), v.end(), &packed);
+    Encoder::SerializeToDiffEncodedPackedStringAll(v.begin(), v.end(), &diffEncoded);
+    EXPECT_EQ(packed.length(), 10000);
+    EXPECT_EQ(diffEncoded.length(), 10 + 999);
+}
+
 }  // namespace
 
 }  // namespace encoding
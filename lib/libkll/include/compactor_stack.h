@@ -50,6 +50,15 @@ public:
     // Does nothing if weight <= 0.
     void AddWithWeight(int64_t value, int weight);
 
+    // Adds all values to the compactor stack, compacting it only once after all
+    // values have been added.
+    void AddBatch(const std::vector<int64_t>& values);
+
+    // Adds the items held by other to this compactor stack. Items of compactor
+    // level h keep their weight of 2^h; items at levels that this stack has
+    // already replaced with its sampler are added to the sampler instead.
+    void Merge(const CompactorStack& other);
+
     // Ensures that the contents of each compactor are sorted.
     void SortCompactorContents();
 
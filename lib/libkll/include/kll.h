@@ -65,6 +65,19 @@ public:
     // downscaling and randomized rounding is negligible.
     void AddWeighted(int64_t value, int weight);
 
+    // Adds all values to the aggregator. Has the same error guarantees as calling
+    // Add() for each value, though the resulting sketch may differ since the
+    // compactor stack is only compacted once per batch, which sorts each overfull
+    // compactor once instead of once per value that fills it.
+    void AddBatch(const std::vector<int64_t>& values);
+
+    // Merges the values aggregated by other into this aggregator, e.g. to
+    // combine sketches of the same dimension from partial buckets. Both
+    // aggregators should use the same k; the approximation guarantee of the
+    // result is that of the aggregator with the smaller k. Does nothing if
+    // other is this aggregator.
+    void Merge(const KllQuantile& other);
+
     // Not safe to be called concurrently.
     zetasketch::android::AggregatorStateProto SerializeToProto();
 
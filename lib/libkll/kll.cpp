@@ -16,8 +16,10 @@
 
 #include "kll.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "aggregator.pb.h"
 #include "compactor_stack.h"
@@ -61,6 +63,27 @@ void KllQuantile::AddWeighted(int64_t value, int weight) {
     }
 }
 
+void KllQuantile::AddBatch(const std::vector<int64_t>& values) {
+    if (values.empty()) {
+        return;
+    }
+    compactor_stack_.AddBatch(values);
+    const auto [min_it, max_it] = std::minmax_element(values.begin(), values.end());
+    UpdateMin(*min_it);
+    UpdateMax(*max_it);
+    num_values_ += values.size();
+}
+
+void KllQuantile::Merge(const KllQuantile& other) {
+    if (&other == this || other.num_values_ == 0) {
+        return;
+    }
+    compactor_stack_.Merge(other.compactor_stack_);
+    UpdateMin(other.min_);
+    UpdateMax(other.max_);
+    num_values_ += other.num_values_;
+}
+
 AggregatorStateProto KllQuantile::SerializeToProto() {
     AggregatorStateProto aggregator_state;
 
@@ -92,11 +115,12 @@ AggregatorStateProto KllQuantile::SerializeToProto() {
     quantile_state->mutable_compactors()->Reserve(compactors.size());
 
     for (const auto& compactor : compactors) {
-        encoding::Encoder::SerializeToPackedStringAll(
+        // Compactors are sorted, so the deltas between their items are small.
+        encoding::Encoder::SerializeToDiffEncodedPackedStringAll(
                 compactor.begin(), compactor.end(),
                 quantile_state
                         ->add_compactors()  // Adds one compactor to the compactors field.
-                        ->mutable_packed_values());
+                        ->mutable_diff_encoded_packed_values());
     }
 
     // Encode sampler.
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "compactor_stack.h"
+#include "kll-quantiles.pb.h"
+#include "kll.h"
+#include "random_generator.h"
+
+namespace dist_proc {
+namespace aggregation {
+
+namespace {
+
+using internal::CompactorStack;
+using zetasketch::android::AggregatorStateProto;
+using zetasketch::android::kll_quantiles_state;
+using zetasketch::android::KllQuantilesStateProto;
+
+// Total weight of all items held by the compactor stack. Compaction does not
+// preserve the weight exactly, so it only approximates the number of added items.
+int64_t TotalWeight(const CompactorStack& compactor_stack) {
+    int64_t weight = 0;
+    const std::vector<std::vector<int64_t>>& compactors = compactor_stack.compactors();
+    for (size_t h = 0; h < compactors.size(); h++) {
+        weight += static_cast<int64_t>(compactors[h].size()) << h;
+    }
+    const auto sampled_item_and_weight = compactor_stack.sampled_item_and_weight();
+    if (sampled_item_and_weight.has_value()) {
+        weight += sampled_item_and_weight->second;
+    }
+    return weight;
+}
+
+// Estimated number of items that are <= value, where each item of compactor
+// level h stands for 2^h items.
+int64_t EstimatedRank(const CompactorStack& compactor_stack, int64_t value) {
+    int64_t rank = 0;
+    const std::vector<std::vector<int64_t>>& compactors = compactor_stack.compactors();
+    for (size_t h = 0; h < compactors.size(); h++) {
+        for (const int64_t item : compactors[h]) {
+            if (item <= value) {
+                rank += int64_t{1} << h;
+            }
+        }
+    }
+    const auto sampled_item_and_weight = compactor_stack.sampled_item_and_weight();
+    if (sampled_item_and_weight.has_value() && sampled_item_and_weight->first <= value) {
+        rank += sampled_item_and_weight->second;
+    }
+    return rank;
+}
+
+// Returns the largest rank error over the deciles of the values 0..num_values-1, relative to
+// num_values.
+double MaxDecileRankError(const CompactorStack& compactor_stack, int64_t num_values) {
+    double max_error = 0;
+    for (int decile = 1; decile < 10; decile++) {
+        const int64_t value = num_values * decile / 10;
+        const int64_t true_rank = value + 1;
+        const int64_t error = std::abs(EstimatedRank(compactor_stack, value) - true_rank);
+        max_error = std::max(max_error, static_cast<double>(error) / num_values);
+    }
+    return max_error;
+}
+
+std::vector<int64_t> ShuffledValues(int64_t begin, int64_t end, uint64_t seed) {
+    std::vector<int64_t> values;
+    for (int64_t value = begin; value < end; value++) {
+        values.push_back(value);
+    }
+    std::shuffle(values.begin(), values.end(), std::mt19937(seed));
+    return values;
+}
+
+// The approximation error at inv_eps = 100 is 1%. The errors checked below
+// have a lot of headroom to keep the tests deterministic in practice.
+const int64_t kInvEps = 100;
+const int64_t kInvDelta = 1000;
+const double kMaxRankError = 0.05;
+// Stacks with k = 8 switch to the sampler early, at the cost of precision.
+const int kSmallK = 8;
+const double kMaxSmallKError = 0.25;
+
+TEST(CompactorStackBatchTest, AddBatchIsAccurate) {
+    MTRandomGenerator random(1);
+    CompactorStack compactor_stack(kInvEps, kInvDelta, &random);
+    const int64_t num_values = 100000;
+    const std::vector<int64_t> values = ShuffledValues(0, num_values, 1);
+    for (size_t i = 0; i < values.size(); i += 1000) {
+        compactor_stack.AddBatch(
+                std::vector<int64_t>(values.begin() + i, values.begin() + i + 1000));
+    }
+
+    EXPECT_NEAR(TotalWeight(compactor_stack), num_values, num_values * kMaxRankError);
+    EXPECT_LT(compactor_stack.num_stored_items(), 2000);
+    EXPECT_LE(MaxDecileRankError(compactor_stack, num_values), kMaxRankError);
+}
+
+TEST(CompactorStackBatchTest, AddBatchWithSampler) {
+    MTRandomGenerator random(2);
+    CompactorStack compactor_stack(kInvEps, kInvDelta, /*k=*/kSmallK, &random);
+    const int64_t num_values = 100000;
+    const std::vector<int64_t> values = ShuffledValues(0, num_values, 2);
+    for (size_t i = 0; i < values.size(); i += 100) {
+        compactor_stack.AddBatch(
+                std::vector<int64_t>(values.begin() + i, values.begin() + i + 100));
+    }
+
+    EXPECT_TRUE(compactor_stack.IsSamplerOn());
+    EXPECT_NEAR(TotalWeight(compactor_stack), num_values, num_values * kMaxSmallKError);
+}
+
+TEST(CompactorStackBatchTest, EmptyBatch) {
+    MTRandomGenerator random(3);
+    CompactorStack compactor_stack(kInvEps, kInvDelta, &random);
+    compactor_stack.AddBatch({});
+
+    EXPECT_EQ(compactor_stack.num_stored_items(), 0);
+}
+
+TEST(CompactorStackMergeTest, MergeIsAccurate) {
+    MTRandomGenerator random(4);
+    CompactorStack compactor_stack(kInvEps, kInvDelta, &random);
+    CompactorStack other(kInvEps, kInvDelta, &random);
+    for (int64_t value = 0; value < 50000; value++) {
+        compactor_stack.Add(value);
+    }
+    for (int64_t value = 50000; value < 100000; value++) {
+        other.Add(value);
+    }
+    compactor_stack.Merge(other);
+
+    EXPECT_NEAR(TotalWeight(compactor_stack), 100000, 100000 * kMaxRankError);
+    EXPECT_LE(MaxDecileRankError(compactor_stack, 100000), kMaxRankError);
+}
+
+TEST(CompactorStackMergeTest, MergeStacksOfDifferentHeights) {
+    MTRandomGenerator random(5);
+    CompactorStack compactor_stack(kInvEps, kInvDelta, &random);
+    CompactorStack other(kInvEps, kInvDelta, &random);
+    for (int64_t value = 0; value < 100; value++) {
+        compactor_stack.Add(value);
+    }
+    for (int64_t value = 100; value < 100000; value++) {
+        other.Add(value);
+    }
+    compactor_stack.Merge(other);
+
+    EXPECT_NEAR(TotalWeight(compactor_stack), 100000, 100000 * kMaxRankError);
+    EXPECT_GE(compactor_stack.compactors().size(), other.compactors().size());
+    EXPECT_LE(MaxDecileRankError(compactor_stack, 100000), kMaxRankError);
+}
+
+TEST(CompactorStackMergeTest, MergeWithSamplers) {
+    MTRandomGenerator random(6);
+    CompactorStack compactor_stack(kInvEps, kInvDelta, /*k=*/kSmallK, &random);
+    CompactorStack other(kInvEps, kInvDelta, /*k=*/kSmallK, &random);
+    for (int64_t value = 0; value < 1000; value++) {
+        compactor_stack.Add(value);
+    }
+    for (int64_t value = 1000; value < 100000; value++) {
+        other.Add(value);
+    }
+    ASSERT_TRUE(other.IsSamplerOn());
+    ASSERT_LT(compactor_stack.lowest_active_level(), other.lowest_active_level());
+    compactor_stack.Merge(other);
+
+    EXPECT_NEAR(TotalWeight(compactor_stack), 100000, 100000 * kMaxSmallKError);
+}
+
+TEST(CompactorStackMergeTest, MergeIntoItselfDoesNothing) {
+    MTRandomGenerator random(7);
+    CompactorStack compactor_stack(kInvEps, kInvDelta, &random);
+    for (int64_t value = 0; value < 1000; value++) {
+        compactor_stack.Add(value);
+    }
+    const std::vector<std::vector<int64_t>> compactors = compactor_stack.compactors();
+    compactor_stack.Merge(compactor_stack);
+
+    EXPECT_EQ(compactor_stack.compactors(), compactors);
+}
+
+TEST(KllQuantileMergeTest, AddBatchMatchesAdd) {
+    std::unique_ptr<KllQuantile> batched = KllQuantile::Create();
+    std::unique_ptr<KllQuantile> single = KllQuantile::Create();
+    const std::vector<int64_t> values = ShuffledValues(-500, 500, 8);
+    batched->AddBatch(values);
+    for (const int64_t value : values) {
+        single->Add(value);
+    }
+
+    EXPECT_EQ(batched->num_values(), single->num_values());
+    // Neither aggregator has compacted yet, so both hold every value.
+    EXPECT_EQ(batched->num_stored_values(), single->num_stored_values());
+
+    const AggregatorStateProto batched_proto = batched->SerializeToProto();
+    const KllQuantilesStateProto& batched_state =
+            batched_proto.GetExtension(kll_quantiles_state);
+    const AggregatorStateProto single_proto = single->SerializeToProto();
+    const KllQuantilesStateProto& single_state =
+            single_proto.GetExtension(kll_quantiles_state);
+    EXPECT_EQ(batched_state.min(), single_state.min());
+    EXPECT_EQ(batched_state.max(), single_state.max());
+    ASSERT_EQ(batched_state.compactors_size(), single_state.compactors_size());
+    EXPECT_EQ(batched_state.compactors(0).diff_encoded_packed_values(),
+              single_state.compactors(0).diff_encoded_packed_values());
+}
+
+TEST(KllQuantileMergeTest, MergeUpdatesNumValuesMinAndMax) {
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+    std::unique_ptr<KllQuantile> other = KllQuantile::Create();
+    std::unique_ptr<KllQuantile> expected = KllQuantile::Create();
+    for (int64_t value = 0; value < 10; value++) {
+        aggregator->Add(value);
+        expected->Add(value);
+    }
+    for (int64_t value = -5; value < 20; value++) {
+        other->Add(value);
+        expected->Add(value);
+    }
+    aggregator->Merge(*other);
+
+    EXPECT_EQ(aggregator->num_values(), 35);
+    const AggregatorStateProto aggregator_proto = aggregator->SerializeToProto();
+    const KllQuantilesStateProto& state =
+            aggregator_proto.GetExtension(kll_quantiles_state);
+    const AggregatorStateProto expected_proto = expected->SerializeToProto();
+    const KllQuantilesStateProto& expected_state =
+            expected_proto.GetExtension(kll_quantiles_state);
+    EXPECT_EQ(state.min(), expected_state.min());
+    EXPECT_EQ(state.max(), expected_state.max());
+}
+
+TEST(KllQuantileMergeTest, MergeEmpty) {
+    std::unique_ptr<KllQuantile> aggregator = KllQuantile::Create();
+    std::unique_ptr<KllQuantile> empty = KllQuantile::Create();
+    aggregator->Merge(*empty);
+    EXPECT_EQ(aggregator->num_values(), 0);
+
+    empty->Add(7);
+    aggregator->Merge(*empty);
+    EXPECT_EQ(aggregator->num_values(), 1);
+    const AggregatorStateProto aggregator_proto = aggregator->SerializeToProto();
+    const KllQuantilesStateProto& state =
+            aggregator_proto.GetExtension(kll_quantiles_state);
+    EXPECT_EQ(state.min(), "\x7");
+    EXPECT_EQ(state.max(), "\x7");
+}
+
+}  // namespace
+
+}  // namespace aggregation
+}  // namespace dist_proc
@@ -78,8 +78,8 @@ TEST(KllQuantileSerializationTest, QuantilesProtoFieldsAreCorrectlyPopulated) {
     // Compactors
     EXPECT_EQ(quantiles_state.compactors_size(), 1);
     const KllQuantilesStateProto::Compactor& compactor = quantiles_state.compactors(0);
-    ASSERT_TRUE(compactor.has_packed_values());
-    EXPECT_EQ(compactor.packed_values(), "\x1\x2\x3\x4\x5\x6\x7\x8\x9\xA");
+    ASSERT_TRUE(compactor.has_diff_encoded_packed_values());
+    EXPECT_EQ(compactor.diff_encoded_packed_values(), "\x1\x1\x1\x1\x1\x1\x1\x1\x1\x1");
 
     ASSERT_FALSE(quantiles_state.has_sampler());
 }
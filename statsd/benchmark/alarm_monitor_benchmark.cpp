@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <vector>
+
+#include "anomaly/AlarmMonitor.h"
+#include "anomaly/indexed_priority_queue.h"
+#include "benchmark/benchmark.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+namespace {
+
+const uint32_t kBaseTimeSec = 1700000000;
+
+// Alarm times of durations that are projected to exceed their threshold within the next hour.
+vector<sp<const InternalAlarm>> createAlarms(int numAlarms) {
+    vector<sp<const InternalAlarm>> alarms;
+    uint32_t seed = 1;
+    for (int i = 0; i < numAlarms; i++) {
+        seed = seed * 1103515245 + 12345;
+        alarms.push_back(new InternalAlarm{kBaseTimeSec + 1 + (seed >> 8) % 3600});
+    }
+    return alarms;
+}
+
+}  // namespace
+
+// Replaces the alarm of one of numAlarms concurrently started durations, as
+// DurationAnomalyTracker::startAlarm does whenever a duration is restarted.
+static void BM_AlarmMonitorChurn(benchmark::State& state) {
+    sp<AlarmMonitor> alarmMonitor =
+            new AlarmMonitor(/*minDiffToUpdateRegisteredAlarmTimeSec=*/5,
+                             [](const shared_ptr<IStatsCompanionService>&, int64_t) {},
+                             [](const shared_ptr<IStatsCompanionService>&) {});
+    vector<sp<const InternalAlarm>> alarms = createAlarms(state.range(0));
+    const vector<sp<const InternalAlarm>> replacements = createAlarms(state.range(0));
+    for (const sp<const InternalAlarm>& alarm : alarms) {
+        alarmMonitor->add(alarm);
+    }
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        alarmMonitor->remove(alarms[i]);
+        alarms[i] = new InternalAlarm{replacements[i]->timestampSec};
+        alarmMonitor->add(alarms[i]);
+        i = (i + 1) % alarms.size();
+    }
+}
+BENCHMARK(BM_AlarmMonitorChurn)->Arg(100)->Arg(1000)->Arg(10000);
+
+// Removes the alarms of numAlarms durations in the order they are due, as happens when the
+// durations stop before their alarms fire. Each removal looks up the new soonest alarm.
+static void BM_AlarmMonitorRemoveSoonest(benchmark::State& state) {
+    sp<AlarmMonitor> alarmMonitor =
+            new AlarmMonitor(/*minDiffToUpdateRegisteredAlarmTimeSec=*/5,
+                             [](const shared_ptr<IStatsCompanionService>&, int64_t) {},
+                             [](const shared_ptr<IStatsCompanionService>&) {});
+    vector<sp<const InternalAlarm>> alarms = createAlarms(state.range(0));
+    std::sort(alarms.begin(), alarms.end(),
+              [](const sp<const InternalAlarm>& a, const sp<const InternalAlarm>& b) {
+                  return a->timestampSec < b->timestampSec;
+              });
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (const sp<const InternalAlarm>& alarm : alarms) {
+            alarmMonitor->add(alarm);
+        }
+        state.ResumeTiming();
+        for (const sp<const InternalAlarm>& alarm : alarms) {
+            alarmMonitor->remove(alarm);
+        }
+    }
+}
+BENCHMARK(BM_AlarmMonitorRemoveSoonest)->Arg(1000)->Arg(10000);
+
+// Same churn on the indexed priority queue that used to back AlarmMonitor, for comparison.
+static void BM_IndexedPriorityQueueChurn(benchmark::State& state) {
+    indexed_priority_queue<InternalAlarm, InternalAlarm::SmallerTimestamp> pq;
+    vector<sp<const InternalAlarm>> alarms = createAlarms(state.range(0));
+    const vector<sp<const InternalAlarm>> replacements = createAlarms(state.range(0));
+    for (const sp<const InternalAlarm>& alarm : alarms) {
+        pq.push(alarm);
+    }
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        pq.remove(alarms[i]);
+        alarms[i] = new InternalAlarm{replacements[i]->timestampSec};
+        pq.push(alarms[i]);
+        benchmark::DoNotOptimize(pq.top());
+        i = (i + 1) % alarms.size();
+    }
+}
+BENCHMARK(BM_IndexedPriorityQueueChurn)->Arg(100)->Arg(1000)->Arg(10000);
+
+// Fires all alarms of numAlarms durations, one second at a time.
+static void BM_AlarmMonitorPopSoonerThan(benchmark::State& state) {
+    sp<AlarmMonitor> alarmMonitor =
+            new AlarmMonitor(/*minDiffToUpdateRegisteredAlarmTimeSec=*/5,
+                             [](const shared_ptr<IStatsCompanionService>&, int64_t) {},
+                             [](const shared_ptr<IStatsCompanionService>&) {});
+    const vector<sp<const InternalAlarm>> alarms = createAlarms(state.range(0));
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (const sp<const InternalAlarm>& alarm : alarms) {
+            alarmMonitor->add(alarm);
+        }
+        state.ResumeTiming();
+        for (uint32_t timeSec = kBaseTimeSec; timeSec <= kBaseTimeSec + 3600; timeSec++) {
+            benchmark::DoNotOptimize(alarmMonitor->popSoonerThan(timeSec));
+        }
+    }
+}
+BENCHMARK(BM_AlarmMonitorPopSoonerThan)->Arg(1000)->Arg(10000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
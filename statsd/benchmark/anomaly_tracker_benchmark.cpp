@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <vector>
+
+#include "anomaly/AnomalyTracker.h"
+#include "benchmark/benchmark.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+namespace {
+
+const ConfigKey kConfigKey(0, 12345);
+const int kNumBuckets = 10;
+
+vector<MetricDimensionKey> createDimensionKeys(int numDimensions) {
+    vector<MetricDimensionKey> keys;
+    int pos[] = {1, 0, 0};
+    for (int i = 0; i < numDimensions; i++) {
+        HashableDimensionKey dim;
+        dim.addValue(FieldValue(Field(1, pos, 0), Value(10000 + i)));
+        keys.push_back(MetricDimensionKey(dim, DEFAULT_DIMENSION_KEY));
+    }
+    return keys;
+}
+
+std::shared_ptr<DimToValMap> createBucket(const vector<MetricDimensionKey>& keys) {
+    std::shared_ptr<DimToValMap> bucket = std::make_shared<DimToValMap>();
+    for (size_t i = 0; i < keys.size(); i++) {
+        (*bucket)[keys[i]] = 1 + i % 5;
+    }
+    return bucket;
+}
+
+Alert createBenchmarkAlert() {
+    Alert alert;
+    alert.set_id(1);
+    alert.set_metric_id(1);
+    alert.set_num_buckets(kNumBuckets);
+    // High enough that no anomaly is ever declared.
+    alert.set_trigger_if_sum_gt(1000000);
+    return alert;
+}
+
+}  // namespace
+
+// Checks every dimension against the sum of its past buckets, as a sliced count metric does on
+// each event of a bucket.
+static void BM_AnomalyTrackerDetectAndDeclareAnomaly(benchmark::State& state) {
+    const vector<MetricDimensionKey> keys = createDimensionKeys(state.range(0));
+    sp<AnomalyTracker> tracker = new AnomalyTracker(createBenchmarkAlert(), kConfigKey);
+    for (int bucketNum = 0; bucketNum < kNumBuckets - 1; bucketNum++) {
+        tracker->addPastBucket(createBucket(keys), bucketNum);
+    }
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        tracker->detectAndDeclareAnomaly(/*timestampNs=*/1, /*currBucketNum=*/kNumBuckets - 1,
+                                         /*metricId=*/1, keys[i], /*currentBucketValue=*/1);
+        i = (i + 1) % keys.size();
+    }
+}
+BENCHMARK(BM_AnomalyTrackerDetectAndDeclareAnomaly)->Arg(1000)->Arg(10000);
+
+// Rolls a full bucket of every dimension into the past buckets, evicting the oldest one.
+static void BM_AnomalyTrackerAddPastBucket(benchmark::State& state) {
+    const vector<MetricDimensionKey> keys = createDimensionKeys(state.range(0));
+    sp<AnomalyTracker> tracker = new AnomalyTracker(createBenchmarkAlert(), kConfigKey);
+    int64_t bucketNum = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        std::shared_ptr<DimToValMap> bucket = createBucket(keys);
+        state.ResumeTiming();
+        tracker->addPastBucket(bucket, bucketNum++);
+    }
+}
+BENCHMARK(BM_AnomalyTrackerAddPastBucket)->Arg(1000)->Arg(10000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "matchers/matcher_util.h"
+#include "metric_util.h"
+#include "metrics/parsing_utils/metrics_manager_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::string;
+using std::to_string;
+using std::unordered_map;
+using std::vector;
+
+namespace {
+
+const int32_t kTagId = 123;
+const int kFieldId = 1;
+const int kNumValues = 64;
+
+AtomMatcher createIntEqAtomMatcher(const string& name, const int32_t value) {
+    AtomMatcher matcher = CreateSimpleAtomMatcher(name, kTagId);
+    FieldValueMatcher* fieldValueMatcher =
+            matcher.mutable_simple_atom_matcher()->add_field_value_matcher();
+    fieldValueMatcher->set_field(kFieldId);
+    fieldValueMatcher->set_eq_int(value);
+    return matcher;
+}
+
+AtomMatcher createCombinationAtomMatcher(const string& name, const LogicalOperation operation,
+                                         const vector<string>& children) {
+    AtomMatcher matcher;
+    matcher.set_id(StringToId(name));
+    matcher.mutable_combination()->set_operation(operation);
+    for (const string& child : children) {
+        matcher.mutable_combination()->add_matcher(StringToId(child));
+    }
+    return matcher;
+}
+
+// One simple matcher per value of the first field, as in the LogEntryMatcher tests, and layers of
+// combination matchers over them: OR of pairs, AND of pairs of ORs, and the NOT of each AND.
+StatsdConfig createBenchmarkConfig() {
+    StatsdConfig config;
+    for (int i = 0; i < kNumValues; i++) {
+        *config.add_atom_matcher() = createIntEqAtomMatcher("Eq" + to_string(i), i);
+    }
+    for (int i = 0; i < kNumValues; i += 2) {
+        *config.add_atom_matcher() =
+                createCombinationAtomMatcher("Or" + to_string(i), LogicalOperation::OR,
+                                             {"Eq" + to_string(i), "Eq" + to_string(i + 1)});
+    }
+    for (int i = 0; i < kNumValues; i += 4) {
+        *config.add_atom_matcher() =
+                createCombinationAtomMatcher("And" + to_string(i), LogicalOperation::AND,
+                                             {"Or" + to_string(i), "Or" + to_string(i + 2)});
+        *config.add_atom_matcher() = createCombinationAtomMatcher(
+                "NotAnd" + to_string(i), LogicalOperation::NOT, {"And" + to_string(i)});
+    }
+    return config;
+}
+
+std::unique_ptr<LogEvent> createIntLogEvent(const int32_t value) {
+    AStatsEvent* statsEvent = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(statsEvent, kTagId);
+    AStatsEvent_overwriteTimestamp(statsEvent, 1000);
+    AStatsEvent_writeInt32(statsEvent, value);
+    std::unique_ptr<LogEvent> logEvent = std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0);
+    parseStatsEventToLogEvent(statsEvent, logEvent.get());
+    return logEvent;
+}
+
+struct BenchmarkMatchers {
+    vector<sp<AtomMatchingTracker>> allAtomMatchingTrackers;
+    unordered_map<int, vector<int>> tagIdsToMatchersMap;
+    vector<std::unique_ptr<LogEvent>> events;
+};
+
+BenchmarkMatchers createBenchmarkMatchers() {
+    BenchmarkMatchers matchers;
+    unordered_map<int64_t, int> atomMatchingTrackerMap;
+    initAtomMatchingTrackers(createBenchmarkConfig(), new UidMap(), atomMatchingTrackerMap,
+                             matchers.allAtomMatchingTrackers, matchers.tagIdsToMatchersMap);
+    for (int i = 0; i < kNumValues; i++) {
+        matchers.events.push_back(createIntLogEvent(i));
+    }
+    return matchers;
+}
+
+}  // namespace
+
+// Evaluates the matchers of an event as MetricsManager used to: each matcher of the atom
+// recursively evaluates its children through the shared matcher cache.
+static void BM_AtomMatchersRecursive(benchmark::State& state) {
+    const BenchmarkMatchers matchers = createBenchmarkMatchers();
+    const vector<int>& matcherIndices = matchers.tagIdsToMatchersMap.at(kTagId);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        vector<MatchingState> matcherCache(matchers.allAtomMatchingTrackers.size(),
+                                           MatchingState::kNotComputed);
+        for (const int matcherIndex : matcherIndices) {
+            matchers.allAtomMatchingTrackers[matcherIndex]->onLogEvent(
+                    *matchers.events[i], matchers.allAtomMatchingTrackers, matcherCache);
+        }
+        benchmark::DoNotOptimize(matcherCache.data());
+        i = (i + 1) % matchers.events.size();
+    }
+}
+BENCHMARK(BM_AtomMatchersRecursive);
+
+// Evaluates the matchers of an event through the compiled AtomMatcherEvaluationPlan.
+static void BM_AtomMatchersEvaluationPlan(benchmark::State& state) {
+    const BenchmarkMatchers matchers = createBenchmarkMatchers();
+    const AtomMatcherEvaluationPlan plan = createAtomMatcherEvaluationPlan(
+            matchers.tagIdsToMatchersMap.at(kTagId), matchers.allAtomMatchingTrackers);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        vector<MatchingState> matcherCache(matchers.allAtomMatchingTrackers.size(),
+                                           MatchingState::kNotComputed);
+        evaluateAtomMatchers(plan, *matchers.events[i], matchers.allAtomMatchingTrackers,
+                             matcherCache);
+        benchmark::DoNotOptimize(matcherCache.data());
+        i = (i + 1) % matchers.events.size();
+    }
+}
+BENCHMARK(BM_AtomMatchersEvaluationPlan);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
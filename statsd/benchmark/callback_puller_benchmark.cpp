@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <aidl/android/os/BnPullAtomCallback.h>
+#include <aidl/android/os/IPullAtomResultReceiver.h>
+#include <aidl/android/util/StatsEventParcel.h>
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "external/StatsCallbackPuller.h"
+#include "logd/LogEvent.h"
+#include "stats_event.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using aidl::android::os::BnPullAtomCallback;
+using aidl::android::os::IPullAtomResultReceiver;
+using aidl::android::util::StatsEventParcel;
+using ::ndk::SharedRefBase;
+using std::shared_ptr;
+using std::vector;
+using Status = ::ndk::ScopedAStatus;
+
+namespace {
+
+const int kPullAtomTag = 10000;
+const int kNumPulledEvents = 5000;
+
+vector<StatsEventParcel> createParcels(int numEvents) {
+    vector<StatsEventParcel> parcels;
+    for (int i = 0; i < numEvents; i++) {
+        AStatsEvent* event = AStatsEvent_obtain();
+        AStatsEvent_setAtomId(event, kPullAtomTag);
+        AStatsEvent_writeInt32(event, 10000 + i);
+        AStatsEvent_writeString(event, "DemoStringValue");
+        AStatsEvent_writeInt64(event, 3L * i);
+        AStatsEvent_writeInt64(event, 5L * i);
+        AStatsEvent_build(event);
+
+        size_t size;
+        uint8_t* buffer = AStatsEvent_getBuffer(event, &size);
+        StatsEventParcel parcel;
+        parcel.buffer.assign(buffer, buffer + size);
+        parcels.push_back(std::move(parcel));
+        AStatsEvent_release(event);
+    }
+    return parcels;
+}
+
+// Returns the same parcels on every pull. In process, the call is not oneway, so the result is
+// delivered before onPullAtom returns.
+class FakePullAtomCallback : public BnPullAtomCallback {
+public:
+    explicit FakePullAtomCallback(int numEvents) : mParcels(createParcels(numEvents)) {
+    }
+
+    Status onPullAtom(int atomTag,
+                      const shared_ptr<IPullAtomResultReceiver>& resultReceiver) override {
+        resultReceiver->pullFinished(atomTag, /*success=*/true, mParcels);
+        return Status::ok();
+    }
+
+private:
+    const vector<StatsEventParcel> mParcels;
+};
+
+}  // namespace
+
+// Parses the pulled parcels with one allocation per event, as was done before pulled events
+// were parsed into a single batch.
+static void BM_ParsePulledEventsPerEvent(benchmark::State& state) {
+    const vector<StatsEventParcel> parcels = createParcels(kNumPulledEvents);
+    while (state.KeepRunning()) {
+        vector<shared_ptr<LogEvent>> data;
+        for (const StatsEventParcel& parcel : parcels) {
+            shared_ptr<LogEvent> event = std::make_shared<LogEvent>(/*uid=*/-1, /*pid=*/-1);
+            if (event->parseBuffer((uint8_t*)parcel.buffer.data(), parcel.buffer.size())) {
+                data.push_back(event);
+            }
+        }
+        benchmark::DoNotOptimize(data);
+    }
+}
+BENCHMARK(BM_ParsePulledEventsPerEvent);
+
+static void BM_ParsePulledEventsBatch(benchmark::State& state) {
+    const vector<StatsEventParcel> parcels = createParcels(kNumPulledEvents);
+    while (state.KeepRunning()) {
+        vector<shared_ptr<LogEvent>> data;
+        parsePulledEvents(parcels, &data);
+        benchmark::DoNotOptimize(data);
+    }
+}
+BENCHMARK(BM_ParsePulledEventsBatch);
+
+// Pull through StatsPuller, including the cache and handing a copy of the data to the caller.
+static void BM_StatsCallbackPullerPull(benchmark::State& state) {
+    shared_ptr<FakePullAtomCallback> callback =
+            SharedRefBase::make<FakePullAtomCallback>(kNumPulledEvents);
+    sp<StatsCallbackPuller> puller =
+            new StatsCallbackPuller(kPullAtomTag, callback, /*coolDownNs=*/0,
+                                    /*timeoutNs=*/10 * NS_PER_SEC, /*additiveFields=*/{});
+    int64_t eventTimeNs = NS_PER_SEC;
+    while (state.KeepRunning()) {
+        vector<shared_ptr<LogEvent>> data;
+        puller->ForceClearCache();
+        puller->Pull(eventTimeNs++, &data);
+        benchmark::DoNotOptimize(data);
+    }
+}
+BENCHMARK(BM_StatsCallbackPullerPull);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -14,11 +14,17 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
+#include "android-base/stringprintf.h"
 #include "benchmark/benchmark.h"
 #include "metric_util.h"
+#include "metrics/RestrictedEventMetricProducer.h"
+#include "stats_annotations.h"
 #include "utils/DbUtils.h"
 
 using namespace std;
+using android::base::StringPrintf;
 
 namespace android {
 namespace os {
@@ -111,6 +117,139 @@ static void BM_createDbTables(benchmark::State& state) {
 }
 
 BENCHMARK(BM_createDbTables);
+
+static LogEvent createRestrictedLogEvent(int64_t timestampNs) {
+    AStatsEvent* statsEvent = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(statsEvent, 10);
+    AStatsEvent_addInt32Annotation(statsEvent, ASTATSLOG_ANNOTATION_ID_RESTRICTION_CATEGORY,
+                                   ASTATSLOG_RESTRICTION_CATEGORY_DIAGNOSTIC);
+    AStatsEvent_overwriteTimestamp(statsEvent, timestampNs);
+    AStatsEvent_writeInt32(statsEvent, 10);
+    AStatsEvent_writeString(statsEvent, "DemoStringValue");
+    AStatsEvent_writeInt64(statsEvent, timestampNs);
+    LogEvent logEvent(/*uid=*/0, /*pid=*/0);
+    parseStatsEventToLogEvent(statsEvent, &logEvent);
+    return logEvent;
+}
+
+// End to end flush of the events buffered by a restricted event metric into its table.
+static void BM_flushRestrictedData(benchmark::State& state) {
+    ConfigKey key = ConfigKey(111, 222);
+    EventMetric metric;
+    metric.set_id(1);
+    RestrictedEventMetricProducer producer(key, metric, /*conditionIndex=*/-1,
+                                           /*initialConditionCache=*/{}, new ConditionWizard(),
+                                           /*protoHash=*/0x1234567890, /*startTimeNs=*/0);
+    vector<LogEvent> logEvents;
+    for (int i = 0; i < state.range(0); ++i) {
+        logEvents.push_back(createRestrictedLogEvent(10000000000 + i));
+    }
+    for (auto s : state) {
+        state.PauseTiming();
+        for (const LogEvent& logEvent : logEvents) {
+            producer.onMatchedLogEvent(/*matcherIndex=*/1, logEvent);
+        }
+        state.ResumeTiming();
+        producer.flushRestrictedData();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    deleteDb(key);
+}
+
+BENCHMARK(BM_flushRestrictedData)->Arg(1)->Arg(10)->Arg(100)->Arg(500);
+
+// Rows per second inserted by flushes of the given number of buffered events.
+static void BM_insertRestrictedEventBuffer(benchmark::State& state) {
+    ConfigKey key = ConfigKey(111, 222);
+    int64_t metricId = 0;
+    RestrictedEventBuffer buffer;
+    for (int i = 0; i < state.range(0); ++i) {
+        buffer.append(createRestrictedLogEvent(10000000000 + i));
+    }
+    createTableIfNeeded(key, metricId, buffer);
+    string err;
+    for (auto s : state) {
+        insert(key, metricId, buffer, err);
+        state.PauseTiming();
+        deleteTable(key, metricId);
+        createTableIfNeeded(key, metricId, buffer);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    deleteDb(key);
+}
+
+BENCHMARK(BM_insertRestrictedEventBuffer)->Arg(1)->Arg(100)->Arg(10000);
+
+// Fills the metric table with numRows events, logged one nanosecond apart in wall clock time
+// starting from 0.
+static void fillTableByWallClock(const ConfigKey& key, const int64_t metricId,
+                                 const int64_t numRows) {
+    const int64_t rowsPerInsert = 10000;
+    for (int64_t firstRow = 0; firstRow < numRows; firstRow += rowsPerInsert) {
+        RestrictedEventBuffer buffer;
+        for (int64_t row = firstRow; row < std::min(numRows, firstRow + rowsPerInsert); ++row) {
+            LogEvent logEvent = createRestrictedLogEvent(10000000000 + row);
+            logEvent.setLogdWallClockTimestampNs(row);
+            buffer.append(logEvent);
+        }
+        if (firstRow == 0) {
+            createTableIfNeeded(key, metricId, buffer);
+        }
+        string err;
+        insert(key, metricId, buffer, err);
+    }
+}
+
+// Deletes the oldest 1000 events of a table through the ttl, and puts them back untimed.
+static void BM_enforceTtlOnLargeTable(benchmark::State& state) {
+    ConfigKey key = ConfigKey(111, 222);
+    int64_t metricId = 0;
+    deleteDb(key);
+    fillTableByWallClock(key, metricId, state.range(0));
+    const int64_t numExpiredRows = 1000;
+    RestrictedEventBuffer expiredEvents;
+    for (int64_t row = 0; row < numExpiredRows; ++row) {
+        LogEvent logEvent = createRestrictedLogEvent(10000000000 + row);
+        logEvent.setLogdWallClockTimestampNs(row);
+        expiredEvents.append(logEvent);
+    }
+    sqlite3* db = getDb(key);
+    string err;
+    for (auto s : state) {
+        flushTtl(db, metricId, /*ttlWallClockNs=*/numExpiredRows - 1);
+        state.PauseTiming();
+        insert(key, metricId, expiredEvents, err);
+        state.ResumeTiming();
+    }
+    closeDb(db);
+    deleteDb(key);
+}
+
+BENCHMARK(BM_enforceTtlOnLargeTable)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// Queries the events of a 1000ns wall clock window in the middle of a table.
+static void BM_queryTimeWindowOnLargeTable(benchmark::State& state) {
+    ConfigKey key = ConfigKey(111, 222);
+    int64_t metricId = 0;
+    deleteDb(key);
+    fillTableByWallClock(key, metricId, state.range(0));
+    const int64_t windowStartNs = state.range(0) / 2;
+    const string zSql = StringPrintf(
+            "SELECT * FROM metric_%s WHERE wallTimestampNs >= %lld AND wallTimestampNs < %lld",
+            reformatMetricId(metricId).c_str(), (long long)windowStartNs,
+            (long long)windowStartNs + 1000);
+    string err;
+    for (auto s : state) {
+        vector<vector<string>> rows;
+        vector<int32_t> columnTypes;
+        vector<string> columnNames;
+        query(key, zSql, rows, columnTypes, columnNames, err);
+    }
+    deleteDb(key);
+}
+
+BENCHMARK(BM_queryTimeWindowOnLargeTable)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMillisecond);
 }  // namespace dbutils
 }  // namespace statsd
 }  // namespace os
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+#include "HashableDimensionKey.h"
+#include "benchmark/benchmark.h"
+#include "guardrail/DimensionCardinalitySketch.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+namespace {
+
+vector<MetricDimensionKey> createDimensionKeys(int numDimensions) {
+    vector<MetricDimensionKey> keys;
+    int pos[] = {1, 0, 0};
+    for (int i = 0; i < numDimensions; i++) {
+        HashableDimensionKey dim;
+        dim.addValue(FieldValue(Field(1, pos, 0), Value(10000 + i)));
+        keys.push_back(MetricDimensionKey(dim, DEFAULT_DIMENSION_KEY));
+    }
+    return keys;
+}
+
+}  // namespace
+
+// Feeds one bucket of distinct dimension keys into the sketch, as the metric producers do for
+// every key that is new to their current bucket.
+static void BM_DimensionCardinalitySketchAdd(benchmark::State& state) {
+    const vector<MetricDimensionKey> keys = createDimensionKeys(state.range(0));
+    DimensionCardinalitySketch sketch;
+    while (state.KeepRunning()) {
+        sketch.clear();
+        for (const MetricDimensionKey& key : keys) {
+            sketch.add(std::hash<MetricDimensionKey>{}(key));
+        }
+        benchmark::DoNotOptimize(sketch.estimate());
+    }
+    state.counters["bytes"] = sizeof(sketch);
+}
+BENCHMARK(BM_DimensionCardinalitySketchAdd)->Arg(500)->Arg(3000)->Arg(100000);
+
+// Exact count of the same keys with a hash set, for comparison of time and memory.
+static void BM_DimensionCardinalityExactCount(benchmark::State& state) {
+    const vector<MetricDimensionKey> keys = createDimensionKeys(state.range(0));
+    size_t bytes = 0;
+    while (state.KeepRunning()) {
+        std::unordered_set<MetricDimensionKey> seen;
+        for (const MetricDimensionKey& key : keys) {
+            seen.insert(key);
+        }
+        benchmark::DoNotOptimize(seen.size());
+        bytes = seen.bucket_count() * sizeof(void*) +
+                seen.size() * (sizeof(MetricDimensionKey) + 2 * sizeof(void*));
+    }
+    // Lower bound: the values of the keys are held out of line and not accounted for.
+    state.counters["bytes"] = bytes;
+}
+BENCHMARK(BM_DimensionCardinalityExactCount)->Arg(500)->Arg(3000)->Arg(100000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -29,7 +29,7 @@ namespace statsd {
 
 using std::vector;
 
-static void createLogEventAndLink(LogEvent* event, Metric2Condition *link) {
+static void createLogEvent(LogEvent* event) {
     AStatsEvent* statsEvent = AStatsEvent_obtain();
     AStatsEvent_setAtomId(statsEvent, 1);
     AStatsEvent_overwriteTimestamp(statsEvent, 100000);
@@ -43,19 +43,40 @@ static void createLogEventAndLink(LogEvent* event, Metric2Condition *link) {
     AStatsEvent_writeInt64(statsEvent, 990);
 
     parseStatsEventToLogEvent(statsEvent, event);
+}
 
+static void createLink(const FieldMatcher& whatMatcher, Metric2Condition* link) {
     link->conditionId = 1;
 
+    FieldMatcher field_matcher = whatMatcher;
+    translateFieldMatcher(field_matcher, &link->metricFields);
+    field_matcher.set_field(whatMatcher.field() + 1);
+    translateFieldMatcher(field_matcher, &link->conditionFields);
+    initMetric2ConditionValueIndices(link);
+}
+
+// Links the first uid of the attribution chain, whose position in the event is precomputed.
+static void createLogEventAndLink(LogEvent* event, Metric2Condition* link) {
+    createLogEvent(event);
+
     FieldMatcher field_matcher;
     field_matcher.set_field(event->GetTagId());
     auto child = field_matcher.add_child();
     child->set_field(1);
     child->set_position(FIRST);
     child->add_child()->set_field(1);
+    createLink(field_matcher, link);
+}
 
-    translateFieldMatcher(field_matcher, &link->metricFields);
-    field_matcher.set_field(event->GetTagId() + 1);
-    translateFieldMatcher(field_matcher, &link->conditionFields);
+// Links a top-level field that follows the attribution chain, so the precomputed position does not
+// match the event and the event values are matched instead.
+static void createLogEventAndTopLevelFieldLink(LogEvent* event, Metric2Condition* link) {
+    createLogEvent(event);
+
+    FieldMatcher field_matcher;
+    field_matcher.set_field(event->GetTagId());
+    field_matcher.add_child()->set_field(4);
+    createLink(field_matcher, link);
 }
 
 static void BM_GetDimensionInCondition(benchmark::State& state) {
@@ -71,6 +92,47 @@ static void BM_GetDimensionInCondition(benchmark::State& state) {
 
 BENCHMARK(BM_GetDimensionInCondition);
 
+// Same link, without the precomputed value positions.
+static void BM_GetDimensionInConditionMatchAllValues(benchmark::State& state) {
+    Metric2Condition link;
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    createLogEventAndLink(&event, &link);
+    link.metricFieldValueIndices.clear();
+
+    while (state.KeepRunning()) {
+        HashableDimensionKey output;
+        getDimensionForCondition(event.getValues(), link, &output);
+    }
+}
+
+BENCHMARK(BM_GetDimensionInConditionMatchAllValues);
+
+static void BM_GetDimensionInConditionTopLevelField(benchmark::State& state) {
+    Metric2Condition link;
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    createLogEventAndTopLevelFieldLink(&event, &link);
+
+    while (state.KeepRunning()) {
+        HashableDimensionKey output;
+        getDimensionForCondition(event.getValues(), link, &output);
+    }
+}
+
+BENCHMARK(BM_GetDimensionInConditionTopLevelField);
+
+static void BM_GetDimensionInConditionTopLevelFieldMatchAllValues(benchmark::State& state) {
+    Metric2Condition link;
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    createLogEventAndTopLevelFieldLink(&event, &link);
+    link.metricFieldValueIndices.clear();
+
+    while (state.KeepRunning()) {
+        HashableDimensionKey output;
+        getDimensionForCondition(event.getValues(), link, &output);
+    }
+}
+
+BENCHMARK(BM_GetDimensionInConditionTopLevelFieldMatchAllValues);
 
 }  //  namespace statsd
 }  //  namespace os
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "kll.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using dist_proc::aggregation::KllQuantile;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+const int kBatchSize = 1000;
+
+vector<int64_t> createValues(int count) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int64_t> dis(0, 1000000);
+    vector<int64_t> values;
+    for (int i = 0; i < count; i++) {
+        values.push_back(dis(gen));
+    }
+    return values;
+}
+
+}  // namespace
+
+static void BM_KllAdd(benchmark::State& state) {
+    const vector<int64_t> values = createValues(kBatchSize);
+    unique_ptr<KllQuantile> kll = KllQuantile::Create();
+    while (state.KeepRunning()) {
+        for (const int64_t value : values) {
+            kll->Add(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_KllAdd);
+
+static void BM_KllAddBatch(benchmark::State& state) {
+    const vector<int64_t> values = createValues(kBatchSize);
+    unique_ptr<KllQuantile> kll = KllQuantile::Create();
+    while (state.KeepRunning()) {
+        kll->AddBatch(values);
+    }
+    state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_KllAddBatch);
+
+// Merges sketches of state.range(0) values each, e.g. the sketches of one dimension from several
+// partial buckets.
+static void BM_KllMerge(benchmark::State& state) {
+    const vector<int64_t> values = createValues(state.range(0));
+    unique_ptr<KllQuantile> other = KllQuantile::Create();
+    other->AddBatch(values);
+    while (state.KeepRunning()) {
+        unique_ptr<KllQuantile> kll = KllQuantile::Create();
+        kll->AddBatch(values);
+        kll->Merge(*other);
+        benchmark::DoNotOptimize(kll->num_stored_values());
+    }
+}
+BENCHMARK(BM_KllMerge)->Arg(1000)->Arg(100000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <unordered_map>
+#include <vector>
+
+#include "FieldValue.h"
+#include "HashableDimensionKey.h"
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+#include "metrics/PulledValueAggregator.h"
+#include "stats_event.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::pair;
+using std::shared_ptr;
+using std::unordered_map;
+using std::vector;
+
+namespace {
+
+const int kUidCount = 5000;
+// Rows pulled per uid, e.g. one per cpu cluster.
+const int kRowsPerUid = 2;
+const vector<int> kValueIndices = {1, 2};
+
+// Synthetic per-uid cpu time pull: uid, user time, system time.
+vector<shared_ptr<LogEvent>> createPulledData() {
+    vector<shared_ptr<LogEvent>> allData;
+    for (int row = 0; row < kRowsPerUid; row++) {
+        for (int uid = 0; uid < kUidCount; uid++) {
+            AStatsEvent* statsEvent = AStatsEvent_obtain();
+            AStatsEvent_setAtomId(statsEvent, 10000);
+            AStatsEvent_overwriteTimestamp(statsEvent, 100000);
+            AStatsEvent_writeInt32(statsEvent, 10000 + uid);
+            AStatsEvent_writeInt64(statsEvent, 1000LL * uid + row);
+            AStatsEvent_writeInt64(statsEvent, 500LL * uid + row);
+
+            shared_ptr<LogEvent> event = std::make_shared<LogEvent>(/*uid=*/0, /*pid=*/0);
+            parseStatsEventToLogEvent(statsEvent, event.get());
+            allData.push_back(event);
+        }
+    }
+    return allData;
+}
+
+HashableDimensionKey getUidKey(const LogEvent& event) {
+    HashableDimensionKey key;
+    key.addValue(event.getValues()[0]);
+    return key;
+}
+
+}  // namespace
+
+// Per-event aggregation through the type-dispatching Value operators.
+static void BM_AggregatePulledValuesPerEvent(benchmark::State& state) {
+    const vector<shared_ptr<LogEvent>> allData = createPulledData();
+    while (state.KeepRunning()) {
+        unordered_map<HashableDimensionKey, pair<LogEvent, vector<int>>> aggregateEvents;
+        for (const auto& data : allData) {
+            const HashableDimensionKey key = getUidKey(*data);
+            auto it = aggregateEvents.find(key);
+            if (it == aggregateEvents.end()) {
+                aggregateEvents.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                                        std::forward_as_tuple(*data, kValueIndices));
+                continue;
+            }
+            vector<FieldValue>* aggregateValues = it->second.first.getMutableValues();
+            for (const int index : kValueIndices) {
+                (*aggregateValues)[index].mValue += data->getValues()[index].mValue;
+            }
+        }
+        int64_t sum = 0;
+        for (auto& [_, eventInfo] : aggregateEvents) {
+            sum += eventInfo.first.getValues()[1].mValue.long_value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_AggregatePulledValuesPerEvent);
+
+static void BM_AggregatePulledValuesColumnar(benchmark::State& state) {
+    const vector<shared_ptr<LogEvent>> allData = createPulledData();
+    while (state.KeepRunning()) {
+        PulledValueAggregator aggregator(kValueIndices.size());
+        for (const auto& data : allData) {
+            aggregator.addEvent(getUidKey(*data), *data, kValueIndices);
+        }
+        int64_t sum = 0;
+        aggregator.forEachAggregatedEvent(
+                [&](LogEvent& event) { sum += event.getValues()[1].mValue.long_value; });
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_AggregatePulledValuesColumnar);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
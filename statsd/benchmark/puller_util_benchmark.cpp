@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "external/puller_util.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+#include "packages/UidMap.h"
+#include "stats_event.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::shared_ptr;
+using std::vector;
+
+namespace {
+
+const int kPullAtomTag = 10000;
+const int kNumHostUids = 500;
+const int kFirstHostUid = 10000;
+const int kFirstIsolatedUid = 99000;
+
+// [uid, state, bytes]. Every host uid reports numRows / kNumHostUids / 2 states, each of them once
+// from the host uid and once from an isolated uid, whose row is merged into the host row.
+vector<LogEvent> createPulledEvents(int numRows) {
+    vector<LogEvent> events;
+    events.reserve(numRows);
+    for (int i = 0; i < numRows; i++) {
+        const int host = i % kNumHostUids;
+        const int block = i / kNumHostUids;
+        const int uid = block % 2 == 0 ? kFirstHostUid + host : kFirstIsolatedUid + host;
+        AStatsEvent* statsEvent = AStatsEvent_obtain();
+        AStatsEvent_setAtomId(statsEvent, kPullAtomTag);
+        AStatsEvent_writeInt32(statsEvent, uid);
+        AStatsEvent_addBoolAnnotation(statsEvent, ASTATSLOG_ANNOTATION_ID_IS_UID, true);
+        AStatsEvent_writeInt32(statsEvent, block / 2);
+        AStatsEvent_writeInt64(statsEvent, i);
+        events.emplace_back(/*uid=*/0, /*pid=*/0);
+        parseStatsEventToLogEvent(statsEvent, &events.back());
+    }
+    return events;
+}
+
+}  // namespace
+
+static void BM_MapAndMergeIsolatedUidsToHostUid(benchmark::State& state) {
+    sp<UidMap> uidMap = new UidMap();
+    for (int host = 0; host < kNumHostUids; host++) {
+        uidMap->assignIsolatedUid(kFirstIsolatedUid + host, kFirstHostUid + host);
+    }
+    const vector<LogEvent> events = createPulledEvents(state.range(0));
+    const vector<int> additiveFields = {3};
+    while (state.KeepRunning()) {
+        // The merge maps and sums the events in place, so start from a fresh copy of the pull.
+        state.PauseTiming();
+        vector<shared_ptr<LogEvent>> data;
+        data.reserve(events.size());
+        for (const LogEvent& event : events) {
+            data.push_back(std::make_shared<LogEvent>(event));
+        }
+        state.ResumeTiming();
+
+        mapAndMergeIsolatedUidsToHostUid(data, uidMap, kPullAtomTag, additiveFields);
+        benchmark::DoNotOptimize(data);
+    }
+}
+BENCHMARK(BM_MapAndMergeIsolatedUidsToHostUid)->Arg(1000)->Arg(10000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
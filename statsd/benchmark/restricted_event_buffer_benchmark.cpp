@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "metric_util.h"
+#include "stats_annotations.h"
+#include "utils/DbUtils.h"
+#include "utils/RestrictedEventBuffer.h"
+
+using namespace std;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+static vector<LogEvent> createRestrictedLogEvents(int numEvents) {
+    vector<LogEvent> logEvents;
+    for (int i = 0; i < numEvents; ++i) {
+        AStatsEvent* statsEvent = AStatsEvent_obtain();
+        AStatsEvent_setAtomId(statsEvent, 10);
+        AStatsEvent_addInt32Annotation(statsEvent, ASTATSLOG_ANNOTATION_ID_RESTRICTION_CATEGORY,
+                                       ASTATSLOG_RESTRICTION_CATEGORY_DIAGNOSTIC);
+        AStatsEvent_overwriteTimestamp(statsEvent, 10000000000 + i);
+        AStatsEvent_writeInt32(statsEvent, i);
+        AStatsEvent_writeString(statsEvent, "DemoStringValue");
+        AStatsEvent_writeInt64(statsEvent, 3000000000 + i);
+        AStatsEvent_writeFloat(statsEvent, 2.0);
+        LogEvent logEvent(/*uid=*/0, /*pid=*/0);
+        parseStatsEventToLogEvent(statsEvent, &logEvent);
+        logEvents.push_back(logEvent);
+    }
+    return logEvents;
+}
+
+// Buffers the events as copies of the LogEvents, as restricted event metrics used to.
+static void BM_bufferRestrictedLogEvents(benchmark::State& state) {
+    const vector<LogEvent> logEvents = createRestrictedLogEvents(state.range(0));
+    size_t bytes = 0;
+    for (auto s : state) {
+        vector<LogEvent> bufferedEvents;
+        bytes = 0;
+        for (const LogEvent& logEvent : logEvents) {
+            bufferedEvents.push_back(logEvent);
+            bytes += getSize(logEvent.getValues()) + sizeof(logEvent);
+        }
+        benchmark::DoNotOptimize(bufferedEvents);
+    }
+    state.counters["bytes"] = bytes;
+}
+
+BENCHMARK(BM_bufferRestrictedLogEvents)->Arg(1)->Arg(100)->Arg(1000);
+
+static void BM_bufferRestrictedEventsInColumns(benchmark::State& state) {
+    const vector<LogEvent> logEvents = createRestrictedLogEvents(state.range(0));
+    size_t bytes = 0;
+    for (auto s : state) {
+        RestrictedEventBuffer buffer;
+        for (const LogEvent& logEvent : logEvents) {
+            buffer.append(logEvent);
+        }
+        bytes = buffer.byteSize();
+        benchmark::DoNotOptimize(buffer);
+    }
+    state.counters["bytes"] = bytes;
+}
+
+BENCHMARK(BM_bufferRestrictedEventsInColumns)->Arg(1)->Arg(100)->Arg(1000);
+
+static void BM_insertRestrictedLogEvents(benchmark::State& state) {
+    ConfigKey key = ConfigKey(111, 222);
+    int64_t metricId = 0;
+    const vector<LogEvent> logEvents = createRestrictedLogEvents(state.range(0));
+    string err;
+    for (auto s : state) {
+        state.PauseTiming();
+        dbutils::deleteTable(key, metricId);
+        dbutils::createTableIfNeeded(key, metricId, logEvents[0]);
+        state.ResumeTiming();
+        dbutils::insert(key, metricId, logEvents, err);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    dbutils::deleteDb(key);
+}
+
+BENCHMARK(BM_insertRestrictedLogEvents)->Arg(1)->Arg(100)->Arg(1000);
+
+static void BM_insertRestrictedEventsFromColumns(benchmark::State& state) {
+    ConfigKey key = ConfigKey(111, 222);
+    int64_t metricId = 0;
+    RestrictedEventBuffer buffer;
+    for (const LogEvent& logEvent : createRestrictedLogEvents(state.range(0))) {
+        buffer.append(logEvent);
+    }
+    string err;
+    for (auto s : state) {
+        state.PauseTiming();
+        dbutils::deleteTable(key, metricId);
+        dbutils::createTableIfNeeded(key, metricId, buffer);
+        state.ResumeTiming();
+        dbutils::insert(key, metricId, buffer, err);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    dbutils::deleteDb(key);
+}
+
+BENCHMARK(BM_insertRestrictedEventsFromColumns)->Arg(1)->Arg(100)->Arg(1000);
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
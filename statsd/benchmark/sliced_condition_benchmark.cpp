@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "HashableDimensionKey.h"
+#include "benchmark/benchmark.h"
+#include "condition/ConditionWizard.h"
+#include "condition/SimpleConditionTracker.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+#include "stats_event.h"
+#include "stats_log_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+
+namespace {
+
+const ConfigKey kConfigKey(0, 12345);
+const int kAtomId = 1;
+const int kFirstUid = 10000;
+const int64_t kPredicateId = 1;
+const uint64_t kProtoHash = 0x1234567890;
+
+// Per-uid predicate, similar to "app in foreground": started by state 1 and stopped by state 0 of
+// an atom whose first field is the uid.
+SimplePredicate createPerUidPredicate() {
+    SimplePredicate simplePredicate;
+    simplePredicate.set_start(StringToId("START"));
+    simplePredicate.set_stop(StringToId("STOP"));
+    *simplePredicate.mutable_dimensions() = CreateDimensions(kAtomId, {1 /* uid */});
+    return simplePredicate;
+}
+
+unique_ptr<LogEvent> createUidStateEvent(int uid, int state) {
+    AStatsEvent* statsEvent = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(statsEvent, kAtomId);
+    AStatsEvent_overwriteTimestamp(statsEvent, 1000);
+    AStatsEvent_writeInt32(statsEvent, uid);
+    AStatsEvent_writeInt32(statsEvent, state);
+
+    unique_ptr<LogEvent> logEvent = std::make_unique<LogEvent>(/*uid=*/0, /*pid=*/0);
+    parseStatsEventToLogEvent(statsEvent, logEvent.get());
+    return logEvent;
+}
+
+void evaluate(SimpleConditionTracker& tracker, const LogEvent& event, bool start) {
+    const vector<MatchingState> matcherState = {
+            start ? MatchingState::kMatched : MatchingState::kNotMatched,
+            start ? MatchingState::kNotMatched : MatchingState::kMatched};
+    vector<sp<ConditionTracker>> allConditions;
+    vector<ConditionState> conditionCache(1, ConditionState::kNotEvaluated);
+    vector<bool> changedCache(1, false);
+    tracker.evaluateCondition(event, matcherState, allConditions, conditionCache, changedCache);
+}
+
+// Creates a predicate that is true for numUids uids.
+sp<SimpleConditionTracker> createTrackerWithUids(int numUids) {
+    unordered_map<int64_t, int> atomMatchingTrackerMap;
+    atomMatchingTrackerMap[StringToId("START")] = 0;
+    atomMatchingTrackerMap[StringToId("STOP")] = 1;
+    sp<SimpleConditionTracker> tracker =
+            new SimpleConditionTracker(kConfigKey, kPredicateId, kProtoHash, /*index=*/0,
+                                       createPerUidPredicate(), atomMatchingTrackerMap);
+    for (int i = 0; i < numUids; i++) {
+        evaluate(*tracker, *createUidStateEvent(kFirstUid + i, 1), /*start=*/true);
+    }
+    return tracker;
+}
+
+vector<ConditionKey> createQueryKeys(int numUids) {
+    vector<Matcher> dimensions;
+    translateFieldMatcher(createPerUidPredicate().dimensions(), &dimensions);
+    vector<ConditionKey> queryKeys;
+    for (int i = 0; i < numUids; i++) {
+        HashableDimensionKey key;
+        filterValues(dimensions, createUidStateEvent(kFirstUid + i, 1)->getValues(), &key);
+        queryKeys.push_back({{kPredicateId, key}});
+    }
+    return queryKeys;
+}
+
+}  // namespace
+
+// Queries the condition of each uid through the ConditionWizard, as metrics with a condition link
+// do for every matched event.
+static void BM_SlicedConditionQuery(benchmark::State& state) {
+    const int numUids = state.range(0);
+    vector<sp<ConditionTracker>> allConditions = {createTrackerWithUids(numUids)};
+    sp<ConditionWizard> wizard = new ConditionWizard(allConditions);
+    const vector<ConditionKey> queryKeys = createQueryKeys(numUids);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(
+                wizard->query(/*conditionIndex=*/0, queryKeys[i], /*isPartialLink=*/false));
+        i = (i + 1) % queryKeys.size();
+    }
+}
+BENCHMARK(BM_SlicedConditionQuery)->Arg(100)->Arg(1000)->Arg(5000);
+
+// Flips the condition of one uid back and forth while the others stay true.
+static void BM_SlicedConditionStartStop(benchmark::State& state) {
+    const int numUids = state.range(0);
+    sp<SimpleConditionTracker> tracker = createTrackerWithUids(numUids);
+    const unique_ptr<LogEvent> stopEvent = createUidStateEvent(kFirstUid + numUids / 2, 0);
+    const unique_ptr<LogEvent> startEvent = createUidStateEvent(kFirstUid + numUids / 2, 1);
+    while (state.KeepRunning()) {
+        evaluate(*tracker, *stopEvent, /*start=*/false);
+        evaluate(*tracker, *startEvent, /*start=*/true);
+    }
+}
+BENCHMARK(BM_SlicedConditionStartStop)->Arg(100)->Arg(1000)->Arg(5000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "metric_util.h"
+#include "state/StateManager.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+namespace {
+
+class NoOpStateListener : public virtual StateListener {
+public:
+    void onStateChanged(const int64_t eventTimeNs, const int32_t atomId,
+                        const HashableDimensionKey& primaryKey, const FieldValue& oldState,
+                        const FieldValue& newState) override {
+    }
+};
+
+// Registers a listener for the state atoms that are commonly sliced by.
+void registerStateListeners(StateManager& mgr, const sp<StateListener>& listener) {
+    mgr.registerListener(util::SCREEN_STATE_CHANGED, listener);
+    mgr.registerListener(util::UID_PROCESS_STATE_CHANGED, listener);
+    mgr.registerListener(util::BLE_SCAN_STATE_CHANGED, listener);
+    mgr.registerListener(util::WAKELOCK_STATE_CHANGED, listener);
+}
+
+}  // namespace
+
+// Cost of StateManager::onLogEvent for an event that is not a state event, which is the case for
+// most events received by StatsLogProcessor.
+static void BM_StateManagerOnNonStateEvent(benchmark::State& state) {
+    StateManager mgr;
+    sp<StateListener> listener = new NoOpStateListener();
+    registerStateListeners(mgr, listener);
+    const std::unique_ptr<LogEvent> event =
+            CreateSyncStartEvent(/*timestampNs=*/1000, {1000}, {"tag"}, "sync");
+    while (state.KeepRunning()) {
+        mgr.onLogEvent(*event);
+    }
+}
+BENCHMARK(BM_StateManagerOnNonStateEvent);
+
+// Cost of StateManager::onLogEvent for a state event, including the state update.
+static void BM_StateManagerOnStateEvent(benchmark::State& state) {
+    StateManager mgr;
+    sp<StateListener> listener = new NoOpStateListener();
+    registerStateListeners(mgr, listener);
+    vector<std::unique_ptr<LogEvent>> events;
+    events.push_back(CreateScreenStateChangedEvent(
+            /*timestampNs=*/1000, android::view::DisplayStateEnum::DISPLAY_STATE_ON));
+    events.push_back(CreateScreenStateChangedEvent(
+            /*timestampNs=*/2000, android::view::DisplayStateEnum::DISPLAY_STATE_OFF));
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        mgr.onLogEvent(*events[i]);
+        i ^= 1;
+    }
+}
+BENCHMARK(BM_StateManagerOnStateEvent);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
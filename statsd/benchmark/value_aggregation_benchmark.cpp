@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+
+#include "FieldValue.h"
+#include "benchmark/benchmark.h"
+#include "metrics/value_metric_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+namespace {
+
+const int kValueCount = 1000;
+
+vector<Value> createLongValues(int64_t offset) {
+    vector<Value> values;
+    for (int i = 0; i < kValueCount; i++) {
+        values.push_back(Value((int64_t)(offset + i * 7)));
+    }
+    return values;
+}
+
+}  // namespace
+
+// Diff against base and sum with the Value operators, switching on the type for every operation.
+static void BM_DiffAndSumValueOperators(benchmark::State& state) {
+    const vector<Value> bases = createLongValues(0);
+    const vector<Value> values = createLongValues(100);
+    while (state.KeepRunning()) {
+        Value sum((int64_t)0);
+        for (int i = 0; i < kValueCount; i++) {
+            if (values[i] >= bases[i]) {
+                sum += values[i] - bases[i];
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_DiffAndSumValueOperators);
+
+static void BM_DiffAndSumTyped(benchmark::State& state) {
+    const vector<Value> bases = createLongValues(0);
+    const vector<Value> values = createLongValues(100);
+    while (state.KeepRunning()) {
+        Value sum((int64_t)0);
+        for (int i = 0; i < kValueCount; i++) {
+            const std::optional<Value> diff =
+                    computeValueDiff(values[i], bases[i], ValueMetric::INCREASING, false);
+            if (diff) {
+                aggregateValue(*diff, ValueMetric::SUM, sum);
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_DiffAndSumTyped);
+
+static void BM_MaxValueOperators(benchmark::State& state) {
+    const vector<Value> values = createLongValues(0);
+    while (state.KeepRunning()) {
+        Value aggregate = values[0];
+        for (const Value& value : values) {
+            aggregate = std::max(value, aggregate);
+        }
+        benchmark::DoNotOptimize(aggregate);
+    }
+}
+BENCHMARK(BM_MaxValueOperators);
+
+static void BM_MaxTyped(benchmark::State& state) {
+    const vector<Value> values = createLongValues(0);
+    while (state.KeepRunning()) {
+        Value aggregate = values[0];
+        for (const Value& value : values) {
+            aggregateValue(value, ValueMetric::MAX, aggregate);
+        }
+        benchmark::DoNotOptimize(aggregate);
+    }
+}
+BENCHMARK(BM_MaxTyped);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
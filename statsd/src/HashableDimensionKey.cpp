@@ -111,43 +111,34 @@ StatsDimensionsValueParcel HashableDimensionKey::toStatsDimensionsValueParcel()
     return root;
 }
 
+android::hash_t hashValue(android::hash_t hash, const Value& value) {
+    hash = android::JenkinsHashMix(hash, android::hash_type((int)value.getType()));
+    switch (value.getType()) {
+        case INT:
+            return android::JenkinsHashMix(hash, android::hash_type(value.int_value));
+        case LONG:
+            return android::JenkinsHashMix(hash, android::hash_type(value.long_value));
+        case STRING:
+            return android::JenkinsHashMix(
+                    hash, static_cast<uint32_t>(std::hash<std::string>()(value.str_value)));
+        case FLOAT:
+            return android::JenkinsHashMix(hash, android::hash_type(value.float_value));
+        case DOUBLE:
+            return android::JenkinsHashMix(hash, android::hash_type(value.double_value));
+        case STORAGE:
+            return android::JenkinsHashMixBytes(hash, value.storage_value.data(),
+                                                value.storage_value.size());
+        default:
+            return hash;
+    }
+}
+
 android::hash_t hashDimension(const HashableDimensionKey& value) {
     android::hash_t hash = 0;
     for (const auto& fieldValue : value.getValues()) {
         hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getField()));
         hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getTag()));
-        hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mValue.getType()));
-        switch (fieldValue.mValue.getType()) {
-            case INT:
-                hash = android::JenkinsHashMix(hash,
-                                               android::hash_type(fieldValue.mValue.int_value));
-                break;
-            case LONG:
-                hash = android::JenkinsHashMix(hash,
-                                               android::hash_type(fieldValue.mValue.long_value));
-                break;
-            case STRING:
-                hash = android::JenkinsHashMix(hash, static_cast<uint32_t>(std::hash<std::string>()(
-                                                             fieldValue.mValue.str_value)));
-                break;
-            case FLOAT: {
-                hash = android::JenkinsHashMix(hash,
-                                               android::hash_type(fieldValue.mValue.float_value));
-                break;
-            }
-            case DOUBLE: {
-                hash = android::JenkinsHashMix(hash,
-                                               android::hash_type(fieldValue.mValue.double_value));
-                break;
-            }
-            case STORAGE: {
-                hash = android::JenkinsHashMixBytes(hash, fieldValue.mValue.storage_value.data(),
-                                                    fieldValue.mValue.storage_value.size());
-                break;
-            }
-            default:
-                break;
-        }
+        hash = hashValue(hash, fieldValue.mValue);
     }
     return JenkinsHashWhiten(hash);
 }
@@ -238,9 +229,90 @@ void filterGaugeValues(const std::vector<Matcher>& matcherFields,
     }
 }
 
+namespace {
+
+// Returns the expected index in the event values of the only value matched by the matcher, or -1
+// if it is unknown or the matcher can match several values. Only matchers that select a single
+// leaf at every depth qualify: ANY, ALL and LAST positions, and matchers that stop above the
+// leaves of a repeated field, always take the generic path.
+int getExpectedValueIndex(const Matcher& matcher) {
+    const Field& field = matcher.mMatcher;
+    const int32_t depth = field.getDepth();
+    const int32_t fieldNum = field.getPosAtDepth(0);
+    if (depth == 0) {
+        // Top-level field, assuming that the preceding fields are not repeated. The value at the
+        // index must also be a top-level value, which a repeated field's values are not.
+        return fieldNum - 1;
+    }
+    if (fieldNum != 1 || !matcher.hasFirstPositionMatcher() ||
+        matcher.getRawMaskAtDepth(1) != 0x7f) {
+        return -1;
+    }
+    if (depth == 1) {
+        // First element of a repeated primitive field that is the first field of the atom.
+        return 0;
+    }
+    if (matcher.getRawMaskAtDepth(2) != 0x7f || field.getPosAtDepth(2) <= 0) {
+        return -1;
+    }
+    // Leaf of the first node of a repeated field that is the first field of the atom, such as
+    // the first uid of the attribution chain.
+    return field.getPosAtDepth(2) - 1;
+}
+
+// Fills conditionDimension from the values at links.metricFieldValueIndices. Returns false, and
+// leaves conditionDimension unchanged, if the event does not have the expected layout.
+bool getDimensionForConditionFromValueIndices(const std::vector<FieldValue>& eventValues,
+                                              const Metric2Condition& links,
+                                              HashableDimensionKey* conditionDimension) {
+    const std::vector<int>& indices = links.metricFieldValueIndices;
+    for (size_t i = 0; i < indices.size(); i++) {
+        // The value must be the leaf selected by the matcher, at the same depth, and not the
+        // first of several values that the matcher would select.
+        if (indices[i] >= (int)eventValues.size() ||
+            eventValues[indices[i]].mField.getDepth() !=
+                    links.metricFields[i].mMatcher.getDepth() ||
+            !eventValues[indices[i]].mField.matches(links.metricFields[i])) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < indices.size(); i++) {
+        conditionDimension->addValue(eventValues[indices[i]]);
+        conditionDimension->mutableValue(i)->mField.setField(
+                links.conditionFields[i].mMatcher.getField());
+        conditionDimension->mutableValue(i)->mField.setTag(
+                links.conditionFields[i].mMatcher.getTag());
+    }
+    return true;
+}
+
+}  // namespace
+
+void initMetric2ConditionValueIndices(Metric2Condition* link) {
+    link->metricFieldValueIndices.clear();
+    if (link->metricFields.empty() || link->metricFields.size() != link->conditionFields.size()) {
+        return;
+    }
+    std::vector<int> indices;
+    for (const Matcher& matcher : link->metricFields) {
+        const int index = getExpectedValueIndex(matcher);
+        // The dimension is built in the order of the event values, so the indices must increase.
+        if (index < 0 || (!indices.empty() && index <= indices.back())) {
+            return;
+        }
+        indices.push_back(index);
+    }
+    link->metricFieldValueIndices = std::move(indices);
+}
+
 void getDimensionForCondition(const std::vector<FieldValue>& eventValues,
                               const Metric2Condition& links,
                               HashableDimensionKey* conditionDimension) {
+    if (!links.metricFieldValueIndices.empty() &&
+        getDimensionForConditionFromValueIndices(eventValues, links, conditionDimension)) {
+        return;
+    }
+
     // Get the dimension first by using dimension from what.
     filterValues(links.metricFields, eventValues, conditionDimension);
 
@@ -257,6 +329,20 @@ void getDimensionForCondition(const std::vector<FieldValue>& eventValues,
     }
 }
 
+bool getLinkedConditionKey(const HashableDimensionKey& conditionDimension,
+                           const Metric2Condition& link, HashableDimensionKey* linkedConditionKey) {
+    for (const Matcher& conditionField : link.conditionFields) {
+        FieldValue value;
+        if (!filterValues(conditionField, conditionDimension.getValues(), &value)) {
+            return false;
+        }
+        value.mField.setField(conditionField.mMatcher.getField());
+        value.mField.setTag(conditionField.mMatcher.getTag());
+        linkedConditionKey->addValue(value);
+    }
+    return true;
+}
+
 void getDimensionForState(const std::vector<FieldValue>& eventValues, const Metric2State& link,
                           HashableDimensionKey* statePrimaryKey) {
     // First, get the dimension from the event using the "what" fields from the
@@ -42,6 +42,11 @@ struct Metric2Condition {
     int64_t conditionId;
     std::vector<Matcher> metricFields;
     std::vector<Matcher> conditionFields;
+
+    // Expected index in the event values of the value matched by each metric field, set by
+    // initMetric2ConditionValueIndices. Empty if the link can only be resolved by matching all
+    // event values.
+    std::vector<int> metricFieldValueIndices;
 };
 
 struct Metric2State {
@@ -162,6 +167,9 @@ private:
     HashableDimensionKey mAtomFieldValues;
 };
 
+// Mixes the type and the content of value into hash.
+android::hash_t hashValue(android::hash_t hash, const Value& value);
+
 android::hash_t hashDimension(const HashableDimensionKey& key);
 
 /**
@@ -232,6 +240,27 @@ void getDimensionForCondition(const std::vector<FieldValue>& eventValues,
                               const Metric2Condition& links,
                               HashableDimensionKey* conditionDimension);
 
+/**
+ * Gets the key that getDimensionForCondition returns for the link from the values of a dimension
+ * of the linked condition, i.e. the dimension's values of the link's condition fields.
+ *
+ * Returns false if the dimension does not have a value for every condition field of the link.
+ */
+bool getLinkedConditionKey(const HashableDimensionKey& conditionDimension,
+                           const Metric2Condition& link, HashableDimensionKey* linkedConditionKey);
+
+/**
+ * Precomputes where the values of the link's metric fields are in the event values, so that
+ * getDimensionForCondition can read them directly instead of matching all event values.
+ *
+ * This is only possible if each metric field matches at most one value: top-level fields, and the
+ * first element of a repeated field. The indices assume that the preceding fields of the atom are
+ * not repeated, or that the repeated field is the first field of the atom. Each index is checked
+ * against the event, and getDimensionForCondition falls back to matching all event values if the
+ * event does not have the expected layout.
+ */
+void initMetric2ConditionValueIndices(Metric2Condition* link);
+
 /**
  * Get dimension values using metric's "what" fields and fill statePrimaryKey's
  * mField information using "state" fields.
@@ -110,7 +110,8 @@ StatsLogProcessor::StatsLogProcessor(
       mSendRestrictedMetricsBroadcast(sendRestrictedMetricsBroadcast),
       mTimeBaseNs(timeBaseNs),
       mLargestTimestampSeen(0),
-      mLastTimestampSeen(0) {
+      mLastTimestampSeen(0),
+      mRestrictedDbWriter(StatsdStats::kMaxRestrictedDbWriterQueueSize) {
     mPullerManager->ForceClearPullerCache();
     StateManager::getInstance().updateLogSources(uidMap);
     // It is safe called locked version at constructor - no concurrent access possible
@@ -563,6 +564,7 @@ void StatsLogProcessor::OnConfigUpdatedLocked(const int64_t timestampNs, const C
             StatsdStats::getInstance().noteDbDeletionConfigUpdated(key);
             // Always delete the old db if restricted metrics config is not a
             // modular update.
+            mRestrictedDbWriter.waitForPendingWrites();
             dbutils::deleteDb(key);
         }
     }
@@ -620,6 +622,7 @@ void StatsLogProcessor::OnConfigUpdatedLocked(const int64_t timestampNs, const C
             it->second->hasRestrictedMetricsDelegate()) {
             mSendRestrictedMetricsBroadcast(key, it->second->getRestrictedMetricsDelegate(), {});
             StatsdStats::getInstance().noteDbConfigInvalid(key);
+            mRestrictedDbWriter.waitForPendingWrites();
             dbutils::deleteDb(key);
         }
         mMetricsManagers.erase(key);
@@ -852,6 +855,7 @@ void StatsLogProcessor::OnConfigRemoved(const ConfigKey& key) {
                               NO_TIME_CONSTRAINTS);
         if (isAtLeastU() && it->second->hasRestrictedMetricsDelegate()) {
             StatsdStats::getInstance().noteDbDeletionConfigRemoved(key);
+            mRestrictedDbWriter.waitForPendingWrites();
             dbutils::deleteDb(key);
             mSendRestrictedMetricsBroadcast(key, it->second->getRestrictedMetricsDelegate(), {});
         }
@@ -910,7 +914,7 @@ void StatsLogProcessor::querySql(const string& sqlQuery, const int32_t minSqlCli
                                  const shared_ptr<IStatsQueryCallback>& callback,
                                  const int64_t configId, const string& configPackage,
                                  const int32_t callingUid) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    std::unique_lock<std::mutex> lock(mMetricsMutex);
     string err = "";
 
     if (!isAtLeastU()) {
@@ -966,6 +970,9 @@ void StatsLogProcessor::querySql(const string& sqlQuery, const int32_t minSqlCli
 
     flushRestrictedDataLocked(elapsedRealtimeNs);
     enforceDataTtlsLocked(getWallClockNs(), elapsedRealtimeNs);
+    // Wait for the queued writes without blocking the processing of events.
+    lock.unlock();
+    mRestrictedDbWriter.waitForPendingWrites();
 
     std::vector<std::vector<std::string>> rows;
     std::vector<int32_t> columnTypes;
@@ -1042,14 +1049,17 @@ void StatsLogProcessor::EnforceDataTtls(const int64_t wallClockNs,
     if (!isAtLeastU()) {
         return;
     }
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
-    enforceDataTtlsLocked(wallClockNs, elapsedRealtimeNs);
+    {
+        std::lock_guard<std::mutex> lock(mMetricsMutex);
+        enforceDataTtlsLocked(wallClockNs, elapsedRealtimeNs);
+    }
+    mRestrictedDbWriter.waitForPendingWrites();
 }
 
 void StatsLogProcessor::enforceDataTtlsLocked(const int64_t wallClockNs,
                                               const int64_t elapsedRealtimeNs) {
     for (const auto& itr : mMetricsManagers) {
-        itr.second->enforceRestrictedDataTtls(wallClockNs);
+        itr.second->enforceRestrictedDataTtls(wallClockNs, mRestrictedDbWriter);
     }
     mLastTtlTime = elapsedRealtimeNs;
 }
@@ -1060,9 +1070,15 @@ void StatsLogProcessor::enforceDbGuardrailsIfNecessaryLocked(const int64_t wallC
         StatsdStats::kMinDbGuardrailEnforcementPeriodNs) {
         return;
     }
-    StorageManager::enforceDbGuardrails(STATS_RESTRICTED_DATA_DIR, wallClockNs / NS_PER_SEC,
-                                        StatsdStats::kMaxFileSize);
-    mLastDbGuardrailEnforcementTime = elapsedRealtimeNs;
+    // Run on the db writer thread after the pending writes, so that they do not recreate a db
+    // after it is deleted, and so that the integrity checks do not block the log event thread.
+    // If the queue is full, the enforcement is retried on the next event.
+    if (mRestrictedDbWriter.push([wallClockSec = wallClockNs / NS_PER_SEC] {
+            StorageManager::enforceDbGuardrails(STATS_RESTRICTED_DATA_DIR, wallClockSec,
+                                                StatsdStats::kMaxFileSize);
+        })) {
+        mLastDbGuardrailEnforcementTime = elapsedRealtimeNs;
+    }
 }
 
 void StatsLogProcessor::fillRestrictedMetrics(const int64_t configId, const string& configPackage,
@@ -1090,7 +1106,7 @@ void StatsLogProcessor::fillRestrictedMetrics(const int64_t configId, const stri
 void StatsLogProcessor::flushRestrictedDataLocked(const int64_t elapsedRealtimeNs) {
     for (const auto& it : mMetricsManagers) {
         // no-op if metricsManager is not restricted
-        it.second->flushRestrictedData();
+        it.second->queueRestrictedDataFlush(mRestrictedDbWriter);
     }
 
     mLastFlushRestrictedTime = elapsedRealtimeNs;
@@ -1129,7 +1145,7 @@ void StatsLogProcessor::flushIfNecessaryLocked(const ConfigKey& key,
 
     if (requestDump) {
         if (metricsManager.hasRestrictedMetricsDelegate()) {
-            metricsManager.flushRestrictedData();
+            metricsManager.queueRestrictedDataFlush(mRestrictedDbWriter);
             // No need to send broadcast for restricted metrics.
             return;
         }
@@ -1160,6 +1176,8 @@ void StatsLogProcessor::WriteDataToDiskLocked(const ConfigKey& key, const int64_
         return;
     }
     if (mMetricsManagers.find(key)->second->hasRestrictedMetricsDelegate()) {
+        // Complete the queued writes as well, as statsd may be about to stop.
+        mRestrictedDbWriter.waitForPendingWrites();
         mMetricsManagers.find(key)->second->flushRestrictedData();
         return;
     }
@@ -1402,8 +1420,9 @@ void StatsLogProcessor::WriteDataToDisk(const DumpReportReason dumpReportReason,
 }
 
 void StatsLogProcessor::informPullAlarmFired(const int64_t timestampNs) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
-    mPullerManager->OnAlarmFired(timestampNs);
+    // mMetricsMutex is held while the pulled data is delivered to the metrics, but not while
+    // pulling, so that a slow puller does not block log events.
+    mPullerManager->OnAlarmFired(timestampNs, &mMetricsMutex);
 }
 
 int64_t StatsLogProcessor::getLastReportTimeNs(const ConfigKey& key) {
@@ -30,6 +30,7 @@
 #include "socket/LogEventFilter.h"
 #include "src/statsd_config.pb.h"
 #include "src/statsd_metadata.pb.h"
+#include "utils/RestrictedDbWriter.h"
 
 namespace android {
 namespace os {
@@ -112,7 +113,7 @@ public:
                           int64_t currentWallClockTimeNs,
                           int64_t systemElapsedTimeNs);
 
-    /* Enforces ttls for restricted metrics */
+    /* Enforces ttls for restricted metrics. Returns once the ttls have been enforced. */
     void EnforceDataTtls(const int64_t wallClockNs, const int64_t elapsedRealtimeNs);
 
     /* Sets the active status/ttl for all configs and metrics to the status in ActiveConfigList. */
@@ -268,10 +269,10 @@ private:
     void enforceDataTtlsIfNecessaryLocked(const int64_t wallClockNs,
                                           const int64_t elapsedRealtimeNs);
 
-    // Enforces ttls on all restricted metrics.
+    // Queues the enforcement of ttls on all restricted metrics to the db writer thread.
     void enforceDataTtlsLocked(const int64_t wallClockNs, const int64_t elapsedRealtimeNs);
 
-    // Enforces that dbs are within guardrail parameters.
+    // Queues the enforcement of the db guardrail parameters to the db writer thread.
     void enforceDbGuardrailsIfNecessaryLocked(const int64_t wallClockNs,
                                               const int64_t elapsedRealtimeNs);
 
@@ -321,6 +322,7 @@ private:
             const int64_t& timestampNs,
             unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>>& alarmSet);
 
+    // Queues a write of the restricted data of all configs to the db writer thread.
     void flushRestrictedDataLocked(const int64_t elapsedRealtimeNs);
 
     void flushRestrictedDataIfNecessaryLocked(const int64_t elapsedRealtimeNs);
@@ -367,7 +369,12 @@ private:
 
     bool mPrintAllLogs = false;
 
+    // Writes the restricted metric data to the dbs off the event thread. Declared last so that it
+    // is stopped before the other members are destroyed.
+    RestrictedDbWriter mRestrictedDbWriter;
+
     friend class StatsLogProcessorTestRestricted;
+    friend class RestrictedEventMetricE2eTest;
     FRIEND_TEST(StatsLogProcessorTest, TestOutOfOrderLogs);
     FRIEND_TEST(StatsLogProcessorTest, TestRateLimitByteSize);
     FRIEND_TEST(StatsLogProcessorTest, TestRateLimitBroadcast);
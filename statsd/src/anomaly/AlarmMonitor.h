@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "anomaly/AlarmTimerWheel.h"
 #include "anomaly/indexed_priority_queue.h"
 
 #include <aidl/android/os/IStatsCompanionService.h>
@@ -47,6 +48,12 @@ struct InternalAlarm : public RefBase {
 
     const uint32_t timestampSec;
 
+    // Position of the alarm in the AlarmTimerWheel holding it. Only used by the wheel, which is
+    // accessed under the AlarmMonitor lock.
+    mutable uint8_t wheelLevel = 0;
+    mutable uint8_t wheelSlot = 0;
+    mutable uint32_t wheelIndex = AlarmTimerWheel::kNotInWheel;
+
     /** InternalAlarm a is smaller (higher priority) than b if its timestamp is sooner. */
     struct SmallerTimestamp {
         bool operator()(sp<const InternalAlarm> a, sp<const InternalAlarm> b) const {
@@ -113,15 +120,15 @@ private:
     /**
      * Timestamp (seconds since epoch) of the alarm registered with
      * StatsCompanionService. This, in general, may not be equal to the soonest
-     * alarm stored in mPq, but should be within minUpdateTimeSec of it.
+     * alarm stored in mTimerWheel, but should be within minUpdateTimeSec of it.
      * A value of 0 indicates that no alarm is currently registered.
      */
     uint32_t mRegisteredAlarmTimeSec;
 
     /**
-     * Priority queue of alarms, prioritized by soonest alarm.timestampSec.
+     * Timer wheel of alarms, ordered by alarm.timestampSec.
      */
-    indexed_priority_queue<InternalAlarm, InternalAlarm::SmallerTimestamp> mPq;
+    AlarmTimerWheel mTimerWheel;
 
     /**
      * Binder interface for communicating with StatsCompanionService.
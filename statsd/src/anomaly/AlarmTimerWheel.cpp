@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "anomaly/AlarmTimerWheel.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "anomaly/AlarmMonitor.h"
+
+using std::unordered_set;
+using std::vector;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+AlarmTimerWheel::AlarmTimerWheel()
+    : mCurrentSec(0), mSize(0), mSoonestSec(0), mSoonestSecValid(true) {
+    memset(mOccupied, 0, sizeof(mOccupied));
+}
+
+AlarmTimerWheel::~AlarmTimerWheel() {
+    for (int level = 0; level < kNumLevels; level++) {
+        for (int slot = 0; slot < kNumSlots; slot++) {
+            for (const sp<const InternalAlarm>& alarm : mSlots[level][slot]) {
+                alarm->wheelIndex = kNotInWheel;
+            }
+        }
+    }
+}
+
+void AlarmTimerWheel::push(const sp<const InternalAlarm>& alarm) {
+    if (alarm == nullptr || alarm->wheelIndex != kNotInWheel) return;
+    if (mSize == 0) {
+        // The lookups may have advanced the wheel past the time of the alarms added next, which
+        // would then all be stored in the slot of mCurrentSec. Nothing is stored, so restart from
+        // the top level; the lookups cascade the alarms down again.
+        mCurrentSec = 0;
+    }
+    place(alarm);
+    if (mSize == 0) {
+        mSoonestSec = alarm->timestampSec;
+        mSoonestSecValid = true;
+    } else if (mSoonestSecValid) {
+        mSoonestSec = std::min(mSoonestSec, alarm->timestampSec);
+    }
+    mSize++;
+}
+
+bool AlarmTimerWheel::remove(const sp<const InternalAlarm>& alarm) {
+    if (alarm == nullptr || alarm->wheelIndex == kNotInWheel) return false;
+    const vector<sp<const InternalAlarm>>& alarms = mSlots[alarm->wheelLevel][alarm->wheelSlot];
+    // The alarm may belong to another wheel.
+    if (alarm->wheelIndex >= alarms.size() || alarms[alarm->wheelIndex] != alarm) {
+        return false;
+    }
+    removeAt(alarm->wheelLevel, alarm->wheelSlot, alarm->wheelIndex);
+    if (mSoonestSecValid && alarm->timestampSec <= mSoonestSec) {
+        mSoonestSecValid = false;
+    }
+    return true;
+}
+
+void AlarmTimerWheel::popSoonerThan(
+        uint32_t timestampSec,
+        unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>>& poppedAlarms) {
+    const size_t sizeBefore = mSize;
+    int level;
+    int slot;
+    while (findSoonestSlot(&level, &slot)) {
+        const uint32_t slotStartSec = getSlotStartSec(level, slot);
+        if (level == 0) {
+            vector<sp<const InternalAlarm>>& alarms = mSlots[level][slot];
+            // Alarms that were added after their time had passed are stored in the slot of
+            // mCurrentSec, so check the timestamp of each alarm rather than the slot time.
+            for (size_t i = 0; i < alarms.size();) {
+                if (alarms[i]->timestampSec <= timestampSec) {
+                    poppedAlarms.insert(alarms[i]);
+                    removeAt(level, slot, i);
+                } else {
+                    i++;
+                }
+            }
+            if (slotStartSec > timestampSec) break;
+            mCurrentSec = slotStartSec;
+            continue;
+        }
+        if (slotStartSec > timestampSec) break;
+        cascade(level, slot);
+    }
+    if (mSize != sizeBefore) {
+        mSoonestSecValid = false;
+    }
+}
+
+uint32_t AlarmTimerWheel::getSoonestTimestampSec() {
+    if (!mSoonestSecValid) {
+        mSoonestSec = 0;
+        int level;
+        int slot;
+        while (findSoonestSlot(&level, &slot)) {
+            if (level > 0) {
+                // No alarm is due before this slot, so advance to it. Otherwise all the alarms of
+                // a higher level slot, which may hold all the alarms of the wheel, would be
+                // scanned again after each removal of the soonest one.
+                cascade(level, slot);
+                continue;
+            }
+            mSoonestSec = UINT32_MAX;
+            for (const sp<const InternalAlarm>& alarm : mSlots[level][slot]) {
+                mSoonestSec = std::min(mSoonestSec, alarm->timestampSec);
+            }
+            break;
+        }
+        mSoonestSecValid = true;
+    }
+    return mSoonestSec;
+}
+
+void AlarmTimerWheel::place(const sp<const InternalAlarm>& alarm) {
+    const uint32_t timestampSec = std::max(alarm->timestampSec, mCurrentSec);
+    const uint32_t diff = timestampSec ^ mCurrentSec;
+    const int level = diff == 0 ? 0 : (31 - __builtin_clz(diff)) / kBitsPerLevel;
+    const int slot = (timestampSec >> (level * kBitsPerLevel)) & (kNumSlots - 1);
+    vector<sp<const InternalAlarm>>& alarms = mSlots[level][slot];
+    alarm->wheelLevel = level;
+    alarm->wheelSlot = slot;
+    alarm->wheelIndex = alarms.size();
+    alarms.push_back(alarm);
+    mOccupied[level][slot / 64] |= uint64_t{1} << (slot % 64);
+}
+
+void AlarmTimerWheel::cascade(int level, int slot) {
+    mCurrentSec = getSlotStartSec(level, slot);
+    vector<sp<const InternalAlarm>> cascaded;
+    cascaded.swap(mSlots[level][slot]);
+    mOccupied[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    for (const sp<const InternalAlarm>& alarm : cascaded) {
+        place(alarm);
+    }
+}
+
+void AlarmTimerWheel::removeAt(int level, int slot, size_t index) {
+    vector<sp<const InternalAlarm>>& alarms = mSlots[level][slot];
+    alarms[index]->wheelIndex = kNotInWheel;
+    if (index + 1 < alarms.size()) {
+        alarms[index] = alarms.back();
+        alarms[index]->wheelIndex = index;
+    }
+    alarms.pop_back();
+    if (alarms.empty()) {
+        mOccupied[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    }
+    mSize--;
+}
+
+bool AlarmTimerWheel::findSoonestSlot(int* level, int* slot) const {
+    for (int l = 0; l < kNumLevels; l++) {
+        for (int word = 0; word < kBitmapWords; word++) {
+            if (mOccupied[l][word] != 0) {
+                *level = l;
+                *slot = word * 64 + __builtin_ctzll(mOccupied[l][word]);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+uint32_t AlarmTimerWheel::getSlotStartSec(int level, int slot) const {
+    // Computed in 64 bits since the shift is 32 for the top level.
+    const int shift = (level + 1) * kBitsPerLevel;
+    const uint64_t upperBits = (static_cast<uint64_t>(mCurrentSec) >> shift) << shift;
+    return static_cast<uint32_t>(upperBits |
+                                 (static_cast<uint64_t>(slot) << (level * kBitsPerLevel)));
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
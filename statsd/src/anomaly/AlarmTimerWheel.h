@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "anomaly/indexed_priority_queue.h"
+
+#include <utils/RefBase.h>
+
+#include <stdint.h>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+struct InternalAlarm;
+
+/**
+ * Hierarchical timer wheel of InternalAlarms, keyed by their timestamp in seconds.
+ *
+ * The wheel has 4 levels of 256 slots, one level per byte of the uint32 timestamp. An alarm is
+ * stored at the level of the most significant byte in which its timestamp differs from the current
+ * time of the wheel, so level 0 slots hold single seconds and higher level slots hold 256^level
+ * seconds. When the current time reaches a higher level slot, its alarms are cascaded to the lower
+ * levels.
+ *
+ * Each alarm records its own position in the wheel, so adding and removing an alarm are O(1) and
+ * need neither a heap nor a hash map of alarm pointers. The soonest alarm is found through a
+ * bitmap of the non-empty slots of each level. Looking it up also advances the wheel to the
+ * soonest slot, cascading it to level 0, so that its lookup after removing the soonest alarm only
+ * scans the alarms due in the same second. An alarm can be held by at most one wheel at a time.
+ *
+ * Not thread-safe; AlarmMonitor guards it with its lock.
+ */
+class AlarmTimerWheel {
+public:
+    AlarmTimerWheel();
+    ~AlarmTimerWheel();
+
+    /** Adds the alarm. If alarm is nullptr or already in a wheel, does nothing. */
+    void push(const sp<const InternalAlarm>& alarm);
+
+    /**
+     * Removes the alarm. If not present or alarm is nullptr, does nothing.
+     * Returns true if the alarm had been present (and is now removed), else false.
+     */
+    bool remove(const sp<const InternalAlarm>& alarm);
+
+    /**
+     * Removes all alarms whose timestamp <= the given timestampSec and inserts them into
+     * poppedAlarms.
+     */
+    void popSoonerThan(uint32_t timestampSec,
+                       std::unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>>&
+                               poppedAlarms);
+
+    /** Returns the timestamp of the soonest alarm, or 0 if the wheel is empty. */
+    uint32_t getSoonestTimestampSec();
+
+    /** Returns the number of alarms in the wheel. */
+    size_t size() const {
+        return mSize;
+    }
+
+    /** Returns true iff the wheel holds no alarms. */
+    bool empty() const {
+        return mSize == 0;
+    }
+
+    /** Value of InternalAlarm::wheelIndex for alarms that are not in a wheel. */
+    static const uint32_t kNotInWheel = UINT32_MAX;
+
+private:
+    static const int kBitsPerLevel = 8;
+    static const int kNumLevels = 32 / kBitsPerLevel;
+    static const int kNumSlots = 1 << kBitsPerLevel;
+    static const int kBitmapWords = kNumSlots / 64;
+
+    /** Stores the alarm in the slot matching its timestamp, relative to mCurrentSec. */
+    void place(const sp<const InternalAlarm>& alarm);
+
+    /**
+     * Advances the wheel to the start of the given higher level slot, and spreads its alarms over
+     * the lower levels. No alarm may be due before the slot.
+     */
+    void cascade(int level, int slot);
+
+    /** Removes the alarm at the given position, moving the last alarm of the slot into it. */
+    void removeAt(int level, int slot, size_t index);
+
+    /**
+     * Finds the slot holding the soonest alarms. Returns false if the wheel is empty.
+     * Level 0 alarms are always sooner than higher level ones, and within a level the occupied
+     * slots are never behind the current time, so the first occupied slot is the soonest.
+     */
+    bool findSoonestSlot(int* level, int* slot) const;
+
+    /** Returns the first second covered by the given slot. */
+    uint32_t getSlotStartSec(int level, int slot) const;
+
+    std::vector<sp<const InternalAlarm>> mSlots[kNumLevels][kNumSlots];
+
+    // Bitmap of the non-empty slots of each level.
+    uint64_t mOccupied[kNumLevels][kBitmapWords];
+
+    // Time up to which the wheel has advanced. Alarms added with an earlier timestamp are stored
+    // as if they were due at mCurrentSec.
+    uint32_t mCurrentSec;
+
+    size_t mSize;
+
+    // Cached result of getSoonestTimestampSec(), valid if mSoonestSecValid is true.
+    uint32_t mSoonestSec;
+    bool mSoonestSecValid;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -50,10 +50,8 @@ void AnomalyTracker::onConfigUpdated() {
 
 void AnomalyTracker::resetStorage() {
     VLOG("resetStorage() called.");
-    mPastBuckets.clear();
-    // Excludes the current bucket.
-    mPastBuckets.resize(mNumOfPastBuckets);
-    mSumOverPastBuckets.clear();
+    mPastBucketValues.clear();
+    mDimensionsInPastBuckets.assign(mNumOfPastBuckets, {});
 }
 
 size_t AnomalyTracker::index(int64_t bucketNum) const {
@@ -80,12 +78,8 @@ void AnomalyTracker::advanceMostRecentBucketTo(const int64_t& bucketNum) {
         return;
     }
 
-    // Clear out space by emptying out old mPastBuckets[i] values and update mSumOverPastBuckets.
-    for (int64_t i = mMostRecentBucketNum + 1; i <= bucketNum; i++) {
-        const int idx = index(i);
-        subtractBucketFromSum(mPastBuckets[idx]);
-        mPastBuckets[idx] = nullptr;  // release (but not clear) the old bucket.
-    }
+    // Clear out space by emptying out the ring entries that the new buckets reuse.
+    clearPastBuckets(mMostRecentBucketNum + 1, bucketNum);
     mMostRecentBucketNum = bucketNum;
 }
 
@@ -98,25 +92,11 @@ void AnomalyTracker::addPastBucket(const MetricDimensionKey& key,
         return;
     }
 
-    const int bucketIndex = index(bucketNum);
-    if (bucketNum <= mMostRecentBucketNum && (mPastBuckets[bucketIndex] != nullptr)) {
-        // We need to insert into an already existing past bucket.
-        std::shared_ptr<DimToValMap>& bucket = mPastBuckets[bucketIndex];
-        auto itr = bucket->find(key);
-        if (itr != bucket->end()) {
-            // Old entry already exists; update it.
-            subtractValueFromSum(key, itr->second);
-            itr->second = bucketValue;
-        } else {
-            bucket->insert({key, bucketValue});
-        }
-        mSumOverPastBuckets[key] += bucketValue;
-    } else {
-        // Bucket does not exist yet (in future or was never made), so we must make it.
-        std::shared_ptr<DimToValMap> bucket = std::make_shared<DimToValMap>();
-        bucket->insert({key, bucketValue});
-        addPastBucket(bucket, bucketNum);
+    if (bucketNum > mMostRecentBucketNum) {
+        // Clear space for the new bucket to be at bucketNum.
+        advanceMostRecentBucketTo(bucketNum);
     }
+    setPastBucketValue(key, index(bucketNum), bucketValue);
 }
 
 void AnomalyTracker::addPastBucket(std::shared_ptr<DimToValMap> bucket,
@@ -129,44 +109,59 @@ void AnomalyTracker::addPastBucket(std::shared_ptr<DimToValMap> bucket,
 
     if (bucketNum <= mMostRecentBucketNum) {
         // We are updating an old bucket, not adding a new one.
-        subtractBucketFromSum(mPastBuckets[index(bucketNum)]);
+        clearPastBuckets(bucketNum, bucketNum);
     } else {
         // Clear space for the new bucket to be at bucketNum.
         advanceMostRecentBucketTo(bucketNum);
     }
-    mPastBuckets[index(bucketNum)] = bucket;
-    addBucketToSum(bucket);
-}
-
-void AnomalyTracker::subtractBucketFromSum(const shared_ptr<DimToValMap>& bucket) {
     if (bucket == nullptr) {
         return;
     }
-    for (const auto& keyValuePair : *bucket) {
-        subtractValueFromSum(keyValuePair.first, keyValuePair.second);
+    const size_t bucketIndex = index(bucketNum);
+    for (const auto& [key, bucketValue] : *bucket) {
+        setPastBucketValue(key, bucketIndex, bucketValue);
     }
 }
 
-
-void AnomalyTracker::subtractValueFromSum(const MetricDimensionKey& key,
-                                          const int64_t& bucketValue) {
-    auto itr = mSumOverPastBuckets.find(key);
-    if (itr == mSumOverPastBuckets.end()) {
-        return;
+void AnomalyTracker::setPastBucketValue(const MetricDimensionKey& key, size_t bucketIndex,
+                                        const int64_t& bucketValue) {
+    auto itr = mPastBucketValues.find(key);
+    if (itr == mPastBucketValues.end()) {
+        if (bucketValue == 0) {
+            return;
+        }
+        itr = mPastBucketValues.emplace(key, PastBucketValues(mNumOfPastBuckets)).first;
+    }
+    PastBucketValues& pastValues = itr->second;
+    int64_t& value = pastValues.values[bucketIndex];
+    if (bucketValue == 0) {
+        mDimensionsInPastBuckets[bucketIndex].erase(key);
+    } else if (value == 0) {
+        mDimensionsInPastBuckets[bucketIndex].insert(key);
     }
-    itr->second -= bucketValue;
-    if (itr->second == 0) {
-        mSumOverPastBuckets.erase(itr);
+    pastValues.numNonZeroValues += (bucketValue != 0) - (value != 0);
+    pastValues.sum += bucketValue - value;
+    value = bucketValue;
+    if (pastValues.numNonZeroValues == 0) {
+        mPastBucketValues.erase(itr);
     }
 }
 
-void AnomalyTracker::addBucketToSum(const shared_ptr<DimToValMap>& bucket) {
-    if (bucket == nullptr) {
-        return;
-    }
-    // For each dimension present in the bucket, add its value to its corresponding sum.
-    for (const auto& keyValuePair : *bucket) {
-        mSumOverPastBuckets[keyValuePair.first] += keyValuePair.second;
+void AnomalyTracker::clearPastBuckets(const int64_t& firstBucketNum,
+                                      const int64_t& lastBucketNum) {
+    for (int64_t i = firstBucketNum; i <= lastBucketNum; i++) {
+        const size_t bucketIndex = index(i);
+        for (const MetricDimensionKey& key : mDimensionsInPastBuckets[bucketIndex]) {
+            auto itr = mPastBucketValues.find(key);
+            PastBucketValues& pastValues = itr->second;
+            pastValues.sum -= pastValues.values[bucketIndex];
+            pastValues.numNonZeroValues--;
+            pastValues.values[bucketIndex] = 0;
+            if (pastValues.numNonZeroValues == 0) {
+                mPastBucketValues.erase(itr);
+            }
+        }
+        mDimensionsInPastBuckets[bucketIndex].clear();
     }
 }
 
@@ -178,18 +173,14 @@ int64_t AnomalyTracker::getPastBucketValue(const MetricDimensionKey& key,
         return 0;
     }
 
-    const auto& bucket = mPastBuckets[index(bucketNum)];
-    if (bucket == nullptr) {
-        return 0;
-    }
-    const auto& itr = bucket->find(key);
-    return itr == bucket->end() ? 0 : itr->second;
+    const auto& itr = mPastBucketValues.find(key);
+    return itr == mPastBucketValues.end() ? 0 : itr->second.values[index(bucketNum)];
 }
 
 int64_t AnomalyTracker::getSumOverPastBuckets(const MetricDimensionKey& key) const {
-    const auto& itr = mSumOverPastBuckets.find(key);
-    if (itr != mSumOverPastBuckets.end()) {
-        return itr->second;
+    const auto& itr = mPastBucketValues.find(key);
+    if (itr != mPastBucketValues.end()) {
+        return itr->second.sum;
     }
     return 0;
 }
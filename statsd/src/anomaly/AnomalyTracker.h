@@ -20,6 +20,9 @@
 #include <stdlib.h>
 #include <utils/RefBase.h>
 
+#include <unordered_set>
+#include <vector>
+
 #include "AlarmMonitor.h"
 #include "config/ConfigKey.h"
 #include "guardrail/StatsdStats.h"
@@ -170,13 +173,29 @@ protected:
     // for the anomaly detection (since the current bucket is not in the past).
     const int mNumOfPastBuckets;
 
-    // Values for each of the past mNumOfPastBuckets buckets. Always of size mNumOfPastBuckets.
-    // mPastBuckets[i] can be null, meaning that no data is present in that bucket.
-    std::vector<shared_ptr<DimToValMap>> mPastBuckets;
+    // Values of the past buckets of a single dimension.
+    struct PastBucketValues {
+        explicit PastBucketValues(int numOfPastBuckets) : values(numOfPastBuckets, 0) {
+        }
+
+        // Ring of the values of the past mNumOfPastBuckets buckets. The value for bucketNum is
+        // at values[index(bucketNum)].
+        std::vector<int64_t> values;
+
+        // Sum of values, maintained as values are set.
+        int64_t sum = 0;
 
-    // Cached sum over all existing buckets in mPastBuckets.
-    // Its buckets never contain entries of 0.
-    DimToValMap mSumOverPastBuckets;
+        // Number of non-zero entries in values.
+        int numNonZeroValues = 0;
+    };
+
+    // Past bucket values of each dimension. A dimension is evicted once all of its past bucket
+    // values are 0, so it never contains entries with only 0s.
+    unordered_map<MetricDimensionKey, PastBucketValues> mPastBucketValues;
+
+    // Dimensions with a non-zero value at each index of the rings of mPastBucketValues, so that
+    // clearing a bucket only visits the dimensions that have a value in it.
+    std::vector<std::unordered_set<MetricDimensionKey>> mDimensionsInPastBuckets;
 
     // The bucket number of the last added bucket.
     int64_t mMostRecentBucketNum = -1;
@@ -192,15 +211,14 @@ protected:
     //   [mMostRecentBucketNum - mNumOfPastBuckets + 1, bucketNum - mNumOfPastBuckets].
     void advanceMostRecentBucketTo(const int64_t& bucketNum);
 
-    // Add the information in the given bucket to mSumOverPastBuckets.
-    void addBucketToSum(const shared_ptr<DimToValMap>& bucket);
-
-    // Subtract the information in the given bucket from mSumOverPastBuckets
-    // and remove any items with value 0.
-    void subtractBucketFromSum(const shared_ptr<DimToValMap>& bucket);
+    // Sets the value of key at the given ring index of mPastBucketValues, updating its sum and
+    // evicting the dimension if all of its values are now 0.
+    void setPastBucketValue(const MetricDimensionKey& key, size_t bucketIndex,
+                            const int64_t& bucketValue);
 
-    // From mSumOverPastBuckets[key], subtracts bucketValue, removing it if it is now 0.
-    void subtractValueFromSum(const MetricDimensionKey& key, const int64_t& bucketValue);
+    // Sets the values of all dimensions for the buckets [firstBucketNum, lastBucketNum] to 0,
+    // evicting the dimensions that have no values left.
+    void clearPastBuckets(const int64_t& firstBucketNum, const int64_t& lastBucketNum);
 
     // Returns true if in the refractory period, else false.
     bool isInRefractoryPeriod(const int64_t& timestampNs, const MetricDimensionKey& key) const;
@@ -217,6 +235,7 @@ protected:
 
     FRIEND_TEST(AnomalyTrackerTest, TestConsecutiveBuckets);
     FRIEND_TEST(AnomalyTrackerTest, TestSparseBuckets);
+    FRIEND_TEST(AnomalyTrackerTest, TestReplacePastBucketValues);
     FRIEND_TEST(CountMetricProducerTest, TestAnomalyDetectionUnSliced);
     FRIEND_TEST(AnomalyDurationDetectionE2eTest, TestDurationMetric_SUM_single_bucket);
     FRIEND_TEST(AnomalyDurationDetectionE2eTest, TestDurationMetric_SUM_partial_bucket);
@@ -24,6 +24,7 @@
 #include <utils/RefBase.h>
 
 #include <unordered_map>
+#include <unordered_set>
 
 namespace android {
 namespace os {
@@ -111,6 +112,12 @@ public:
             const bool isPartialLink,
             std::vector<ConditionState>& conditionCache) const = 0;
 
+    // Returns the indices of the conditions that this ConditionTracker combines.
+    virtual const std::vector<int>& getChildren() const {
+        static const std::vector<int> kNoChildren;
+        return kNoChildren;
+    }
+
     // return the list of AtomMatchingTracker index that this ConditionTracker uses.
     virtual const std::set<int>& getAtomMatchingTrackerIndex() const {
         return mTrackerIndex;
@@ -124,9 +131,9 @@ public:
         return mSliced;
     }
 
-    virtual const std::set<HashableDimensionKey>* getChangedToTrueDimensions(
+    virtual const std::unordered_set<HashableDimensionKey>* getChangedToTrueDimensions(
             const std::vector<sp<ConditionTracker>>& allConditions) const = 0;
-    virtual const std::set<HashableDimensionKey>* getChangedToFalseDimensions(
+    virtual const std::unordered_set<HashableDimensionKey>* getChangedToFalseDimensions(
             const std::vector<sp<ConditionTracker>>& allConditions) const = 0;
 
     inline int64_t getConditionId() const {
@@ -137,7 +144,7 @@ public:
         return mProtoHash;
     }
 
-    virtual const std::map<HashableDimensionKey, int>* getSlicedDimensionMap(
+    virtual const std::unordered_map<HashableDimensionKey, int>* getSlicedDimensionMap(
             const std::vector<sp<ConditionTracker>>& allConditions) const = 0;
 
     virtual bool IsChangedDimensionTrackable() const = 0;
@@ -19,6 +19,7 @@ namespace android {
 namespace os {
 namespace statsd {
 
+using std::unordered_set;
 using std::vector;
 
 ConditionState ConditionWizard::query(const int index, const ConditionKey& parameters,
@@ -31,12 +32,12 @@ ConditionState ConditionWizard::query(const int index, const ConditionKey& param
     return cache[index];
 }
 
-const set<HashableDimensionKey>* ConditionWizard::getChangedToTrueDimensions(
+const unordered_set<HashableDimensionKey>* ConditionWizard::getChangedToTrueDimensions(
         const int index) const {
     return mAllConditions[index]->getChangedToTrueDimensions(mAllConditions);
 }
 
-const set<HashableDimensionKey>* ConditionWizard::getChangedToFalseDimensions(
+const unordered_set<HashableDimensionKey>* ConditionWizard::getChangedToFalseDimensions(
         const int index) const {
     return mAllConditions[index]->getChangedToFalseDimensions(mAllConditions);
 }
@@ -42,8 +42,9 @@ public:
     virtual ConditionState query(const int conditionIndex, const ConditionKey& conditionParameters,
                                  const bool isPartialLink);
 
-    virtual const std::set<HashableDimensionKey>* getChangedToTrueDimensions(const int index) const;
-    virtual const std::set<HashableDimensionKey>* getChangedToFalseDimensions(
+    virtual const std::unordered_set<HashableDimensionKey>* getChangedToTrueDimensions(
+            const int index) const;
+    virtual const std::unordered_set<HashableDimensionKey>* getChangedToFalseDimensions(
             const int index) const;
     bool equalOutputDimensions(const int index, const vector<Matcher>& dimensions);
 
@@ -54,7 +55,8 @@ public:
         return mAllConditions[index]->getUnSlicedPartConditionState();
     }
 
-    const std::map<HashableDimensionKey, int>* getSlicedDimensionMap(const int index) const {
+    const std::unordered_map<HashableDimensionKey, int>* getSlicedDimensionMap(
+            const int index) const {
         return mAllConditions[index]->getSlicedDimensionMap(mAllConditions);
     }
 
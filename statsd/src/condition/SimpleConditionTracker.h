@@ -58,7 +58,7 @@ public:
                         const bool isPartialLink,
                         std::vector<ConditionState>& conditionCache) const override;
 
-    virtual const std::set<HashableDimensionKey>* getChangedToTrueDimensions(
+    virtual const std::unordered_set<HashableDimensionKey>* getChangedToTrueDimensions(
             const std::vector<sp<ConditionTracker>>& allConditions) const {
         if (mSliced) {
             return &mLastChangedToTrueDimensions;
@@ -67,7 +67,7 @@ public:
         }
     }
 
-    virtual const std::set<HashableDimensionKey>* getChangedToFalseDimensions(
+    virtual const std::unordered_set<HashableDimensionKey>* getChangedToFalseDimensions(
             const std::vector<sp<ConditionTracker>>& allConditions) const {
         if (mSliced) {
             return &mLastChangedToFalseDimensions;
@@ -76,7 +76,7 @@ public:
         }
     }
 
-    const std::map<HashableDimensionKey, int>* getSlicedDimensionMap(
+    const std::unordered_map<HashableDimensionKey, int>* getSlicedDimensionMap(
             const std::vector<sp<ConditionTracker>>& allConditions) const override {
         return &mSlicedConditionState;
     }
@@ -111,10 +111,10 @@ private:
 
     bool mContainANYPositionInInternalDimensions;
 
-    std::set<HashableDimensionKey> mLastChangedToTrueDimensions;
-    std::set<HashableDimensionKey> mLastChangedToFalseDimensions;
+    std::unordered_set<HashableDimensionKey> mLastChangedToTrueDimensions;
+    std::unordered_set<HashableDimensionKey> mLastChangedToFalseDimensions;
 
-    std::map<HashableDimensionKey, int> mSlicedConditionState;
+    std::unordered_map<HashableDimensionKey, int> mSlicedConditionState;
 
     void setMatcherIndices(const SimplePredicate& predicate,
                            const std::unordered_map<int64_t, int>& logTrackerMap);
@@ -99,6 +99,72 @@ ConditionState convertInitialValue(const SimplePredicate_InitialValue& initialVa
             return ConditionState::kUnknown;
     }
 }
+
+namespace {
+
+void appendInTopologicalOrder(const int conditionIndex,
+                              const std::vector<std::vector<int>>& conditionChildren,
+                              std::vector<bool>& visited, std::vector<int>& order) {
+    if (visited[conditionIndex]) {
+        return;
+    }
+    visited[conditionIndex] = true;
+    for (const int childIndex : conditionChildren[conditionIndex]) {
+        appendInTopologicalOrder(childIndex, conditionChildren, visited, order);
+    }
+    order.push_back(conditionIndex);
+}
+
+}  // namespace
+
+ConditionEvaluationPlan createConditionEvaluationPlan(
+        const std::vector<std::vector<int>>& conditionChildren,
+        const std::unordered_map<int, std::vector<int>>& trackerToConditionMap,
+        const int atomMatchingTrackerCount) {
+    const int conditionCount = conditionChildren.size();
+    const int words = (conditionCount + 63) / 64;
+    ConditionEvaluationPlan plan;
+
+    // The config has been validated, so the conditions form a DAG.
+    std::vector<bool> visited(conditionCount, false);
+    plan.order.reserve(conditionCount);
+    for (int i = 0; i < conditionCount; i++) {
+        appendInTopologicalOrder(i, conditionChildren, visited, plan.order);
+    }
+
+    // Cone of each condition: the condition itself and all its descendants. Children come first
+    // in the order, so their cones are complete when their parents are reached.
+    std::vector<std::vector<uint64_t>> conditionCones(conditionCount,
+                                                      std::vector<uint64_t>(words, 0));
+    for (int pos = 0; pos < conditionCount; pos++) {
+        const int conditionIndex = plan.order[pos];
+        std::vector<uint64_t>& cone = conditionCones[conditionIndex];
+        cone[pos / 64] |= uint64_t{1} << (pos % 64);
+        for (const int childIndex : conditionChildren[conditionIndex]) {
+            const std::vector<uint64_t>& childCone = conditionCones[childIndex];
+            for (int w = 0; w < words; w++) {
+                cone[w] |= childCone[w];
+            }
+        }
+    }
+
+    plan.matcherConditionCones.resize(atomMatchingTrackerCount);
+    for (const auto& [trackerIndex, conditionList] : trackerToConditionMap) {
+        if (trackerIndex < 0 || trackerIndex >= atomMatchingTrackerCount) {
+            continue;
+        }
+        std::vector<uint64_t>& matcherCone = plan.matcherConditionCones[trackerIndex];
+        matcherCone.assign(words, 0);
+        for (const int conditionIndex : conditionList) {
+            const std::vector<uint64_t>& cone = conditionCones[conditionIndex];
+            for (int w = 0; w < words; w++) {
+                matcherCone[w] |= cone[w];
+            }
+        }
+    }
+    return plan;
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
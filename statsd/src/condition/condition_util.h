@@ -17,6 +17,7 @@
 #ifndef CONDITION_UTIL_H
 #define CONDITION_UTIL_H
 
+#include <unordered_map>
 #include <vector>
 #include "../matchers/matcher_util.h"
 #include "src/statsd_config.pb.h"
@@ -39,6 +40,27 @@ ConditionState evaluateCombinationCondition(const std::vector<int>& children,
                                             const std::vector<ConditionState>& conditionCache);
 
 ConditionState convertInitialValue(const SimplePredicate_InitialValue& initialValue);
+
+// Order in which the ConditionTrackers of a config are evaluated for an event, computed when the
+// config is loaded.
+struct ConditionEvaluationPlan {
+    // Condition indices in topological order: every condition comes after its children, so a
+    // combination condition never needs to evaluate its children itself.
+    std::vector<int> order;
+
+    // For each AtomMatchingTracker index, a bitset over the positions in order of the conditions
+    // to evaluate when the matcher matches: the conditions that use the matcher, and all their
+    // descendants. Empty if no condition uses the matcher.
+    std::vector<std::vector<uint64_t>> matcherConditionCones;
+};
+
+// Compiles the evaluation plan of a condition DAG.
+// conditionChildren: the child condition indices of each condition.
+// trackerToConditionMap: the conditions that use each AtomMatchingTracker.
+ConditionEvaluationPlan createConditionEvaluationPlan(
+        const std::vector<std::vector<int>>& conditionChildren,
+        const std::unordered_map<int, std::vector<int>>& trackerToConditionMap,
+        const int atomMatchingTrackerCount);
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
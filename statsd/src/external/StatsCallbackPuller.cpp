@@ -35,6 +35,24 @@ namespace android {
 namespace os {
 namespace statsd {
 
+void parsePulledEvents(const vector<StatsEventParcel>& parcels,
+                       vector<shared_ptr<LogEvent>>* data) {
+    shared_ptr<vector<LogEvent>> batch = make_shared<vector<LogEvent>>();
+    // The events must not be moved once parsed, so reserve the space for all of them.
+    batch->reserve(parcels.size());
+    for (const StatsEventParcel& parcel : parcels) {
+        LogEvent& event = batch->emplace_back(/*uid=*/-1, /*pid=*/-1);
+        if (!event.parseBuffer((uint8_t*)parcel.buffer.data(), parcel.buffer.size())) {
+            StatsdStats::getInstance().noteAtomError(event.GetTagId(), /*pull=*/true);
+            batch->pop_back();
+        }
+    }
+    data->reserve(data->size() + batch->size());
+    for (LogEvent& event : *batch) {
+        data->push_back(shared_ptr<LogEvent>(batch, &event));
+    }
+}
+
 StatsCallbackPuller::StatsCallbackPuller(int tagId, const shared_ptr<IPullAtomCallback>& callback,
                                          const int64_t coolDownNs, int64_t timeoutNs,
                                          const vector<int> additiveFields)
@@ -65,17 +83,7 @@ PullErrorCode StatsCallbackPuller::PullInternal(vector<shared_ptr<LogEvent>>* da
                 // data (the output param) if the pointer is in scope and the pull did not time out.
                 {
                     lock_guard<mutex> lk(*cv_mutex);
-                    for (const StatsEventParcel& parcel: output) {
-                        shared_ptr<LogEvent> event = make_shared<LogEvent>(/*uid=*/-1, /*pid=*/-1);
-                        bool valid = event->parseBuffer((uint8_t*)parcel.buffer.data(),
-                                                        parcel.buffer.size());
-                        if (valid) {
-                            sharedData->push_back(event);
-                        } else {
-                            StatsdStats::getInstance().noteAtomError(event->GetTagId(),
-                                                                     /*pull=*/true);
-                        }
-                    }
+                    parsePulledEvents(output, sharedData.get());
                     *pullSuccess = success;
                     *pullFinish = true;
                 }
@@ -17,15 +17,24 @@
 #pragma once
 
 #include <aidl/android/os/IPullAtomCallback.h>
+#include <aidl/android/util/StatsEventParcel.h>
 #include "StatsPuller.h"
 
 using aidl::android::os::IPullAtomCallback;
+using aidl::android::util::StatsEventParcel;
 using std::shared_ptr;
 
 namespace android {
 namespace os {
 namespace statsd {
 
+// Parses the pulled parcels into one contiguous batch of events and appends them to data. The
+// appended pointers share the ownership of the batch, which is freed with the last of them, so
+// that a pull costs one allocation for all of its events instead of one per event. Invalid
+// events are dropped.
+void parsePulledEvents(const std::vector<StatsEventParcel>& parcels,
+                       std::vector<shared_ptr<LogEvent>>* data);
+
 class StatsCallbackPuller : public StatsPuller {
 public:
     explicit StatsCallbackPuller(int tagId, const shared_ptr<IPullAtomCallback>& callback,
@@ -38,6 +47,7 @@ private:
 
     FRIEND_TEST(StatsCallbackPullerTest, PullFail);
     FRIEND_TEST(StatsCallbackPullerTest, PullSuccess);
+    FRIEND_TEST(StatsCallbackPullerTest, PullSuccessMultipleEvents);
     FRIEND_TEST(StatsCallbackPullerTest, PullTimeout);
 };
 
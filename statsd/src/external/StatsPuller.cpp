@@ -39,18 +39,38 @@ StatsPuller::StatsPuller(const int tagId, const int64_t coolDownNs, const int64_
       mCoolDownNs(coolDownNs),
       mAdditiveFields(additiveFields),
       mLastPullTimeNs(0),
-      mLastEventTimeNs(0) {
+      mLastEventTimeNs(0),
+      mPullInFlight(false),
+      mCacheGeneration(0) {
 }
 
 PullErrorCode StatsPuller::Pull(const int64_t eventTimeNs,
                                 std::vector<std::shared_ptr<LogEvent>>* data) {
-    lock_guard<std::mutex> lock(mLock);
-    const int64_t elapsedTimeNs = getElapsedRealtimeNs();
-    const int64_t systemUptimeMillis = getSystemUptimeMillis();
+    std::unique_lock<std::mutex> lock(mLock);
+    int64_t elapsedTimeNs = getElapsedRealtimeNs();
     StatsdStats::getInstance().notePull(mTagId);
-    const bool shouldUseCache =
-            (mLastEventTimeNs == eventTimeNs) || (elapsedTimeNs - mLastPullTimeNs < mCoolDownNs);
-    if (shouldUseCache) {
+    auto isInCacheWindow = [&]() {
+        return (mLastEventTimeNs == eventTimeNs) || (elapsedTimeNs - mLastPullTimeNs < mCoolDownNs);
+    };
+    // A pull that is in flight was started at mLastPullTimeNs for mLastEventTimeNs. Requests in
+    // its window share its result, unless the cache is cleared before it finishes. Other requests
+    // wait for it to finish before pulling.
+    while (true) {
+        while (mPullInFlight && !isInCacheWindow()) {
+            mPullFinishedCv.wait(lock);
+        }
+        if (!isInCacheWindow()) {
+            break;
+        }
+        if (mPullInFlight) {
+            const int64_t cacheGeneration = mCacheGeneration;
+            StatsdStats::getInstance().notePullCoalesced(mTagId);
+            mPullFinishedCv.wait(lock, [this] { return !mPullInFlight; });
+            if (cacheGeneration != mCacheGeneration) {
+                // The data of that pull was not cached, so pull again.
+                continue;
+            }
+        }
         if (mHasGoodData) {
             (*data) = mCachedData;
             StatsdStats::getInstance().notePullFromCache(mTagId);
@@ -58,44 +78,61 @@ PullErrorCode StatsPuller::Pull(const int64_t eventTimeNs,
         }
         return mHasGoodData ? PULL_SUCCESS : PULL_FAIL;
     }
+    // Time spent waiting for another pull does not count towards this one.
+    elapsedTimeNs = getElapsedRealtimeNs();
+    const int64_t systemUptimeMillis = getSystemUptimeMillis();
     if (mLastPullTimeNs > 0) {
         StatsdStats::getInstance().updateMinPullIntervalSec(
                 mTagId, (elapsedTimeNs - mLastPullTimeNs) / NS_PER_SEC);
     }
     mCachedData.clear();
+    mHasGoodData = false;
     mLastPullTimeNs = elapsedTimeNs;
     mLastEventTimeNs = eventTimeNs;
-    PullErrorCode status = PullInternal(&mCachedData);
-    mHasGoodData = (status == PULL_SUCCESS);
-    if (!mHasGoodData) {
-        return status;
-    }
-    const int64_t pullElapsedDurationNs = getElapsedRealtimeNs() - elapsedTimeNs;
-    const int64_t pullSystemUptimeDurationMillis = getSystemUptimeMillis() - systemUptimeMillis;
-    StatsdStats::getInstance().notePullTime(mTagId, pullElapsedDurationNs);
-    const bool pullTimeOut = pullElapsedDurationNs > mPullTimeoutNs;
-    if (pullTimeOut) {
-        // Something went wrong. Discard the data.
-        mCachedData.clear();
-        mHasGoodData = false;
-        StatsdStats::getInstance().notePullTimeout(
-                mTagId, pullSystemUptimeDurationMillis, NanoToMillis(pullElapsedDurationNs));
-        ALOGW("Pull for atom %d exceeds timeout %lld nano seconds.", mTagId,
-              (long long)pullElapsedDurationNs);
-        return PULL_FAIL;
+    mPullInFlight = true;
+    const int64_t cacheGeneration = mCacheGeneration;
+
+    // The lock is not held while pulling so that concurrent requests can join this pull.
+    lock.unlock();
+    std::vector<std::shared_ptr<LogEvent>> pulledData;
+    PullErrorCode status = PullInternal(&pulledData);
+    if (status == PULL_SUCCESS) {
+        const int64_t pullElapsedDurationNs = getElapsedRealtimeNs() - elapsedTimeNs;
+        const int64_t pullSystemUptimeDurationMillis =
+                getSystemUptimeMillis() - systemUptimeMillis;
+        StatsdStats::getInstance().notePullTime(mTagId, pullElapsedDurationNs);
+        const bool pullTimeOut = pullElapsedDurationNs > mPullTimeoutNs;
+        if (pullTimeOut) {
+            // Something went wrong. Discard the data.
+            pulledData.clear();
+            StatsdStats::getInstance().notePullTimeout(
+                    mTagId, pullSystemUptimeDurationMillis, NanoToMillis(pullElapsedDurationNs));
+            ALOGW("Pull for atom %d exceeds timeout %lld nano seconds.", mTagId,
+                  (long long)pullElapsedDurationNs);
+            status = PULL_FAIL;
+        }
     }
+    if (status == PULL_SUCCESS) {
+        if (pulledData.size() > 0) {
+            mapAndMergeIsolatedUidsToHostUid(pulledData, mUidMap, mTagId, mAdditiveFields);
+        }
 
-    if (mCachedData.size() > 0) {
-        mapAndMergeIsolatedUidsToHostUid(mCachedData, mUidMap, mTagId, mAdditiveFields);
+        if (pulledData.empty()) {
+            VLOG("Data pulled is empty");
+            StatsdStats::getInstance().noteEmptyData(mTagId);
+        }
+        (*data) = pulledData;
     }
+    lock.lock();
 
-    if (mCachedData.empty()) {
-        VLOG("Data pulled is empty");
-        StatsdStats::getInstance().noteEmptyData(mTagId);
+    // If the cache was cleared while pulling, the data is returned but not cached.
+    if (cacheGeneration == mCacheGeneration) {
+        mCachedData = std::move(pulledData);
+        mHasGoodData = (status == PULL_SUCCESS);
     }
-
-    (*data) = mCachedData;
-    return PULL_SUCCESS;
+    mPullInFlight = false;
+    mPullFinishedCv.notify_all();
+    return status;
 }
 
 int StatsPuller::ForceClearCache() {
@@ -112,6 +149,8 @@ int StatsPuller::clearCacheLocked() {
     mCachedData.clear();
     mLastPullTimeNs = 0;
     mLastEventTimeNs = 0;
+    mHasGoodData = false;
+    mCacheGeneration++;
     return ret;
 }
 
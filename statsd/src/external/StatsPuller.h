@@ -18,6 +18,7 @@
 
 #include <aidl/android/os/IStatsCompanionService.h>
 #include <utils/RefBase.h>
+#include <condition_variable>
 #include <mutex>
 #include <vector>
 #include "packages/UidMap.h"
@@ -50,7 +51,7 @@ public:
 
     // Pulls the most recent data.
     // The data may be served from cache if consecutive pulls come within
-    // predefined cooldown time.
+    // predefined cooldown time. Concurrent requests within that window share a single pull.
     // Returns PULL_SUCCESS if the pull was successful.
     // Returns PULL_DEAD_OBJECT if a dead object exception occurred when making a pull.
     // Returns PULL_FAIL when
@@ -114,6 +115,16 @@ private:
     //   3) clearCache is called.
     std::vector<std::shared_ptr<LogEvent>> mCachedData;
 
+    // True while PullInternal runs. mLock is released during the pull so that requests that
+    // come in meanwhile wait on mPullFinishedCv and share its result instead of pulling again.
+    bool mPullInFlight;
+
+    std::condition_variable mPullFinishedCv;
+
+    // Incremented when the cache is cleared, so that a pull that was in flight at the time does
+    // not cache its data and requests that were sharing it pull again.
+    int64_t mCacheGeneration;
+
     int clearCache();
 
     int clearCacheLocked();
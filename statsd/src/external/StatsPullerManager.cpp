@@ -24,6 +24,8 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
 
 #include "../StatsService.h"
@@ -49,24 +51,53 @@ StatsPullerManager::StatsPullerManager()
               // TrainInfo.
               {{.uid = AID_STATSD, .atomTag = util::TRAIN_INFO}, new TrainInfoPuller()},
       }),
-      mNextPullTimeNs(NO_ALARM_UPDATE) {
+      mNextPullTimeNs(NO_ALARM_UPDATE),
+      mPullWorkers(kMaxConcurrentPulls) {
 }
 
 bool StatsPullerManager::Pull(int tagId, const ConfigKey& configKey, const int64_t eventTimeNs,
                               vector<shared_ptr<LogEvent>>* data) {
-    std::lock_guard<std::mutex> _l(mLock);
-    return PullLocked(tagId, configKey, eventTimeNs, data);
+    vector<int32_t> uids;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        if (!getPullAtomUidsLocked(tagId, configKey, &uids)) {
+            return false;
+        }
+    }
+    return PullFromUids(tagId, uids, eventTimeNs, data);
 }
 
 bool StatsPullerManager::Pull(int tagId, const vector<int32_t>& uids, const int64_t eventTimeNs,
                               vector<std::shared_ptr<LogEvent>>* data) {
+    return PullFromUids(tagId, uids, eventTimeNs, data);
+}
+
+bool StatsPullerManager::PullFromUids(int tagId, const vector<int32_t>& uids,
+                                      const int64_t eventTimeNs,
+                                      vector<shared_ptr<LogEvent>>* data) {
+    VLOG("Initiating pulling %d", tagId);
+    int pullerUid;
+    sp<StatsPuller> puller;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        const auto pullerIt = findPullerLocked(tagId, uids);
+        if (pullerIt == kAllPullAtomInfo.end()) {
+            return false;  // Return early since we don't know what to pull.
+        }
+        pullerUid = pullerIt->first.uid;
+        puller = pullerIt->second;
+    }
+    // mLock is not held while pulling, so that requests for other atoms are not blocked by this
+    // pull, and concurrent requests for this atom from other configs, shell subscriptions or
+    // metrics can join it (see StatsPuller::Pull).
+    PullErrorCode status = puller->Pull(eventTimeNs, data);
+    VLOG("pulled %zu items", data->size());
     std::lock_guard<std::mutex> _l(mLock);
-    return PullLocked(tagId, uids, eventTimeNs, data);
+    return onPullFinishedLocked({.uid = pullerUid, .atomTag = tagId}, puller, status);
 }
 
-bool StatsPullerManager::PullLocked(int tagId, const ConfigKey& configKey,
-                                    const int64_t eventTimeNs, vector<shared_ptr<LogEvent>>* data) {
-    vector<int32_t> uids;
+bool StatsPullerManager::getPullAtomUidsLocked(int tagId, const ConfigKey& configKey,
+                                               vector<int32_t>* uids) {
     const auto& uidProviderIt = mPullUidProviders.find(configKey);
     if (uidProviderIt == mPullUidProviders.end()) {
         ALOGE("Error pulling tag %d. No pull uid provider for config key %s", tagId,
@@ -81,36 +112,42 @@ bool StatsPullerManager::PullLocked(int tagId, const ConfigKey& configKey,
         StatsdStats::getInstance().notePullUidProviderNotFound(tagId);
         return false;
     }
-    uids = pullUidProvider->getPullAtomUids(tagId);
-    return PullLocked(tagId, uids, eventTimeNs, data);
+    *uids = pullUidProvider->getPullAtomUids(tagId);
+    return true;
 }
 
-bool StatsPullerManager::PullLocked(int tagId, const vector<int32_t>& uids,
-                                    const int64_t eventTimeNs, vector<shared_ptr<LogEvent>>* data) {
-    VLOG("Initiating pulling %d", tagId);
+std::map<const PullerKey, sp<StatsPuller>>::iterator StatsPullerManager::findPullerLocked(
+        int tagId, const vector<int32_t>& uids) {
     for (int32_t uid : uids) {
         PullerKey key = {.uid = uid, .atomTag = tagId};
         auto pullerIt = kAllPullAtomInfo.find(key);
         if (pullerIt != kAllPullAtomInfo.end()) {
-            PullErrorCode status = pullerIt->second->Pull(eventTimeNs, data);
-            VLOG("pulled %zu items", data->size());
-            if (status != PULL_SUCCESS) {
-                StatsdStats::getInstance().notePullFailed(tagId);
-            }
-            // If we received a dead object exception, it means the client process has died.
-            // We can remove the puller from the map.
-            if (status == PULL_DEAD_OBJECT) {
-                StatsdStats::getInstance().notePullerCallbackRegistrationChanged(
-                        tagId,
-                        /*registered=*/false);
-                kAllPullAtomInfo.erase(pullerIt);
-            }
-            return status == PULL_SUCCESS;
+            return pullerIt;
         }
     }
     StatsdStats::getInstance().notePullerNotFound(tagId);
     ALOGW("StatsPullerManager: Unknown tagId %d", tagId);
-    return false;  // Return early since we don't know what to pull.
+    return kAllPullAtomInfo.end();
+}
+
+bool StatsPullerManager::onPullFinishedLocked(const PullerKey& pullerKey,
+                                              const sp<StatsPuller>& puller,
+                                              PullErrorCode status) {
+    if (status != PULL_SUCCESS) {
+        StatsdStats::getInstance().notePullFailed(pullerKey.atomTag);
+    }
+    // If we received a dead object exception, it means the client process has died.
+    // We can remove the puller from the map.
+    if (status == PULL_DEAD_OBJECT) {
+        auto pullerIt = kAllPullAtomInfo.find(pullerKey);
+        if (pullerIt != kAllPullAtomInfo.end() && pullerIt->second == puller) {
+            StatsdStats::getInstance().notePullerCallbackRegistrationChanged(
+                    pullerKey.atomTag,
+                    /*registered=*/false);
+            kAllPullAtomInfo.erase(pullerIt);
+        }
+    }
+    return status == PULL_SUCCESS;
 }
 
 bool StatsPullerManager::PullerForMatcherExists(int tagId) const {
@@ -134,6 +171,36 @@ void StatsPullerManager::updateAlarmLocked() {
     return;
 }
 
+int64_t StatsPullerManager::getNextPullAlarmTimeLocked() const {
+    // Next pull time and latest pull time of each receiver.
+    vector<pair<int64_t, int64_t>> pullTimesNs;
+    for (const auto& [_, receivers] : mReceivers) {
+        for (const ReceiverInfo& receiverInfo : receivers) {
+            pullTimesNs.emplace_back(receiverInfo.nextPullTimeNs,
+                                     receiverInfo.nextPullTimeNs + receiverInfo.maxBatchingDelayNs);
+        }
+    }
+    if (pullTimesNs.empty()) {
+        return NO_ALARM_UPDATE;
+    }
+    std::sort(pullTimesNs.begin(), pullTimesNs.end());
+
+    // Delay the alarm to the last receiver that is due before the latest pull time of all the
+    // receivers due before it, so that receivers with the same interval but different bucket
+    // start times share one wakeup instead of each waking the device up. The late pulls are
+    // attributed to the right buckets by the metric producers, the same way as for a late alarm.
+    int64_t nextAlarmTimeNs = pullTimesNs[0].first;
+    int64_t batchEndNs = pullTimesNs[0].second;
+    for (const auto& [nextPullTimeNs, latestPullTimeNs] : pullTimesNs) {
+        if (nextPullTimeNs > batchEndNs) {
+            break;
+        }
+        nextAlarmTimeNs = nextPullTimeNs;
+        batchEndNs = min(batchEndNs, latestPullTimeNs);
+    }
+    return nextAlarmTimeNs;
+}
+
 void StatsPullerManager::SetStatsCompanionService(
         shared_ptr<IStatsCompanionService> statsCompanionService) {
     std::lock_guard<std::mutex> _l(mLock);
@@ -149,7 +216,7 @@ void StatsPullerManager::SetStatsCompanionService(
 
 void StatsPullerManager::RegisterReceiver(int tagId, const ConfigKey& configKey,
                                           wp<PullDataReceiver> receiver, int64_t nextPullTimeNs,
-                                          int64_t intervalNs) {
+                                          int64_t intervalNs, int64_t maxPullDelayNs) {
     std::lock_guard<std::mutex> _l(mLock);
     auto& receivers = mReceivers[{.atomTag = tagId, .configKey = configKey}];
     for (auto it = receivers.begin(); it != receivers.end(); it++) {
@@ -172,12 +239,17 @@ void StatsPullerManager::RegisterReceiver(int tagId, const ConfigKey& configKey,
 
     receiverInfo.intervalNs = roundedIntervalNs;
     receiverInfo.nextPullTimeNs = nextPullTimeNs;
+    // Leave room for the pull itself, so that a delayed pull completes within the max pull delay.
+    receiverInfo.maxBatchingDelayNs =
+            std::clamp(maxPullDelayNs - kMaxTimeoutNs, (int64_t)0, kPullAlarmBatchingWindowNs);
     receivers.push_back(receiverInfo);
 
-    // There is only one alarm for all pulled events. So only set it to the smallest denom.
-    if (nextPullTimeNs < mNextPullTimeNs) {
-        VLOG("Updating next pull time %lld", (long long)mNextPullTimeNs);
-        mNextPullTimeNs = nextPullTimeNs;
+    // There is only one alarm for all pulled events. The new receiver can move it earlier, or
+    // later when it joins the batch of the next alarm.
+    const int64_t nextAlarmTimeNs = getNextPullAlarmTimeLocked();
+    if (nextAlarmTimeNs != mNextPullTimeNs) {
+        VLOG("Updating next pull time %lld", (long long)nextAlarmTimeNs);
+        mNextPullTimeNs = nextAlarmTimeNs;
         updateAlarmLocked();
     }
     VLOG("Puller for tagId %d registered of %d", tagId, (int)receivers.size());
@@ -216,83 +288,211 @@ void StatsPullerManager::UnregisterPullUidProvider(const ConfigKey& configKey,
     }
 }
 
-void StatsPullerManager::OnAlarmFired(int64_t elapsedTimeNs) {
-    std::lock_guard<std::mutex> _l(mLock);
+void StatsPullerManager::OnAlarmFired(int64_t elapsedTimeNs, std::mutex* receiversMutex) {
     int64_t wallClockNs = getWallClockNs();
-
-    int64_t minNextPullTimeNs = NO_ALARM_UPDATE;
-
-    vector<pair<const ReceiverKey*, vector<ReceiverInfo*>>> needToPull;
-    for (auto& pair : mReceivers) {
-        vector<ReceiverInfo*> receivers;
-        if (pair.second.size() != 0) {
-            for (ReceiverInfo& receiverInfo : pair.second) {
-                // If pullNecessary and enough time has passed for the next bucket, then add
-                // receiver to the list that will pull on this alarm.
-                // If pullNecessary is false, check if next pull time needs to be updated.
-                sp<PullDataReceiver> receiverPtr = receiverInfo.receiver.promote();
-                const bool pullNecessary = receiverPtr != nullptr && receiverPtr->isPullNeeded();
-                if (receiverInfo.nextPullTimeNs <= elapsedTimeNs && pullNecessary) {
-                    receivers.push_back(&receiverInfo);
-                } else {
-                    if (receiverInfo.nextPullTimeNs <= elapsedTimeNs) {
-                        receiverPtr->onDataPulled({}, PullResult::PULL_NOT_NEEDED, elapsedTimeNs);
-                        int numBucketsAhead = (elapsedTimeNs - receiverInfo.nextPullTimeNs) /
-                                              receiverInfo.intervalNs;
-                        receiverInfo.nextPullTimeNs +=
-                                (numBucketsAhead + 1) * receiverInfo.intervalNs;
+    auto lockReceivers = [receiversMutex] {
+        return receiversMutex == nullptr ? std::unique_lock<std::mutex>()
+                                         : std::unique_lock<std::mutex>(*receiversMutex);
+    };
+
+    // A slow puller must not hold back the buckets of the other pulled atoms, so pullers are
+    // pulled concurrently by the mPullWorkers threads. Receivers of the same puller are pulled
+    // one after the other by the same thread, so that all but the first pull are served from the
+    // puller cache. Results are delivered to the receivers on this thread as they complete. mLock
+    // and receiversMutex are only held to find the receivers and pullers and to deliver the
+    // results, not while pulling, so that registrations, other pulls and log events are not
+    // blocked by a slow puller.
+    struct PullTask {
+        PullerKey pullerKey;
+        sp<StatsPuller> puller;
+        // Indices in needToPull of the receivers served by this puller.
+        vector<size_t> pullIndices;
+    };
+    struct PullTaskResult {
+        size_t taskIndex;
+        size_t pullIndex;
+        PullErrorCode status;
+        vector<shared_ptr<LogEvent>> data;
+    };
+    // Shared with the pull tasks, which may still be returning after the last result is taken.
+    struct PullTaskResults {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<PullTaskResult> results;
+    };
+
+    // Receivers to pull, which are found again when the data is delivered, since they may be
+    // unregistered while pulling.
+    vector<pair<ReceiverKey, vector<wp<PullDataReceiver>>>> needToPull;
+    vector<PullTask> tasks;
+    std::map<PullerKey, size_t> pullerKeyToTaskIndex;
+    size_t numPendingPulls = 0;
+    {
+        std::unique_lock<std::mutex> receiversLock = lockReceivers();
+        std::lock_guard<std::mutex> _l(mLock);
+        for (auto& pair : mReceivers) {
+            vector<ReceiverInfo*> receivers;
+            if (pair.second.size() != 0) {
+                for (ReceiverInfo& receiverInfo : pair.second) {
+                    // If pullNecessary and enough time has passed for the next bucket, then add
+                    // receiver to the list that will pull on this alarm.
+                    // If pullNecessary is false, check if next pull time needs to be updated.
+                    sp<PullDataReceiver> receiverPtr = receiverInfo.receiver.promote();
+                    const bool pullNecessary =
+                            receiverPtr != nullptr && receiverPtr->isPullNeeded();
+                    if (receiverInfo.nextPullTimeNs <= elapsedTimeNs && pullNecessary) {
+                        receivers.push_back(&receiverInfo);
+                        if (receiverInfo.nextPullTimeNs < mNextPullTimeNs) {
+                            // The alarm was delayed past the next pull time of the receiver to
+                            // batch it with other receivers.
+                            StatsdStats::getInstance().notePullBatchingDelay(
+                                    pair.first.atomTag, min(mNextPullTimeNs, elapsedTimeNs) -
+                                                                receiverInfo.nextPullTimeNs);
+                        }
+                    } else {
+                        if (receiverInfo.nextPullTimeNs <= elapsedTimeNs) {
+                            receiverPtr->onDataPulled({}, PullResult::PULL_NOT_NEEDED,
+                                                      elapsedTimeNs);
+                            int numBucketsAhead = (elapsedTimeNs - receiverInfo.nextPullTimeNs) /
+                                                  receiverInfo.intervalNs;
+                            receiverInfo.nextPullTimeNs +=
+                                    (numBucketsAhead + 1) * receiverInfo.intervalNs;
+                        }
                     }
-                    minNextPullTimeNs = min(receiverInfo.nextPullTimeNs, minNextPullTimeNs);
                 }
             }
-            if (receivers.size() > 0) {
-                needToPull.push_back(make_pair(&pair.first, receivers));
+            if (receivers.empty()) {
+                continue;
+            }
+
+            const int tagId = pair.first.atomTag;
+            vector<int32_t> uids;
+            auto pullerIt = kAllPullAtomInfo.end();
+            if (getPullAtomUidsLocked(tagId, pair.first.configKey, &uids)) {
+                pullerIt = findPullerLocked(tagId, uids);
+            }
+            if (pullerIt == kAllPullAtomInfo.end()) {
+                VLOG("pull failed at %lld, will try again later", (long long)elapsedTimeNs);
+                onDataPulledLocked(receivers, {}, PullResult::PULL_RESULT_FAIL, elapsedTimeNs,
+                                   wallClockNs);
+                continue;
+            }
+            auto [taskIt, inserted] =
+                    pullerKeyToTaskIndex.insert({pullerIt->first, tasks.size()});
+            if (inserted) {
+                tasks.push_back({pullerIt->first, pullerIt->second, {}});
+            }
+            tasks[taskIt->second].pullIndices.push_back(needToPull.size());
+            vector<wp<PullDataReceiver>> receiverPtrs;
+            for (const ReceiverInfo* receiverInfo : receivers) {
+                receiverPtrs.push_back(receiverInfo->receiver);
             }
+            needToPull.emplace_back(pair.first, std::move(receiverPtrs));
+            numPendingPulls++;
         }
     }
-    for (const auto& pullInfo : needToPull) {
-        vector<shared_ptr<LogEvent>> data;
-        PullResult pullResult =
-                PullLocked(pullInfo.first->atomTag, pullInfo.first->configKey, elapsedTimeNs, &data)
-                        ? PullResult::PULL_RESULT_SUCCESS
-                        : PullResult::PULL_RESULT_FAIL;
-        if (pullResult == PullResult::PULL_RESULT_FAIL) {
-            VLOG("pull failed at %lld, will try again later", (long long)elapsedTimeNs);
-        }
 
-        // Convention is to mark pull atom timestamp at request time.
-        // If we pull at t0, puller starts at t1, finishes at t2, and send back
-        // at t3, we mark t0 as its timestamp, which should correspond to its
-        // triggering event, such as condition change at t0.
-        // Here the triggering event is alarm fired from AlarmManager.
-        // In ValueMetricProducer and GaugeMetricProducer we do same thing
-        // when pull on condition change, etc.
-        for (auto& event : data) {
-            event->setElapsedTimestampNs(elapsedTimeNs);
-            event->setLogdWallClockTimestampNs(wallClockNs);
+    auto results = std::make_shared<PullTaskResults>();
+    auto runPullTask = [elapsedTimeNs, results](size_t taskIndex, const PullTask& task) {
+        for (size_t pullIndex : task.pullIndices) {
+            VLOG("Initiating pulling %d", task.pullerKey.atomTag);
+            PullTaskResult result = {taskIndex, pullIndex, PULL_FAIL, {}};
+            result.status = task.puller->Pull(elapsedTimeNs, &result.data);
+            {
+                std::lock_guard<std::mutex> lock(results->mutex);
+                results->results.push_back(std::move(result));
+            }
+            results->cv.notify_one();
+        }
+    };
+    if (tasks.size() == 1) {
+        // Nothing to pull concurrently with, so pull on this thread.
+        runPullTask(0, tasks[0]);
+    } else {
+        for (size_t i = 0; i < tasks.size(); i++) {
+            mPullWorkers.run([runPullTask, i, task = tasks[i]] { runPullTask(i, task); });
         }
+    }
 
-        for (const auto& receiverInfo : pullInfo.second) {
-            sp<PullDataReceiver> receiverPtr = receiverInfo->receiver.promote();
-            if (receiverPtr != nullptr) {
-                receiverPtr->onDataPulled(data, pullResult, elapsedTimeNs);
-                // We may have just come out of a coma, compute next pull time.
-                int numBucketsAhead =
-                        (elapsedTimeNs - receiverInfo->nextPullTimeNs) / receiverInfo->intervalNs;
-                receiverInfo->nextPullTimeNs += (numBucketsAhead + 1) * receiverInfo->intervalNs;
-                minNextPullTimeNs = min(receiverInfo->nextPullTimeNs, minNextPullTimeNs);
-            } else {
-                VLOG("receiver already gone.");
-            }
+    for (; numPendingPulls > 0; numPendingPulls--) {
+        PullTaskResult result;
+        {
+            std::unique_lock<std::mutex> lock(results->mutex);
+            results->cv.wait(lock, [&results] { return !results->results.empty(); });
+            result = std::move(results->results.front());
+            results->results.pop_front();
         }
+        const PullTask& task = tasks[result.taskIndex];
+        VLOG("pulled %zu items", result.data.size());
+        std::unique_lock<std::mutex> receiversLock = lockReceivers();
+        std::lock_guard<std::mutex> _l(mLock);
+        PullResult pullResult = onPullFinishedLocked(task.pullerKey, task.puller, result.status)
+                                        ? PullResult::PULL_RESULT_SUCCESS
+                                        : PullResult::PULL_RESULT_FAIL;
+        if (pullResult == PullResult::PULL_RESULT_FAIL) {
+            VLOG("pull failed at %lld, will try again later", (long long)elapsedTimeNs);
+            result.data.clear();
+        }
+        const auto& [receiverKey, receiverPtrs] = needToPull[result.pullIndex];
+        onDataPulledLocked(findReceiversLocked(receiverKey, receiverPtrs), result.data,
+                           pullResult, elapsedTimeNs, wallClockNs);
     }
 
+    std::lock_guard<std::mutex> _l(mLock);
+    const int64_t nextAlarmTimeNs = getNextPullAlarmTimeLocked();
     VLOG("mNextPullTimeNs: %lld updated to %lld", (long long)mNextPullTimeNs,
-         (long long)minNextPullTimeNs);
-    mNextPullTimeNs = minNextPullTimeNs;
+         (long long)nextAlarmTimeNs);
+    mNextPullTimeNs = nextAlarmTimeNs;
     updateAlarmLocked();
 }
 
+vector<StatsPullerManager::ReceiverInfo*> StatsPullerManager::findReceiversLocked(
+        const ReceiverKey& receiverKey, const vector<wp<PullDataReceiver>>& receiverPtrs) {
+    vector<ReceiverInfo*> receivers;
+    auto receiversIt = mReceivers.find(receiverKey);
+    if (receiversIt == mReceivers.end()) {
+        return receivers;
+    }
+    for (ReceiverInfo& receiverInfo : receiversIt->second) {
+        if (std::find(receiverPtrs.begin(), receiverPtrs.end(), receiverInfo.receiver) !=
+            receiverPtrs.end()) {
+            receivers.push_back(&receiverInfo);
+        }
+    }
+    return receivers;
+}
+
+void StatsPullerManager::onDataPulledLocked(const vector<ReceiverInfo*>& receivers,
+                                            const vector<shared_ptr<LogEvent>>& data,
+                                            PullResult pullResult, int64_t elapsedTimeNs,
+                                            int64_t wallClockNs) {
+    // Convention is to mark pull atom timestamp at request time.
+    // If we pull at t0, puller starts at t1, finishes at t2, and send back
+    // at t3, we mark t0 as its timestamp, which should correspond to its
+    // triggering event, such as condition change at t0.
+    // Here the triggering event is alarm fired from AlarmManager.
+    // In ValueMetricProducer and GaugeMetricProducer we do same thing
+    // when pull on condition change, etc.
+    for (auto& event : data) {
+        event->setElapsedTimestampNs(elapsedTimeNs);
+        event->setLogdWallClockTimestampNs(wallClockNs);
+    }
+
+    for (const auto& receiverInfo : receivers) {
+        sp<PullDataReceiver> receiverPtr = receiverInfo->receiver.promote();
+        if (receiverPtr != nullptr) {
+            receiverPtr->onDataPulled(data, pullResult, elapsedTimeNs);
+        } else {
+            VLOG("receiver already gone.");
+        }
+        // We may have just come out of a coma, compute next pull time. This is also done for a
+        // receiver that is gone, so that it does not keep the next pull alarm in the past.
+        int numBucketsAhead =
+                (elapsedTimeNs - receiverInfo->nextPullTimeNs) / receiverInfo->intervalNs;
+        receiverInfo->nextPullTimeNs += (numBucketsAhead + 1) * receiverInfo->intervalNs;
+    }
+}
+
 int StatsPullerManager::ForceClearPullerCache() {
     std::lock_guard<std::mutex> _l(mLock);
     int totalCleared = 0;
@@ -29,6 +29,7 @@
 #include "guardrail/StatsdStats.h"
 #include "logd/LogEvent.h"
 #include "packages/UidMap.h"
+#include "utils/WorkerPool.h"
 
 using aidl::android::os::IPullAtomCallback;
 using aidl::android::os::IStatsCompanionService;
@@ -68,10 +69,11 @@ public:
 
 
     // Registers a receiver for tagId. It will be pulled on the nextPullTimeNs
-    // and then every intervalNs thereafter.
+    // and then every intervalNs thereafter. Its pulls may be delayed to batch them with other
+    // receivers, by less than maxPullDelayNs.
     virtual void RegisterReceiver(int tagId, const ConfigKey& configKey,
                                   wp<PullDataReceiver> receiver, int64_t nextPullTimeNs,
-                                  int64_t intervalNs);
+                                  int64_t intervalNs, int64_t maxPullDelayNs);
 
     // Stop listening on a tagId.
     virtual void UnRegisterReceiver(int tagId, const ConfigKey& configKey,
@@ -88,11 +90,14 @@ public:
     // Verify if we know how to pull for this matcher
     bool PullerForMatcherExists(int tagId) const;
 
-    void OnAlarmFired(int64_t elapsedTimeNs);
+    // Pulls the receivers that are due at elapsedTimeNs. If receiversMutex is set, it is held
+    // while the receivers are checked and while the pulled data is delivered to them, but not
+    // while pulling.
+    void OnAlarmFired(int64_t elapsedTimeNs, std::mutex* receiversMutex = nullptr);
 
     // Pulls the most recent data.
     // The data may be served from cache if consecutive pulls come within
-    // mCoolDownNs.
+    // mCoolDownNs. Concurrent requests for the same atom share a single pull.
     // Returns true if the pull was successful.
     // Returns false when
     //   1) the pull fails
@@ -127,6 +132,16 @@ public:
 private:
     const static int64_t kMinCoolDownNs = NS_PER_SEC;
     const static int64_t kMaxTimeoutNs = 10 * NS_PER_SEC;
+    // Maximum number of pullers that are pulled concurrently when the pull alarm fires.
+    static constexpr size_t kMaxConcurrentPulls = 4;
+    // Maximum delay of a pull to batch it with the pulls of other receivers on the same alarm.
+    // A delayed pull is attributed to the bucket it was due for, so its data is up to this late
+    // relative to the bucket boundary, on top of the alarm and pull latencies. It is kept small
+    // enough for that shift to be negligible against buckets of at least one minute, which still
+    // lets metrics created within the same couple of seconds, e.g. by the same config, share a
+    // wakeup. The delay of each receiver is also bounded by its max pull delay minus the max pull
+    // timeout, so that a delayed pull still completes within the max pull delay of its metric.
+    static constexpr int64_t kPullAlarmBatchingWindowNs = 2 * NS_PER_SEC;
     shared_ptr<IStatsCompanionService> mStatsCompanionService = nullptr;
 
     // A struct containing an atom id and a Config Key
@@ -142,6 +157,8 @@ private:
     typedef struct {
         int64_t nextPullTimeNs;
         int64_t intervalNs;
+        // Maximum delay of the pulls of the receiver to batch them with other receivers.
+        int64_t maxBatchingDelayNs;
         wp<PullDataReceiver> receiver;
     } ReceiverInfo;
 
@@ -151,19 +168,48 @@ private:
     // mapping from Config Key to the PullUidProvider for that config
     std::map<ConfigKey, wp<PullUidProvider>> mPullUidProviders;
 
-    bool PullLocked(int tagId, const ConfigKey& configKey, const int64_t eventTimeNs,
-                    vector<std::shared_ptr<LogEvent>>* data);
+    // Pulls tagId from the first of uids that registered a puller for it. mLock must not be held.
+    bool PullFromUids(int tagId, const vector<int32_t>& uids, const int64_t eventTimeNs,
+                      vector<std::shared_ptr<LogEvent>>* data);
+
+    // Gets the uids to pull tagId from for the config. Returns false if the config has no
+    // PullUidProvider.
+    bool getPullAtomUidsLocked(int tagId, const ConfigKey& configKey, vector<int32_t>* uids);
+
+    // Returns the puller of tagId registered by the first of uids that has one, or
+    // kAllPullAtomInfo.end() if there is none.
+    std::map<const PullerKey, sp<StatsPuller>>::iterator findPullerLocked(
+            int tagId, const vector<int32_t>& uids);
+
+    // Notes the outcome of a pull by puller and drops the puller if its process died.
+    // Returns true if the pull succeeded.
+    bool onPullFinishedLocked(const PullerKey& pullerKey, const sp<StatsPuller>& puller,
+                              PullErrorCode status);
 
-    bool PullLocked(int tagId, const vector<int32_t>& uids, const int64_t eventTimeNs,
-                    vector<std::shared_ptr<LogEvent>>* data);
+    // Returns the registered receivers of receiverKey that are in receiverPtrs.
+    vector<ReceiverInfo*> findReceiversLocked(const ReceiverKey& receiverKey,
+                                              const vector<wp<PullDataReceiver>>& receiverPtrs);
+
+    // Delivers the data pulled at elapsedTimeNs to receivers and schedules their next pull.
+    void onDataPulledLocked(const vector<ReceiverInfo*>& receivers,
+                            const vector<std::shared_ptr<LogEvent>>& data, PullResult pullResult,
+                            int64_t elapsedTimeNs, int64_t wallClockNs);
 
     // locks for data receiver and StatsCompanionService changes
     std::mutex mLock;
 
     void updateAlarmLocked();
 
+    // Returns the time of the next pull alarm: the latest next pull time of the receivers that
+    // can be pulled together with the earliest due one, without delaying any of them by more
+    // than its maxBatchingDelayNs. Receivers are never pulled before their next pull time.
+    int64_t getNextPullAlarmTimeLocked() const;
+
     int64_t mNextPullTimeNs;
 
+    // Runs the pulls of the pull alarm.
+    WorkerPool mPullWorkers;
+
     FRIEND_TEST(GaugeMetricE2ePulledTest, TestFirstNSamplesPulledNoTrigger);
     FRIEND_TEST(GaugeMetricE2ePulledTest, TestFirstNSamplesPulledNoTriggerWithActivation);
     FRIEND_TEST(GaugeMetricE2ePulledTest, TestRandomSamplePulledEvents);
@@ -176,6 +222,10 @@ private:
 
     FRIEND_TEST(StatsLogProcessorTest, TestPullUidProviderSetOnConfigUpdate);
 
+    FRIEND_TEST(StatsPullerManagerTest, TestOnAlarmFiredDoesNotHoldLocksWhilePulling);
+    FRIEND_TEST(StatsPullerManagerTest, TestPullAlarmsAreBatched);
+    FRIEND_TEST(StatsPullerManagerTest, TestPullAlarmBatchingBoundedByMaxPullDelay);
+
     FRIEND_TEST(ConfigUpdateE2eTest, TestGaugeMetric);
     FRIEND_TEST(ConfigUpdateE2eTest, TestValueMetric);
 };
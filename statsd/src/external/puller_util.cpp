@@ -18,6 +18,11 @@
 #include "Log.h"
 
 #include "puller_util.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "HashableDimensionKey.h"
 #include "stats_log_util.h"
 
 namespace android {
@@ -80,8 +85,81 @@ void mapAndMergeIsolatedUidsToHostUid(vector<shared_ptr<LogEvent>>& data, const
         }
     }
 
-    // 2. sort the data, bit-wise
-    sort(data.begin(), data.end(),
+    // 2. Merge the events that only differ in additive fields, by hashing their non-additive
+    // fields. Repeated additive fields are treated as non-additive fields.
+    const int maxAdditiveField =
+            additiveFieldsVec.empty()
+                    ? 0
+                    : *max_element(additiveFieldsVec.begin(), additiveFieldsVec.end());
+    vector<bool> isAdditivePos(maxAdditiveField + 1, false);
+    for (int pos : additiveFieldsVec) {
+        if (pos >= 0) {
+            isAdditivePos[pos] = true;
+        }
+    }
+    auto isAdditive = [&isAdditivePos](const FieldValue& fieldValue) {
+        const int pos = fieldValue.mField.getPosAtDepth(0);
+        return pos < (int)isAdditivePos.size() && isAdditivePos[pos] &&
+               !isPrimitiveRepeatedField(fieldValue.mField);
+    };
+    auto hashNonAdditiveFields = [&isAdditive](const LogEvent& event) {
+        android::hash_t hash = android::hash_type((int)event.size());
+        for (const FieldValue& fieldValue : event.getValues()) {
+            hash = android::JenkinsHashMix(hash,
+                                           android::hash_type((int)fieldValue.mField.getField()));
+            if (!isAdditive(fieldValue)) {
+                hash = hashValue(hash, fieldValue.mValue);
+            }
+        }
+        return android::JenkinsHashWhiten(hash);
+    };
+    // Events with different lengths have different attribution chains or repeated fields.
+    auto canMerge = [&isAdditive](const LogEvent& lhs, const LogEvent& rhs) {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        const vector<FieldValue>& lhsValues = lhs.getValues();
+        const vector<FieldValue>& rhsValues = rhs.getValues();
+        for (size_t p = 0; p < lhsValues.size(); p++) {
+            if (lhsValues[p].mField != rhsValues[p].mField) {
+                return false;
+            }
+            if (lhsValues[p].mValue != rhsValues[p].mValue && !isAdditive(lhsValues[p])) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    vector<shared_ptr<LogEvent>> mergedData;
+    mergedData.reserve(data.size());
+    // Maps the hash of the non-additive fields to the index of the events in mergedData.
+    unordered_multimap<android::hash_t, size_t> mergedIndices;
+    mergedIndices.reserve(data.size());
+    for (shared_ptr<LogEvent>& event : data) {
+        const android::hash_t hash = hashNonAdditiveFields(*event);
+        auto [it, end] = mergedIndices.equal_range(hash);
+        for (; it != end; it++) {
+            if (canMerge(*mergedData[it->second], *event)) {
+                break;
+            }
+        }
+        if (it == end) {
+            mergedIndices.emplace(hash, mergedData.size());
+            mergedData.push_back(std::move(event));
+            continue;
+        }
+        vector<FieldValue>* mergedValues = mergedData[it->second]->getMutableValues();
+        const vector<FieldValue>& values = event->getValues();
+        for (size_t p = 0; p < values.size(); p++) {
+            if (isAdditive(values[p])) {
+                (*mergedValues)[p].mValue += values[p].mValue;
+            }
+        }
+    }
+
+    // 3. Sort the merged data, bit-wise, so that the output does not depend on the pull order.
+    sort(mergedData.begin(), mergedData.end(),
          [](const shared_ptr<LogEvent>& lhs, const shared_ptr<LogEvent>& rhs) {
              if (lhs->size() != rhs->size()) {
                  return lhs->size() < rhs->size();
@@ -96,61 +174,7 @@ void mapAndMergeIsolatedUidsToHostUid(vector<shared_ptr<LogEvent>>& data, const
              return false;
          });
 
-    vector<shared_ptr<LogEvent>> mergedData;
-    const set<int> additiveFields(additiveFieldsVec.begin(), additiveFieldsVec.end());
-    bool needMerge = true;
-
-    // 3. do the merge.
-    // The loop invariant is this: for every event,
-    // - check if it has a different length (means different attribution chains or repeated fields)
-    // - check if fields are different
-    // - check if non-additive field values are different (non-additive is default for repeated
-    // fields)
-    // If any are true, no need to merge, add itself to the result. Otherwise, merge the
-    // value onto the one immediately next to it.
-    for (int i = 0; i < (int)data.size() - 1; i++) {
-        // Size different, must be different chains or repeated fields.
-        if (data[i]->size() != data[i + 1]->size()) {
-            mergedData.push_back(data[i]);
-            continue;
-        }
-        vector<FieldValue>* lhsValues = data[i]->getMutableValues();
-        vector<FieldValue>* rhsValues = data[i + 1]->getMutableValues();
-        needMerge = true;
-        for (int p = 0; p < (int)lhsValues->size(); p++) {
-            if ((*lhsValues)[p].mField != (*rhsValues)[p].mField) {
-                needMerge = false;
-                break;
-            }
-            if ((*lhsValues)[p].mValue != (*rhsValues)[p].mValue) {
-                int pos = (*lhsValues)[p].mField.getPosAtDepth(0);
-                // Differ on non-additive field, abort.
-                // Repeated additive fields are treated as non-additive fields.
-                if (isPrimitiveRepeatedField((*lhsValues)[p].mField) ||
-                    (additiveFields.find(pos) == additiveFields.end())) {
-                    needMerge = false;
-                    break;
-                }
-            }
-        }
-        if (!needMerge) {
-            mergedData.push_back(data[i]);
-            continue;
-        }
-        // This should be infrequent operation.
-        for (int p = 0; p < (int)lhsValues->size(); p++) {
-            int pos = (*lhsValues)[p].mField.getPosAtDepth(0);
-            // Don't merge repeated fields.
-            if (!isPrimitiveRepeatedField((*lhsValues)[p].mField) &&
-                (additiveFields.find(pos) != additiveFields.end())) {
-                (*rhsValues)[p].mValue += (*lhsValues)[p].mValue;
-            }
-        }
-    }
-    mergedData.push_back(data.back());
-
-    data.clear();
-    data = mergedData;
+    data = std::move(mergedData);
 }
 
 }  // namespace statsd
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "guardrail/DimensionCardinalitySketch.h"
+
+#include <cmath>
+
+#include "hash.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+
+// Bias correction constant of HyperLogLog for m >= 128 registers.
+const double kAlpha = 0.7213 / (1.0 + 1.079 / DimensionCardinalitySketch::kNumRegisters);
+
+}  // namespace
+
+DimensionCardinalitySketch::DimensionCardinalitySketch() {
+    clear();
+}
+
+void DimensionCardinalitySketch::add(size_t keyHash) {
+    const uint64_t hash = Hash64(reinterpret_cast<const char*>(&keyHash), sizeof(keyHash));
+    const size_t index = hash >> (64 - kPrecisionBits);
+    // Position of the leftmost 1 bit in the remaining bits. The sentinel bit bounds the rank when
+    // all of them are 0.
+    const uint64_t remaining = (hash << kPrecisionBits) | (1ULL << (kPrecisionBits - 1));
+    const uint8_t rank = __builtin_clzll(remaining) + 1;
+
+    uint8_t& reg = mRegisters[index];
+    if (rank <= reg) {
+        return;
+    }
+    if (reg == 0) {
+        mNumZeroRegisters--;
+    }
+    mInverseSum += std::ldexp(1.0, -rank) - std::ldexp(1.0, -reg);
+    reg = rank;
+}
+
+size_t DimensionCardinalitySketch::estimate() const {
+    const double m = kNumRegisters;
+    const double rawEstimate = kAlpha * m * m / mInverseSum;
+    // Linear counting is more accurate for small cardinalities.
+    if (rawEstimate <= 2.5 * m && mNumZeroRegisters > 0) {
+        return std::lround(m * std::log(m / mNumZeroRegisters));
+    }
+    return std::lround(rawEstimate);
+}
+
+void DimensionCardinalitySketch::clear() {
+    mRegisters.fill(0);
+    mInverseSum = kNumRegisters;
+    mNumZeroRegisters = kNumRegisters;
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
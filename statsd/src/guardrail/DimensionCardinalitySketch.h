@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/*
+ * HyperLogLog estimate of the number of distinct dimension keys seen by a metric, including the
+ * keys that were dropped by the dimension guardrail. Uses 2^kPrecisionBits one byte registers,
+ * which gives a standard error of about 6.5%.
+ *
+ * Not thread safe. Metric producers only access it while holding their own lock.
+ */
+class DimensionCardinalitySketch {
+public:
+    static const int kPrecisionBits = 8;
+    static const size_t kNumRegisters = 1 << kPrecisionBits;
+
+    DimensionCardinalitySketch();
+
+    // Adds a key, given its std::hash value. The value is rehashed with Hash64, so weak hashes
+    // such as the 32 bit dimension key hashes can be used as is.
+    void add(size_t keyHash);
+
+    // Returns the estimated number of distinct keys added since the last clear. O(1).
+    size_t estimate() const;
+
+    bool empty() const {
+        return mNumZeroRegisters == kNumRegisters;
+    }
+
+    void clear();
+
+private:
+    std::array<uint8_t, kNumRegisters> mRegisters;
+
+    // Sum of 2^-register over all registers, maintained on add() so that estimate() does not
+    // have to scan the registers.
+    double mInverseSum;
+
+    size_t mNumZeroRegisters;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -62,6 +62,7 @@ const int FIELD_ID_SHARD_OFFSET = 21;
 const int FIELD_ID_STATSD_STATS_ID = 22;
 const int FIELD_ID_SUBSCRIPTION_STATS = 23;
 const int FIELD_ID_SOCKET_LOSS_STATS = 24;
+const int FIELD_ID_RESTRICTED_DB_WRITER_STATS = 25;
 
 const int FIELD_ID_RESTRICTED_METRIC_QUERY_STATS_CALLING_UID = 1;
 const int FIELD_ID_RESTRICTED_METRIC_QUERY_STATS_CONFIG_ID = 2;
@@ -93,6 +94,9 @@ const int FIELD_ID_OVERFLOW_COUNT = 1;
 const int FIELD_ID_OVERFLOW_MAX_HISTORY = 2;
 const int FIELD_ID_OVERFLOW_MIN_HISTORY = 3;
 
+const int FIELD_ID_RESTRICTED_DB_WRITER_STATS_QUEUE_FULL_COUNT = 1;
+const int FIELD_ID_RESTRICTED_DB_WRITER_STATS_MAX_QUEUE_LATENCY_NS = 2;
+
 const int FIELD_ID_CONFIG_STATS_UID = 1;
 const int FIELD_ID_CONFIG_STATS_ID = 2;
 const int FIELD_ID_CONFIG_STATS_CREATION = 3;
@@ -618,6 +622,11 @@ void StatsdStats::notePullFromCache(int pullAtomId) {
     mPulledAtomStats[pullAtomId].totalPullFromCache++;
 }
 
+void StatsdStats::notePullCoalesced(int pullAtomId) {
+    lock_guard<std::mutex> lock(mLock);
+    mPulledAtomStats[pullAtomId].coalescedPullCount++;
+}
+
 void StatsdStats::notePullTime(int pullAtomId, int64_t pullTimeNs) {
     lock_guard<std::mutex> lock(mLock);
     auto& pullStats = mPulledAtomStats[pullAtomId];
@@ -637,6 +646,13 @@ void StatsdStats::notePullDelay(int pullAtomId, int64_t pullDelayNs) {
     pullStats.numPullDelay += 1;
 }
 
+void StatsdStats::notePullBatchingDelay(int pullAtomId, int64_t batchingDelayNs) {
+    lock_guard<std::mutex> lock(mLock);
+    auto& pullStats = mPulledAtomStats[pullAtomId];
+    pullStats.batchedPullCount++;
+    pullStats.maxPullBatchingDelayNs = std::max(pullStats.maxPullBatchingDelayNs, batchingDelayNs);
+}
+
 void StatsdStats::notePullDataError(int pullAtomId) {
     lock_guard<std::mutex> lock(mLock);
     mPulledAtomStats[pullAtomId].dataError++;
@@ -771,6 +787,13 @@ void StatsdStats::noteBucketCount(int64_t metricId) {
     getAtomMetricStats(metricId).bucketCount++;
 }
 
+void StatsdStats::noteDimensionCardinalityEstimate(int64_t metricId, int64_t estimate) {
+    lock_guard<std::mutex> lock(mLock);
+    AtomMetricStats& metricStats = getAtomMetricStats(metricId);
+    metricStats.maxDimensionCardinalityEstimate =
+            std::max(metricStats.maxDimensionCardinalityEstimate, estimate);
+}
+
 void StatsdStats::noteBucketBoundaryDelayNs(int64_t metricId, int64_t timeDelayNs) {
     lock_guard<std::mutex> lock(mLock);
     AtomMetricStats& metricStats = getAtomMetricStats(metricId);
@@ -923,6 +946,17 @@ void StatsdStats::noteRestrictedConfigDbSize(const ConfigKey& configKey,
     totaDbSizes.push_back(dbSize);
 }
 
+void StatsdStats::noteRestrictedDbWriterQueueFull() {
+    lock_guard<std::mutex> lock(mLock);
+    mRestrictedDbWriterQueueFullCount++;
+}
+
+void StatsdStats::noteRestrictedDbWriteQueueLatency(const int64_t queueLatencyNs) {
+    lock_guard<std::mutex> lock(mLock);
+    mMaxRestrictedDbWriteQueueLatencyNs =
+            std::max(mMaxRestrictedDbWriteQueueLatencyNs, queueLatencyNs);
+}
+
 void StatsdStats::noteRestrictedMetricCategoryChanged(const ConfigKey& configKey,
                                                       const int64_t metricId) {
     lock_guard<std::mutex> lock(mLock);
@@ -1029,6 +1063,8 @@ void StatsdStats::resetInternalLocked() {
     mOverflowCount = 0;
     mMinQueueHistoryNs = kInt64Max;
     mMaxQueueHistoryNs = 0;
+    mRestrictedDbWriterQueueFullCount = 0;
+    mMaxRestrictedDbWriteQueueLatencyNs = 0;
     for (auto& config : mConfigStats) {
         config.second->broadcast_sent_time_sec.clear();
         config.second->activation_time_sec.clear();
@@ -1076,6 +1112,9 @@ void StatsdStats::resetInternalLocked() {
         pullStats.second.binderCallFailCount = 0;
         pullStats.second.pullTimeoutMetadata.clear();
         pullStats.second.subscriptionPullCount = 0;
+        pullStats.second.coalescedPullCount = 0;
+        pullStats.second.batchedPullCount = 0;
+        pullStats.second.maxPullBatchingDelayNs = 0;
     }
     mAtomMetricStats.clear();
     mActivationBroadcastGuardrailStats.clear();
@@ -1352,7 +1391,9 @@ void StatsdStats::dumpStats(int out) const {
                 "  (pull timeout)%ld, (pull exceed max delay)%ld"
                 "  (no uid provider count)%ld, (no puller found count)%ld\n"
                 "  (registered count) %ld, (unregistered count) %ld"
-                "  (atom error count) %d, (subscription pull count) %d, (binder call failed) %ld\n",
+                "  (atom error count) %d, (subscription pull count) %d, (binder call failed) %ld\n"
+                "  (coalesced pull count) %ld, (batched pull count) %ld"
+                "  (max pull batching delay nanos) %lld\n",
                 (int)pair.first, (long)pair.second.totalPull, (long)pair.second.totalPullFromCache,
                 (long)pair.second.pullFailed, (long)pair.second.minPullIntervalSec,
                 (long long)pair.second.avgPullTimeNs, (long long)pair.second.maxPullTimeNs,
@@ -1361,7 +1402,8 @@ void StatsdStats::dumpStats(int out) const {
                 pair.second.pullUidProviderNotFound, pair.second.pullerNotFound,
                 pair.second.registeredCount, pair.second.unregisteredCount,
                 pair.second.atomErrorCount, pair.second.subscriptionPullCount,
-                pair.second.binderCallFailCount);
+                pair.second.binderCallFailCount, pair.second.coalescedPullCount,
+                pair.second.batchedPullCount, (long long)pair.second.maxPullBatchingDelayNs);
         if (pair.second.pullTimeoutMetadata.size() > 0) {
             string uptimeMillis = "(pull timeout system uptime millis) ";
             string pullTimeoutMillis = "(pull timeout elapsed time millis) ";
@@ -1429,6 +1471,10 @@ void StatsdStats::dumpStats(int out) const {
     dprintf(out, "Event queue overflow: %d; MaxHistoryNs: %lld; MinHistoryNs: %lld\n",
             mOverflowCount, (long long)mMaxQueueHistoryNs, (long long)mMinQueueHistoryNs);
 
+    dprintf(out, "********RestrictedDbWriter stats***********\n");
+    dprintf(out, "Restricted db writer queue full: %d; MaxQueueLatencyNs: %lld\n",
+            mRestrictedDbWriterQueueFullCount, (long long)mMaxRestrictedDbWriteQueueLatencyNs);
+
     if (mActivationBroadcastGuardrailStats.size() > 0) {
         dprintf(out, "********mActivationBroadcastGuardrail stats***********\n");
         for (const auto& pair: mActivationBroadcastGuardrailStats) {
@@ -1783,6 +1829,15 @@ void StatsdStats::dumpStats(std::vector<uint8_t>* output, bool reset) {
         proto.end(token);
     }
 
+    if (mRestrictedDbWriterQueueFullCount > 0 || mMaxRestrictedDbWriteQueueLatencyNs > 0) {
+        uint64_t token = proto.start(FIELD_TYPE_MESSAGE | FIELD_ID_RESTRICTED_DB_WRITER_STATS);
+        proto.write(FIELD_TYPE_INT32 | FIELD_ID_RESTRICTED_DB_WRITER_STATS_QUEUE_FULL_COUNT,
+                    mRestrictedDbWriterQueueFullCount);
+        proto.write(FIELD_TYPE_INT64 | FIELD_ID_RESTRICTED_DB_WRITER_STATS_MAX_QUEUE_LATENCY_NS,
+                    (long long)mMaxRestrictedDbWriteQueueLatencyNs);
+        proto.end(token);
+    }
+
     for (const auto& restart : mSystemServerRestartSec) {
         proto.write(FIELD_TYPE_INT32 | FIELD_ID_SYSTEM_SERVER_RESTART | FIELD_COUNT_REPEATED,
                     restart);
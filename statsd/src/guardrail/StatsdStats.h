@@ -174,6 +174,10 @@ public:
     static constexpr int kDimensionKeySizeHardLimitMin = 800;
     static constexpr int kDimensionKeySizeHardLimitMax = 3000;
 
+    // Metrics whose estimated dimension cardinality in a bucket exceeds this factor times their
+    // hard limit only admit kDimensionKeySizeSoftLimit dimension keys in the following buckets.
+    static constexpr int kDimensionCardinalityOverflowFactor = 2;
+
     // Per atom dimension key size limit
     static const std::map<int, std::pair<size_t, size_t>> kAtomDimensionKeySizeLimitMap;
 
@@ -242,6 +246,9 @@ public:
     /* Min period between two flush operations of restricted metrics. */
     static const int64_t kMinFlushRestrictedPeriodNs = 60 * 60 * NS_PER_SEC;
 
+    /* Max number of restricted db writes waiting for the db writer thread. */
+    static const size_t kMaxRestrictedDbWriterQueueSize = 100;
+
     /* Min period between two db guardrail check operations of restricted metrics. */
     static const int64_t kMinDbGuardrailEnforcementPeriodNs = 60 * 60 * NS_PER_SEC;
 
@@ -483,6 +490,11 @@ public:
      */
     void notePullFromCache(int pullAtomId);
 
+    /*
+     * Notes a pull request shared the result of a pull of the same atom that was in flight.
+     */
+    void notePullCoalesced(int pullAtomId);
+
     /*
      * Notify data error for pulled atom.
      */
@@ -500,6 +512,12 @@ public:
      */
     void notePullDelay(int pullAtomId, int64_t pullDelayNs);
 
+    /*
+     * Records that a scheduled pull was delayed to batch it with the pulls of other metrics on the
+     * same alarm.
+     */
+    void notePullBatchingDelay(int pullAtomId, int64_t batchingDelayNs);
+
     /*
      * Records pull exceeds timeout for the puller.
      */
@@ -599,6 +617,12 @@ public:
      */
     void noteBucketCount(int64_t metricId);
 
+    /**
+     * Estimated number of distinct dimension keys a metric received in a bucket, including the
+     * keys dropped by the dimension guardrail. Only the maximum is kept.
+     */
+    void noteDimensionCardinalityEstimate(int64_t metricId, int64_t estimate);
+
     /**
      * For pulls at bucket boundaries, it represents the misalignment between the real timestamp and
      * the end of the bucket.
@@ -670,6 +694,13 @@ public:
     void noteRestrictedConfigDbSize(const ConfigKey& configKey, const int64_t elapsedTimeNs,
                                     const int64_t dbSize);
 
+    // Reports that a restricted db write was dropped or postponed because the db writer queue was
+    // full.
+    void noteRestrictedDbWriterQueueFull();
+
+    // Reports the time a restricted db write waited for the db writer thread.
+    void noteRestrictedDbWriteQueueLatency(const int64_t queueLatencyNs);
+
     /**
      * Records libstatssocket was not able to write into socket.
      */
@@ -787,6 +818,9 @@ public:
         long binderCallFailCount = 0;
         std::list<PullTimeoutMetadata> pullTimeoutMetadata;
         int32_t subscriptionPullCount = 0;
+        long coalescedPullCount = 0;
+        long batchedPullCount = 0;
+        int64_t maxPullBatchingDelayNs = 0;
     } PulledAtomStats;
 
     typedef struct {
@@ -801,6 +835,7 @@ public:
         int64_t maxBucketBoundaryDelayNs = 0;
         long bucketUnknownCondition = 0;
         long bucketCount = 0;
+        int64_t maxDimensionCardinalityEstimate = 0;
     } AtomMetricStats;
 
 private:
@@ -922,6 +957,13 @@ private:
     // Total number of events that are lost due to queue overflow.
     int32_t mOverflowCount = 0;
 
+    // Number of restricted db writes that were dropped or postponed because the db writer queue
+    // was full.
+    int32_t mRestrictedDbWriterQueueFullCount = 0;
+
+    // Max time a restricted db write waited for the db writer thread.
+    int64_t mMaxRestrictedDbWriteQueueLatencyNs = 0;
+
     // Timestamps when we detect log loss, and the number of logs lost.
     std::list<LogLossStats> mLogLossStats;
 
@@ -80,6 +80,18 @@ public:
         return mAtomIds;
     }
 
+    // Returns the indices of the matchers that this AtomMatchingTracker combines.
+    virtual const std::vector<int>& getChildren() const {
+        static const std::vector<int> kNoChildren;
+        return kNoChildren;
+    }
+
+    // Returns the operation combining the children, or LOGICAL_OPERATION_UNSPECIFIED if this
+    // AtomMatchingTracker matches events directly.
+    virtual LogicalOperation getLogicalOperation() const {
+        return LogicalOperation::LOGICAL_OPERATION_UNSPECIFIED;
+    }
+
     int64_t getId() const {
         return mId;
     }
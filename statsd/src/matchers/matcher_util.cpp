@@ -26,6 +26,7 @@
 
 using std::set;
 using std::string;
+using std::unordered_map;
 using std::vector;
 
 namespace android {
@@ -473,6 +474,108 @@ bool matchesSimple(const sp<UidMap>& uidMap, const SimpleAtomMatcher& simpleMatc
     return true;
 }
 
+namespace {
+
+// Appends the step of the matcher to the plan, after the steps of its children.
+// positions maps the matchers of the plan to their step position, or -1 if not appended yet.
+void appendMatcherStep(const int matcherIndex,
+                       const vector<sp<AtomMatchingTracker>>& allAtomMatchingTrackers,
+                       unordered_map<int, int>& positions, AtomMatcherEvaluationPlan& plan) {
+    if (positions[matcherIndex] >= 0) {
+        return;
+    }
+    const sp<AtomMatchingTracker>& tracker = allAtomMatchingTrackers[matcherIndex];
+    for (const int childIndex : tracker->getChildren()) {
+        if (positions.find(childIndex) != positions.end()) {
+            appendMatcherStep(childIndex, allAtomMatchingTrackers, positions, plan);
+        }
+    }
+
+    AtomMatcherEvaluationPlan::Step step;
+    step.matcherIndex = matcherIndex;
+    step.operation = tracker->getLogicalOperation();
+    step.hasUnmatchableChild = false;
+    if (step.operation != LogicalOperation::LOGICAL_OPERATION_UNSPECIFIED) {
+        for (const int childIndex : tracker->getChildren()) {
+            const auto it = positions.find(childIndex);
+            if (it == positions.end()) {
+                step.hasUnmatchableChild = true;
+                continue;
+            }
+            const int childPosition = it->second;
+            if ((int)step.childMask.size() <= childPosition / 64) {
+                step.childMask.resize(childPosition / 64 + 1, 0);
+            }
+            step.childMask[childPosition / 64] |= uint64_t{1} << (childPosition % 64);
+        }
+    }
+    positions[matcherIndex] = plan.steps.size();
+    plan.steps.push_back(std::move(step));
+}
+
+bool matchesCombinationStep(const AtomMatcherEvaluationPlan::Step& step,
+                            const vector<uint64_t>& matchedSteps) {
+    bool anyChildMatched = false;
+    bool allChildrenMatched = !step.hasUnmatchableChild;
+    for (size_t i = 0; i < step.childMask.size(); i++) {
+        anyChildMatched |= (step.childMask[i] & matchedSteps[i]) != 0;
+        allChildrenMatched &= (step.childMask[i] & ~matchedSteps[i]) == 0;
+    }
+    switch (step.operation) {
+        case LogicalOperation::AND:
+            return allChildrenMatched;
+        case LogicalOperation::OR:
+            return anyChildMatched;
+        case LogicalOperation::NOT:
+            return !anyChildMatched;
+        case LogicalOperation::NAND:
+            return !allChildrenMatched;
+        case LogicalOperation::NOR:
+            return !anyChildMatched;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+AtomMatcherEvaluationPlan createAtomMatcherEvaluationPlan(
+        const vector<int>& matcherIndices,
+        const vector<sp<AtomMatchingTracker>>& allAtomMatchingTrackers) {
+    AtomMatcherEvaluationPlan plan;
+    plan.steps.reserve(matcherIndices.size());
+    unordered_map<int, int> positions;
+    for (const int matcherIndex : matcherIndices) {
+        positions[matcherIndex] = -1;
+    }
+    // The config has been validated, so the matchers form a DAG.
+    for (const int matcherIndex : matcherIndices) {
+        appendMatcherStep(matcherIndex, allAtomMatchingTrackers, positions, plan);
+    }
+    return plan;
+}
+
+void evaluateAtomMatchers(const AtomMatcherEvaluationPlan& plan, const LogEvent& event,
+                          const vector<sp<AtomMatchingTracker>>& allAtomMatchingTrackers,
+                          vector<MatchingState>& matcherResults) {
+    // Bitset over step positions of the matchers that matched the event.
+    vector<uint64_t> matchedSteps((plan.steps.size() + 63) / 64, 0);
+    for (size_t pos = 0; pos < plan.steps.size(); pos++) {
+        const AtomMatcherEvaluationPlan::Step& step = plan.steps[pos];
+        if (step.operation == LogicalOperation::LOGICAL_OPERATION_UNSPECIFIED) {
+            allAtomMatchingTrackers[step.matcherIndex]->onLogEvent(event, allAtomMatchingTrackers,
+                                                                   matcherResults);
+        } else {
+            matcherResults[step.matcherIndex] = matchesCombinationStep(step, matchedSteps)
+                                                        ? MatchingState::kMatched
+                                                        : MatchingState::kNotMatched;
+        }
+        if (matcherResults[step.matcherIndex] == MatchingState::kMatched) {
+            matchedSteps[pos / 64] |= uint64_t{1} << (pos % 64);
+        }
+    }
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
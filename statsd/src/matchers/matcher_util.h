@@ -27,6 +27,8 @@ namespace android {
 namespace os {
 namespace statsd {
 
+class AtomMatchingTracker;
+
 enum MatchingState {
     kNotComputed = -1,
     kNotMatched = 0,
@@ -39,6 +41,40 @@ bool combinationMatch(const std::vector<int>& children, const LogicalOperation&
 bool matchesSimple(const sp<UidMap>& uidMap, const SimpleAtomMatcher& simpleMatcher,
                    const LogEvent& wrapper);
 
+// The AtomMatchingTrackers of one atom id, compiled when the config is loaded so that the
+// combination matchers of an event are resolved without recursion.
+struct AtomMatcherEvaluationPlan {
+    struct Step {
+        // Index of the AtomMatchingTracker in the manager's matcher list.
+        int matcherIndex;
+
+        // LOGICAL_OPERATION_UNSPECIFIED if the matcher is evaluated by its own onLogEvent().
+        LogicalOperation operation;
+
+        // For combination matchers, the bitset over step positions of the children that can
+        // match the atom.
+        std::vector<uint64_t> childMask;
+
+        // True if a child of the combination matcher cannot match the atom, in which case it is
+        // not in the plan and is known to be kNotMatched.
+        bool hasUnmatchableChild;
+    };
+
+    // All matchers of the atom in dependency order: children come before their parents.
+    std::vector<Step> steps;
+};
+
+// Compiles the evaluation plan of the given matchers, which must be all the matchers whose atom
+// ids contain the same atom id.
+AtomMatcherEvaluationPlan createAtomMatcherEvaluationPlan(
+        const std::vector<int>& matcherIndices,
+        const std::vector<sp<AtomMatchingTracker>>& allAtomMatchingTrackers);
+
+// Evaluates all matchers of the plan for the event, and stores their results in matcherResults.
+void evaluateAtomMatchers(const AtomMatcherEvaluationPlan& plan, const LogEvent& event,
+                          const std::vector<sp<AtomMatchingTracker>>& allAtomMatchingTrackers,
+                          std::vector<MatchingState>& matcherResults);
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
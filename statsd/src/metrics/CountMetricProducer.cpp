@@ -62,6 +62,7 @@ const int FIELD_ID_DIMENSION_IN_WHAT = 1;
 const int FIELD_ID_SLICE_BY_STATE = 6;
 const int FIELD_ID_BUCKET_INFO = 3;
 const int FIELD_ID_DIMENSION_LEAF_IN_WHAT = 4;
+const int FIELD_ID_DIMENSION_IN_WHAT_INDEX = 7;
 // for CountBucketInfo
 const int FIELD_ID_COUNT = 3;
 const int FIELD_ID_BUCKET_NUM = 4;
@@ -103,6 +104,7 @@ CountMetricProducer::CountMetricProducer(
             mc.conditionId = link.condition();
             translateFieldMatcher(link.fields_in_what(), &mc.metricFields);
             translateFieldMatcher(link.fields_in_condition(), &mc.conditionFields);
+            initMetric2ConditionValueIndices(&mc);
             mMetric2ConditionLinks.push_back(mc);
         }
         mConditionSliced = true;
@@ -220,6 +222,7 @@ void CountMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                                              const bool include_current_partial_bucket,
                                              const bool erase_data, const DumpLatency dumpLatency,
                                              std::set<string>* str_set,
+                                             DimensionDictionary* dimensionDictionary,
                                              ProtoOutputStream* protoOutput) {
     if (include_current_partial_bucket) {
         flushLocked(dumpTimeNs);
@@ -262,7 +265,11 @@ void CountMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                 protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_DATA);
 
         // First fill dimension.
-        if (mShouldUseNestedDimensions) {
+        if (dimensionDictionary != nullptr) {
+            writeDimensionIndexToProto(dimensionKey.getDimensionKeyInWhat(),
+                                       FIELD_ID_DIMENSION_IN_WHAT_INDEX, dimensionDictionary,
+                                       protoOutput);
+        } else if (mShouldUseNestedDimensions) {
             uint64_t dimensionToken = protoOutput->start(
                     FIELD_TYPE_MESSAGE | FIELD_ID_DIMENSION_IN_WHAT);
             writeDimensionToProto(dimensionKey.getDimensionKeyInWhat(), str_set, protoOutput);
@@ -339,13 +346,15 @@ bool CountMetricProducer::hitGuardRailLocked(const MetricDimensionKey& newKey) {
     if (mCurrentSlicedCounter->find(newKey) != mCurrentSlicedCounter->end()) {
         return false;
     }
+    noteNewDimensionKeyLocked(std::hash<MetricDimensionKey>{}(newKey), mDimensionHardLimit);
     // ===========GuardRail==============
     // 1. Report the tuple count if the tuple count > soft limit
     if (mCurrentSlicedCounter->size() >= StatsdStats::kDimensionKeySizeSoftLimit) {
         size_t newTupleCount = mCurrentSlicedCounter->size() + 1;
         StatsdStats::getInstance().noteMetricDimensionSize(mConfigKey, mMetricId, newTupleCount);
         // 2. Don't add more tuples, we are above the allowed threshold. Drop the data.
-        if (newTupleCount > mDimensionHardLimit) {
+        if (newTupleCount > mDimensionHardLimit ||
+            exceedsDimensionCardinalityLimitLocked(mDimensionHardLimit)) {
             if (!mHasHitGuardrail) {
                 ALOGE("CountMetric %lld dropping data for dimension key %s", (long long)mMetricId,
                       newKey.toString().c_str());
@@ -493,6 +502,7 @@ void CountMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs,
     // (Do not clear since the old one is still referenced in mAnomalyTrackers).
     mCurrentSlicedCounter = std::make_shared<DimToValMap>();
     mCurrentBucketStartTimeNs = nextBucketStartTimeNs;
+    closeDimensionCardinalityBucketLocked();
     // Reset mHasHitGuardrail boolean since bucket was reset
     mHasHitGuardrail = false;
 }
@@ -23,6 +23,8 @@
 #include <limits.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include "guardrail/StatsdStats.h"
 #include "metrics/parsing_utils/metrics_manager_util.h"
 #include "stats_log_util.h"
@@ -38,6 +40,7 @@ using android::util::FIELD_TYPE_STRING;
 using android::util::ProtoOutputStream;
 using std::string;
 using std::unordered_map;
+using std::unordered_set;
 using std::vector;
 using std::shared_ptr;
 
@@ -59,6 +62,7 @@ const int FIELD_ID_DATA = 1;
 const int FIELD_ID_DIMENSION_IN_WHAT = 1;
 const int FIELD_ID_BUCKET_INFO = 3;
 const int FIELD_ID_DIMENSION_LEAF_IN_WHAT = 4;
+const int FIELD_ID_DIMENSION_IN_WHAT_INDEX = 7;
 const int FIELD_ID_SLICE_BY_STATE = 6;
 // for DurationBucketInfo
 const int FIELD_ID_DURATION = 3;
@@ -130,6 +134,7 @@ DurationMetricProducer::DurationMetricProducer(
             mc.conditionId = link.condition();
             translateFieldMatcher(link.fields_in_what(), &mc.metricFields);
             translateFieldMatcher(link.fields_in_condition(), &mc.conditionFields);
+            initMetric2ConditionValueIndices(&mc);
             if (!subsetDimensions(mc.metricFields, mInternalDimensions)) {
                 ALOGE(("Condition links must be a subset of the internal dimensions"));
                 // TODO: Add invalidConfigReason
@@ -270,7 +275,8 @@ void DurationMetricProducer::initTrueDimensions(const int whatIndex, const int64
     if (whatIndex == -1) {
         return;
     }
-    const map<HashableDimensionKey, int>* slicedWhatMap = mWizard->getSlicedDimensionMap(whatIndex);
+    const unordered_map<HashableDimensionKey, int>* slicedWhatMap =
+            mWizard->getSlicedDimensionMap(whatIndex);
     for (const auto& [internalDimKey, count] : *slicedWhatMap) {
         for (int i = 0; i < count; i++) {
             // Fake start events.
@@ -343,6 +349,27 @@ void DurationMetricProducer::onStateChanged(const int64_t eventTimeNs, const int
     }
 }
 
+void DurationMetricProducer::onStateReset(const int64_t eventTimeNs, const int32_t atomId,
+                                          const std::vector<StateChange>& changes,
+                                          const FieldValue& newState) {
+    FieldValue newStateCopy = newState;
+    mapStateValue(atomId, &newStateCopy);
+
+    flushIfNeededLocked(eventTimeNs);
+
+    // Every changed primary key moves to the same state, so a tracker is notified once if its
+    // whatKey is linked to any of them.
+    for (auto& whatIt : mCurrentSlicedDurationTrackerMap) {
+        const HashableDimensionKey& whatKey = whatIt.first;
+        if (std::any_of(changes.begin(), changes.end(), [&](const StateChange& change) {
+                return containsLinkedStateValues(whatKey, change.primaryKey, mMetric2StateLinks,
+                                                 atomId);
+            })) {
+            whatIt.second->onStateChanged(eventTimeNs, atomId, newStateCopy);
+        }
+    }
+}
+
 unique_ptr<DurationTracker> DurationMetricProducer::createDurationTracker(
         const MetricDimensionKey& eventKey) const {
     switch (mAggregationType) {
@@ -389,7 +416,7 @@ void DurationMetricProducer::onSlicedConditionMayChangeLocked_opt1(const int64_t
     // state based on the new unsliced condition state.
     if (dimensionsChangedToTrue == nullptr || dimensionsChangedToFalse == nullptr ||
         (dimensionsChangedToTrue->empty() && dimensionsChangedToFalse->empty())) {
-        const map<HashableDimensionKey, int>* slicedConditionMap =
+        const unordered_map<HashableDimensionKey, int>* slicedConditionMap =
                 mWizard->getSlicedDimensionMap(mConditionTrackerIndex);
         for (auto& whatIt : mCurrentSlicedDurationTrackerMap) {
             HashableDimensionKey linkedConditionDimensionKey;
@@ -420,12 +447,107 @@ void DurationMetricProducer::onSlicedConditionMayChangeLocked_opt1(const int64_t
     }
 }
 
+// SlicedConditionChange optimization case 2:
+// 1. If combination condition, logical operation is AND, only one sliced child predicate.
+// 2. The links cover only part of the dimension fields in the sliced child condition predicate.
+// A changed condition dimension can then affect several linked condition keys, and the condition
+// of a key can depend on several condition dimensions. So instead of flipping the affected
+// trackers, only the trackers whose linked condition key is the projection of a changed condition
+// dimension onto the linked fields re-query the condition. Returns false if all trackers need to
+// re-query the condition.
+bool DurationMetricProducer::onSlicedConditionMayChangeLocked_opt2(const int64_t eventTime) {
+    if (!mWizard->IsSimpleCondition(mConditionTrackerIndex)) {
+        const ConditionState unslicedPartState =
+                mWizard->getUnSlicedPartConditionState(mConditionTrackerIndex);
+        const bool unslicedPartChanged = unslicedPartState != mUnSlicedPartCondition;
+        mUnSlicedPartCondition = unslicedPartState;
+        // A change of the unsliced part affects the condition of every key.
+        if (unslicedPartChanged) {
+            return false;
+        }
+    }
+
+    const unordered_set<HashableDimensionKey>* dimensionsChangedToTrue =
+            mWizard->getChangedToTrueDimensions(mConditionTrackerIndex);
+    const unordered_set<HashableDimensionKey>* dimensionsChangedToFalse =
+            mWizard->getChangedToFalseDimensions(mConditionTrackerIndex);
+    if (dimensionsChangedToTrue == nullptr || dimensionsChangedToFalse == nullptr ||
+        (dimensionsChangedToTrue->empty() && dimensionsChangedToFalse->empty())) {
+        return false;
+    }
+
+    // The linked condition keys that a changed condition dimension affects are its values of the
+    // linked condition fields, so they are looked up directly instead of scanning the index.
+    unordered_set<HashableDimensionKey> affectedWhatKeys;
+    const auto addAffectedWhatKeys = [this, &affectedWhatKeys](
+                                             const HashableDimensionKey& conditionDimension) {
+        for (const Metric2Condition& link : mMetric2ConditionLinks) {
+            HashableDimensionKey linkedConditionKey;
+            if (!getLinkedConditionKey(conditionDimension, link, &linkedConditionKey)) {
+                continue;
+            }
+            auto conditionIt = mConditionKeyToWhatKeys.find(linkedConditionKey);
+            if (conditionIt == mConditionKeyToWhatKeys.end()) {
+                continue;
+            }
+            unordered_set<HashableDimensionKey>& whatKeys = conditionIt->second;
+            for (auto whatIt = whatKeys.begin(); whatIt != whatKeys.end();) {
+                if (mCurrentSlicedDurationTrackerMap.find(*whatIt) ==
+                    mCurrentSlicedDurationTrackerMap.end()) {
+                    whatIt = whatKeys.erase(whatIt);
+                } else {
+                    affectedWhatKeys.insert(*whatIt);
+                    ++whatIt;
+                }
+            }
+            if (whatKeys.empty()) {
+                mConditionKeyToWhatKeys.erase(conditionIt);
+            }
+        }
+    };
+    for (const HashableDimensionKey& conditionDimension : *dimensionsChangedToTrue) {
+        addAffectedWhatKeys(conditionDimension);
+    }
+    for (const HashableDimensionKey& conditionDimension : *dimensionsChangedToFalse) {
+        addAffectedWhatKeys(conditionDimension);
+    }
+
+    for (const HashableDimensionKey& whatKey : affectedWhatKeys) {
+        mCurrentSlicedDurationTrackerMap[whatKey]->onSlicedConditionMayChange(eventTime);
+    }
+    return true;
+}
+
+// Drops the what keys that no longer have a duration tracker from mConditionKeyToWhatKeys.
+void DurationMetricProducer::pruneConditionKeyIndexLocked() {
+    for (auto conditionIt = mConditionKeyToWhatKeys.begin();
+         conditionIt != mConditionKeyToWhatKeys.end();) {
+        unordered_set<HashableDimensionKey>& whatKeys = conditionIt->second;
+        for (auto whatIt = whatKeys.begin(); whatIt != whatKeys.end();) {
+            if (mCurrentSlicedDurationTrackerMap.find(*whatIt) ==
+                mCurrentSlicedDurationTrackerMap.end()) {
+                whatIt = whatKeys.erase(whatIt);
+            } else {
+                ++whatIt;
+            }
+        }
+        if (whatKeys.empty()) {
+            conditionIt = mConditionKeyToWhatKeys.erase(conditionIt);
+        } else {
+            ++conditionIt;
+        }
+    }
+}
+
 void DurationMetricProducer::onSlicedConditionMayChangeInternalLocked(const int64_t eventTimeNs) {
     bool changeDimTrackable = mWizard->IsChangedDimensionTrackable(mConditionTrackerIndex);
     if (changeDimTrackable && mHasLinksToAllConditionDimensionsInTracker) {
         onSlicedConditionMayChangeLocked_opt1(eventTimeNs);
         return;
     }
+    if (changeDimTrackable && onSlicedConditionMayChangeLocked_opt2(eventTimeNs)) {
+        return;
+    }
 
     // Now for each of the on-going event, check if the condition has changed for them.
     for (auto& whatIt : mCurrentSlicedDurationTrackerMap) {
@@ -507,7 +629,8 @@ void DurationMetricProducer::clearPastBucketsLocked(const int64_t dumpTimeNs) {
 
 void DurationMetricProducer::onDumpReportLocked(
         const int64_t dumpTimeNs, const bool include_current_partial_bucket, const bool erase_data,
-        const DumpLatency dumpLatency, std::set<string>* str_set, ProtoOutputStream* protoOutput) {
+        const DumpLatency dumpLatency, std::set<string>* str_set,
+        DimensionDictionary* dimensionDictionary, ProtoOutputStream* protoOutput) {
     if (include_current_partial_bucket) {
         flushLocked(dumpTimeNs);
     } else {
@@ -550,7 +673,11 @@ void DurationMetricProducer::onDumpReportLocked(
                 protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_DATA);
 
         // First fill dimension.
-        if (mShouldUseNestedDimensions) {
+        if (dimensionDictionary != nullptr) {
+            writeDimensionIndexToProto(dimensionKey.getDimensionKeyInWhat(),
+                                       FIELD_ID_DIMENSION_IN_WHAT_INDEX, dimensionDictionary,
+                                       protoOutput);
+        } else if (mShouldUseNestedDimensions) {
             uint64_t dimensionToken = protoOutput->start(
                     FIELD_TYPE_MESSAGE | FIELD_ID_DIMENSION_IN_WHAT);
             writeDimensionToProto(dimensionKey.getDimensionKeyInWhat(), str_set, protoOutput);
@@ -632,9 +759,11 @@ void DurationMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs
             ++whatIt;
         }
     }
+    pruneConditionKeyIndexLocked();
 
     StatsdStats::getInstance().noteBucketCount(mMetricId);
     mCurrentBucketStartTimeNs = nextBucketStartTimeNs;
+    closeDimensionCardinalityBucketLocked();
     // Reset mHasHitGuardrail boolean since bucket was reset
     mHasHitGuardrail = false;
 }
@@ -657,13 +786,17 @@ void DurationMetricProducer::dumpStatesLocked(int out, bool verbose) const {
 bool DurationMetricProducer::hitGuardRailLocked(const MetricDimensionKey& newKey) const {
     auto whatIt = mCurrentSlicedDurationTrackerMap.find(newKey.getDimensionKeyInWhat());
     if (whatIt == mCurrentSlicedDurationTrackerMap.end()) {
+        noteNewDimensionKeyLocked(
+                std::hash<HashableDimensionKey>{}(newKey.getDimensionKeyInWhat()),
+                mDimensionHardLimit);
         // 1. Report the tuple count if the tuple count > soft limit
         if (mCurrentSlicedDurationTrackerMap.size() >= StatsdStats::kDimensionKeySizeSoftLimit) {
             size_t newTupleCount = mCurrentSlicedDurationTrackerMap.size() + 1;
             StatsdStats::getInstance().noteMetricDimensionSize(
                     mConfigKey, mMetricId, newTupleCount);
             // 2. Don't add more tuples, we are above the allowed threshold. Drop the data.
-            if (newTupleCount > mDimensionHardLimit) {
+            if (newTupleCount > mDimensionHardLimit ||
+                exceedsDimensionCardinalityLimitLocked(mDimensionHardLimit)) {
                 if (!mHasHitGuardrail) {
                     ALOGE("DurationMetric %lld dropping data for what dimension key %s",
                           (long long)mMetricId, newKey.getDimensionKeyInWhat().toString().c_str());
@@ -689,6 +822,11 @@ void DurationMetricProducer::handleStartEvent(const MetricDimensionKey& eventKey
         }
         mCurrentSlicedDurationTrackerMap[whatKey] = createDurationTracker(eventKey);
     }
+    if (mConditionSliced && !mHasLinksToAllConditionDimensionsInTracker) {
+        for (const auto& [_, linkedConditionKey] : conditionKeys) {
+            mConditionKeyToWhatKeys[linkedConditionKey].insert(whatKey);
+        }
+    }
 
     auto it = mCurrentSlicedDurationTrackerMap.find(whatKey);
     if (mUseWhatDimensionAsInternalDimension) {
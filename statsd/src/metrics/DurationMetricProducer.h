@@ -19,6 +19,7 @@
 #include <android/util/ProtoOutputStream.h>
 
 #include <unordered_map>
+#include <unordered_set>
 
 #include "../anomaly/DurationAnomalyTracker.h"
 #include "../condition/ConditionTracker.h"
@@ -63,6 +64,11 @@ public:
                         const HashableDimensionKey& primaryKey, const FieldValue& oldState,
                         const FieldValue& newState) override;
 
+    // Flushes once and notifies each duration tracker at most once for all the primary keys of a
+    // reset.
+    void onStateReset(const int64_t eventTimeNs, const int32_t atomId,
+                      const std::vector<StateChange>& changes, const FieldValue& newState) override;
+
     MetricType getMetricType() const override {
         return METRIC_TYPE_DURATION;
     }
@@ -91,6 +97,7 @@ private:
                             const bool erase_data,
                             const DumpLatency dumpLatency,
                             std::set<string> *str_set,
+                            DimensionDictionary* dimensionDictionary,
                             android::util::ProtoOutputStream* protoOutput) override;
 
     void clearPastBucketsLocked(const int64_t dumpTimeNs) override;
@@ -108,6 +115,10 @@ private:
 
     void onSlicedConditionMayChangeLocked_opt1(const int64_t eventTime);
 
+    bool onSlicedConditionMayChangeLocked_opt2(const int64_t eventTime);
+
+    void pruneConditionKeyIndexLocked();
+
     // Internal function to calculate the current used bytes.
     size_t byteSizeLocked() const override;
 
@@ -172,6 +183,13 @@ private:
     std::unordered_map<HashableDimensionKey, std::unique_ptr<DurationTracker>>
             mCurrentSlicedDurationTrackerMap;
 
+    // Maps each linked condition key to the dimensions in what of the trackers that were started
+    // with it. Only maintained if the links cover part of the condition dimensions. May contain
+    // dimensions in what whose tracker has been removed since; these are pruned on lookup and at
+    // the end of each bucket.
+    std::unordered_map<HashableDimensionKey, std::unordered_set<HashableDimensionKey>>
+            mConditionKeyToWhatKeys;
+
     const size_t mDimensionHardLimit;
 
     // Helper function to create a duration tracker given the metric aggregation type.
@@ -190,6 +208,7 @@ private:
 
     FRIEND_TEST(DurationMetricProducerTest, TestSumDurationAppUpgradeSplitDisabled);
     FRIEND_TEST(DurationMetricProducerTest, TestClearCurrentSlicedTrackerMapWhenStop);
+    FRIEND_TEST(DurationMetricProducerTest, TestStateResetNotifiesLinkedTrackers);
     FRIEND_TEST(DurationMetricProducerTest_PartialBucket, TestSumDuration);
     FRIEND_TEST(DurationMetricProducerTest_PartialBucket,
                 TestSumDurationWithSplitInFollowingBucket);
@@ -74,6 +74,7 @@ EventMetricProducer::EventMetricProducer(
             mc.conditionId = link.condition();
             translateFieldMatcher(link.fields_in_what(), &mc.metricFields);
             translateFieldMatcher(link.fields_in_condition(), &mc.conditionFields);
+            initMetric2ConditionValueIndices(&mc);
             mMetric2ConditionLinks.push_back(mc);
         }
         mConditionSliced = true;
@@ -170,6 +171,7 @@ void EventMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                                              const bool erase_data,
                                              const DumpLatency dumpLatency,
                                              std::set<string> *str_set,
+                                             DimensionDictionary* dimensionDictionary,
                                              ProtoOutputStream* protoOutput) {
     protoOutput->write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)mMetricId);
     protoOutput->write(FIELD_TYPE_BOOL | FIELD_ID_IS_ACTIVE, isActiveLocked());
@@ -64,6 +64,7 @@ const int FIELD_ID_DROP_TIME = 2;
 const int FIELD_ID_DIMENSION_IN_WHAT = 1;
 const int FIELD_ID_BUCKET_INFO = 3;
 const int FIELD_ID_DIMENSION_LEAF_IN_WHAT = 4;
+const int FIELD_ID_DIMENSION_IN_WHAT_INDEX = 7;
 // for GaugeBucketInfo
 const int FIELD_ID_BUCKET_NUM = 6;
 const int FIELD_ID_START_BUCKET_ELAPSED_MILLIS = 7;
@@ -126,6 +127,7 @@ GaugeMetricProducer::GaugeMetricProducer(
             mc.conditionId = link.condition();
             translateFieldMatcher(link.fields_in_what(), &mc.metricFields);
             translateFieldMatcher(link.fields_in_condition(), &mc.conditionFields);
+            initMetric2ConditionValueIndices(&mc);
             mMetric2ConditionLinks.push_back(mc);
         }
         mConditionSliced = true;
@@ -136,7 +138,7 @@ GaugeMetricProducer::GaugeMetricProducer(
     // Kicks off the puller immediately.
     if (mIsPulled && isRandomNSamples()) {
         mPullerManager->RegisterReceiver(mPullTagId, mConfigKey, this, getCurrentBucketEndTimeNs(),
-                                         mBucketSizeNs);
+                                         mBucketSizeNs, mMaxPullDelayNs);
     }
 
     // Adjust start for partial first bucket and then pull if needed
@@ -246,6 +248,7 @@ void GaugeMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                                              const bool erase_data,
                                              const DumpLatency dumpLatency,
                                              std::set<string> *str_set,
+                                             DimensionDictionary* dimensionDictionary,
                                              ProtoOutputStream* protoOutput) {
     VLOG("Gauge metric %lld report now...", (long long)mMetricId);
     if (include_current_partial_bucket) {
@@ -307,7 +310,11 @@ void GaugeMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                 protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_DATA);
 
         // First fill dimension.
-        if (mShouldUseNestedDimensions) {
+        if (dimensionDictionary != nullptr) {
+            writeDimensionIndexToProto(dimensionKey.getDimensionKeyInWhat(),
+                                       FIELD_ID_DIMENSION_IN_WHAT_INDEX, dimensionDictionary,
+                                       protoOutput);
+        } else if (mShouldUseNestedDimensions) {
             uint64_t dimensionToken = protoOutput->start(
                     FIELD_TYPE_MESSAGE | FIELD_ID_DIMENSION_IN_WHAT);
             writeDimensionToProto(dimensionKey.getDimensionKeyInWhat(), str_set, protoOutput);
@@ -512,12 +519,14 @@ bool GaugeMetricProducer::hitGuardRailLocked(const MetricDimensionKey& newKey) {
     if (mCurrentSlicedBucket->find(newKey) != mCurrentSlicedBucket->end()) {
         return false;
     }
+    noteNewDimensionKeyLocked(std::hash<MetricDimensionKey>{}(newKey), mDimensionHardLimit);
     // 1. Report the tuple count if the tuple count > soft limit
     if (mCurrentSlicedBucket->size() >= mDimensionSoftLimit) {
         size_t newTupleCount = mCurrentSlicedBucket->size() + 1;
         StatsdStats::getInstance().noteMetricDimensionSize(mConfigKey, mMetricId, newTupleCount);
         // 2. Don't add more tuples, we are above the allowed threshold. Drop the data.
-        if (newTupleCount > mDimensionHardLimit) {
+        if (newTupleCount > mDimensionHardLimit ||
+            exceedsDimensionCardinalityLimitLocked(mDimensionHardLimit)) {
             if (!mHasHitGuardrail) {
                 ALOGE("GaugeMetric %lld dropping data for dimension key %s", (long long)mMetricId,
                       newKey.toString().c_str());
@@ -688,6 +697,7 @@ void GaugeMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs,
     mCurrentSlicedBucket = std::make_shared<DimToGaugeAtomsMap>();
     mCurrentBucketStartTimeNs = nextBucketStartTimeNs;
     mCurrentSkippedBucket.reset();
+    closeDimensionCardinalityBucketLocked();
     // Reset mHasHitGuardrail boolean since bucket was reset
     mHasHitGuardrail = false;
 }
@@ -119,6 +119,7 @@ private:
                             const bool erase_data,
                             const DumpLatency dumpLatency,
                             std::set<string> *str_set,
+                            DimensionDictionary* dimensionDictionary,
                             android::util::ProtoOutputStream* protoOutput) override;
     void clearPastBucketsLocked(const int64_t dumpTimeNs) override;
 
@@ -77,6 +77,8 @@ MetricProducer::MetricProducer(
       mStateGroupMap(stateGroupMap),
       mSplitBucketForAppUpgrade(splitBucketForAppUpgrade),
       mHasHitGuardrail(false),
+      mDimensionCardinalityLimitHit(false),
+      mLastDimensionCardinalityEstimate(0),
       mSampledWhatFields({}),
       mShardCount(0) {
 }
@@ -385,6 +387,37 @@ bool MetricProducer::passesSampleCheckLocked(const vector<FieldValue>& values) c
                             mShardCount);
 }
 
+void MetricProducer::noteNewDimensionKeyLocked(size_t keyHash, size_t hardLimit) const {
+    if (mDimensionCardinalityLimitHit) {
+        return;
+    }
+    mDimensionCardinalitySketch.add(keyHash);
+    // The estimate is only needed once keys are dropped, which is when it can exceed the limit.
+    if (mHasHitGuardrail && mDimensionCardinalitySketch.estimate() >
+                                    StatsdStats::kDimensionCardinalityOverflowFactor * hardLimit) {
+        mDimensionCardinalityLimitHit = true;
+    }
+}
+
+void MetricProducer::closeDimensionCardinalityBucketLocked() {
+    if (mDimensionCardinalitySketch.empty()) {
+        mLastDimensionCardinalityEstimate = 0;
+        return;
+    }
+    mLastDimensionCardinalityEstimate = mDimensionCardinalitySketch.estimate();
+    if (mLastDimensionCardinalityEstimate >= StatsdStats::kDimensionKeySizeSoftLimit) {
+        StatsdStats::getInstance().noteDimensionCardinalityEstimate(
+                mMetricId, mLastDimensionCardinalityEstimate);
+    }
+    mDimensionCardinalitySketch.clear();
+    mDimensionCardinalityLimitHit = false;
+}
+
+bool MetricProducer::exceedsDimensionCardinalityLimitLocked(size_t hardLimit) const {
+    return mLastDimensionCardinalityEstimate >
+           StatsdStats::kDimensionCardinalityOverflowFactor * hardLimit;
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -20,6 +20,7 @@
 #include <src/active_config_list.pb.h>
 #include <utils/RefBase.h>
 
+#include <functional>
 #include <unordered_map>
 
 #include "HashableDimensionKey.h"
@@ -27,6 +28,7 @@
 #include "condition/ConditionTimer.h"
 #include "condition/ConditionWizard.h"
 #include "config/ConfigKey.h"
+#include "guardrail/DimensionCardinalitySketch.h"
 #include "guardrail/StatsdStats.h"
 #include "matchers/EventMatcherWizard.h"
 #include "matchers/matcher_util.h"
@@ -34,6 +36,7 @@
 #include "src/statsd_metadata.pb.h"  // MetricMetadata
 #include "state/StateListener.h"
 #include "state/StateManager.h"
+#include "stats_log_util.h"
 #include "utils/DbUtils.h"
 #include "utils/ShardOffsetProvider.h"
 
@@ -230,9 +233,22 @@ public:
                       const DumpLatency dumpLatency,
                       std::set<string> *str_set,
                       android::util::ProtoOutputStream* protoOutput) {
+        onDumpReport(dumpTimeNs, include_current_partial_bucket, erase_data, dumpLatency, str_set,
+                     nullptr, protoOutput);
+    }
+
+    // Same as above, but if [dimensionDictionary] is not null, the dimension in what of each
+    // metric data is written as an index into the dictionary instead of being written in full.
+    void onDumpReport(const int64_t dumpTimeNs,
+                      const bool include_current_partial_bucket,
+                      const bool erase_data,
+                      const DumpLatency dumpLatency,
+                      std::set<string> *str_set,
+                      DimensionDictionary* dimensionDictionary,
+                      android::util::ProtoOutputStream* protoOutput) {
         std::lock_guard<std::mutex> lock(mMutex);
         return onDumpReportLocked(dumpTimeNs, include_current_partial_bucket, erase_data,
-                dumpLatency, str_set, protoOutput);
+                dumpLatency, str_set, dimensionDictionary, protoOutput);
     }
 
     virtual optional<InvalidConfigReason> onConfigUpdatedLocked(
@@ -307,7 +323,7 @@ public:
     void writeActiveMetricToProtoOutputStream(
             int64_t currentTimeNs, const DumpReportReason reason, ProtoOutputStream* proto);
 
-    virtual void enforceRestrictedDataTtl(sqlite3* db, const int64_t wallClockNs){};
+    virtual void enforceRestrictedDataTtl(const int64_t wallClockNs){};
 
     virtual bool writeMetricMetadataToProto(metadata::MetricMetadata* metricMetadata) {
         return false;
@@ -322,6 +338,12 @@ public:
     virtual void flushRestrictedData() {
     }
 
+    // Takes the restricted data held in memory. Returns a function that writes it to the db, which
+    // may be run on any thread, or nullptr if there is no data to write.
+    virtual std::function<void()> takeRestrictedDataWrite() {
+        return nullptr;
+    }
+
     // Start: getters/setters
     inline int64_t getMetricId() const {
         return mMetricId;
@@ -436,6 +458,7 @@ protected:
                                     const bool erase_data,
                                     const DumpLatency dumpLatency,
                                     std::set<string> *str_set,
+                                    DimensionDictionary* dimensionDictionary,
                                     android::util::ProtoOutputStream* protoOutput) = 0;
     virtual void clearPastBucketsLocked(const int64_t dumpTimeNs) = 0;
     virtual void prepareFirstBucketLocked(){};
@@ -490,6 +513,21 @@ protected:
 
     bool passesSampleCheckLocked(const vector<FieldValue>& values) const;
 
+    // Adds a dimension key that is not tracked yet in the current bucket to the dimension
+    // cardinality sketch. Once the guardrail has tripped and the estimate exceeds the limit of
+    // exceedsDimensionCardinalityLimitLocked(hardLimit), the rest of the bucket is not hashed.
+    void noteNewDimensionKeyLocked(size_t keyHash, size_t hardLimit) const;
+
+    // Saves the dimension cardinality estimate of the current bucket, reports it to StatsdStats,
+    // and clears the sketch. Called when the current bucket is flushed.
+    void closeDimensionCardinalityBucketLocked();
+
+    // Returns true if the last bucket received more than
+    // StatsdStats::kDimensionCardinalityOverflowFactor times hardLimit distinct dimension keys.
+    // Such metrics stop admitting new dimension keys at the soft limit instead of filling up to
+    // the hard limit in every bucket.
+    bool exceedsDimensionCardinalityLimitLocked(size_t hardLimit) const;
+
     const int64_t mMetricId;
 
     // Hash of the Metric's proto bytes from StatsdConfig, including any activations.
@@ -573,6 +611,18 @@ protected:
     // If hard dimension guardrail is hit, do not spam logcat. This is a per bucket tracker.
     mutable bool mHasHitGuardrail;
 
+    // Distinct dimension keys received in the current bucket, including the ones dropped by the
+    // guardrail.
+    mutable DimensionCardinalitySketch mDimensionCardinalitySketch;
+
+    // Set when the current bucket exceeds the dimension cardinality limit, after which new keys
+    // are no longer added to mDimensionCardinalitySketch.
+    mutable bool mDimensionCardinalityLimitHit;
+
+    // Estimated dimension cardinality of the last flushed bucket. It is a lower bound when that
+    // bucket exceeded the dimension cardinality limit.
+    mutable size_t mLastDimensionCardinalityEstimate;
+
     // Matchers for sampled fields. Currently only one sampled dimension is supported.
     std::vector<Matcher> mSampledWhatFields;
 
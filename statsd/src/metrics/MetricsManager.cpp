@@ -54,6 +54,7 @@ const int FIELD_ID_METRICS = 1;
 const int FIELD_ID_ANNOTATIONS = 7;
 const int FIELD_ID_ANNOTATIONS_INT64 = 1;
 const int FIELD_ID_ANNOTATIONS_INT32 = 2;
+const int FIELD_ID_DIMENSION_DICTIONARY = 11;
 
 // for ActiveConfig
 const int FIELD_ID_ACTIVE_CONFIG_ID = 1;
@@ -98,6 +99,7 @@ MetricsManager::MetricsManager(const ConfigKey& key, const StatsdConfig& config,
             mAlertTrackerMap, mMetricIndexesWithActivation, mStateProtoHashes, mNoReportMetricIds);
 
     mHashStringsInReport = config.hash_strings_in_metric_report();
+    mDimensionDictionaryInReport = config.dimension_dictionary_in_metric_report();
     mVersionStringsInReport = config.version_strings_in_metric_report();
     mInstallerInReport = config.installer_in_metric_report();
 
@@ -112,6 +114,8 @@ MetricsManager::MetricsManager(const ConfigKey& key, const StatsdConfig& config,
     }
     verifyGuardrailsAndUpdateStatsdStats();
     initializeConfigActiveStatus();
+    initAtomMatcherEvaluationPlans();
+    initConditionEvaluationPlan();
 }
 
 MetricsManager::~MetricsManager() {
@@ -183,6 +187,7 @@ bool MetricsManager::updateConfig(const StatsdConfig& config, const int64_t time
     refreshTtl(currentTimeNs);
 
     mHashStringsInReport = config.hash_strings_in_metric_report();
+    mDimensionDictionaryInReport = config.dimension_dictionary_in_metric_report();
     mVersionStringsInReport = config.version_strings_in_metric_report();
     mInstallerInReport = config.installer_in_metric_report();
     mWhitelistedAtomIds.clear();
@@ -208,9 +213,36 @@ bool MetricsManager::updateConfig(const StatsdConfig& config, const int64_t time
 
     verifyGuardrailsAndUpdateStatsdStats();
     initializeConfigActiveStatus();
+    initAtomMatcherEvaluationPlans();
+    initConditionEvaluationPlan();
     return !mInvalidConfigReason.has_value();
 }
 
+void MetricsManager::initAtomMatcherEvaluationPlans() {
+    mTagIdsToMatcherPlans.clear();
+    if (mInvalidConfigReason.has_value()) {
+        return;
+    }
+    for (const auto& [tagId, matcherIndices] : mTagIdsToMatchersMap) {
+        mTagIdsToMatcherPlans[tagId] =
+                createAtomMatcherEvaluationPlan(matcherIndices, mAllAtomMatchingTrackers);
+    }
+}
+
+void MetricsManager::initConditionEvaluationPlan() {
+    mConditionEvaluationPlan = ConditionEvaluationPlan();
+    if (mInvalidConfigReason.has_value()) {
+        return;
+    }
+    vector<vector<int>> conditionChildren;
+    conditionChildren.reserve(mAllConditionTrackers.size());
+    for (const sp<ConditionTracker>& conditionTracker : mAllConditionTrackers) {
+        conditionChildren.push_back(conditionTracker->getChildren());
+    }
+    mConditionEvaluationPlan = createConditionEvaluationPlan(
+            conditionChildren, mTrackerToConditionMap, mAllAtomMatchingTrackers.size());
+}
+
 void MetricsManager::createAllLogSourcesFromConfig(const StatsdConfig& config) {
     // Init allowed pushed atom uids.
     for (const auto& source : config.allowed_log_source()) {
@@ -472,23 +504,25 @@ void MetricsManager::onDumpReport(const int64_t dumpTimeStampNs, const int64_t w
         return;
     }
     VLOG("=========================Metric Reports Start==========================");
+    std::set<string>* reportStrSet = mHashStringsInReport ? str_set : nullptr;
+    DimensionDictionary dimensionDictionary;
+    DimensionDictionary* reportDimensionDictionary =
+            mDimensionDictionaryInReport ? &dimensionDictionary : nullptr;
     // one StatsLogReport per MetricProduer
     for (const auto& producer : mAllMetricProducers) {
         if (mNoReportMetricIds.find(producer->getMetricId()) == mNoReportMetricIds.end()) {
             uint64_t token = protoOutput->start(
                     FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_METRICS);
-            if (mHashStringsInReport) {
-                producer->onDumpReport(dumpTimeStampNs, include_current_partial_bucket, erase_data,
-                                       dumpLatency, str_set, protoOutput);
-            } else {
-                producer->onDumpReport(dumpTimeStampNs, include_current_partial_bucket, erase_data,
-                                       dumpLatency, nullptr, protoOutput);
-            }
+            producer->onDumpReport(dumpTimeStampNs, include_current_partial_bucket, erase_data,
+                                   dumpLatency, reportStrSet, reportDimensionDictionary,
+                                   protoOutput);
             protoOutput->end(token);
         } else {
             producer->clearPastBuckets(dumpTimeStampNs);
         }
     }
+    writeDimensionDictionaryToProto(dimensionDictionary, FIELD_ID_DIMENSION_DICTIONARY,
+                                    reportStrSet, protoOutput);
     for (const auto& annotation : mAnnotations) {
         uint64_t token = protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED |
                                             FIELD_ID_ANNOTATIONS);
@@ -598,9 +632,9 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
 
     mIsActive = isActive || !activeMetricsIndices.empty();
 
-    const auto matchersIt = mTagIdsToMatchersMap.find(tagId);
+    const auto matchersIt = mTagIdsToMatcherPlans.find(tagId);
 
-    if (matchersIt == mTagIdsToMatchersMap.end()) {
+    if (matchersIt == mTagIdsToMatcherPlans.end()) {
         // Not interesting...
         return;
     }
@@ -608,7 +642,7 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
     if (event.isParsedHeaderOnly()) {
         // This should not happen if metric config is defined for certain atom id
         const int64_t firstMatcherId =
-                mAllAtomMatchingTrackers[*matchersIt->second.begin()]->getId();
+                mAllAtomMatchingTrackers[matchersIt->second.steps.front().matcherIndex]->getId();
         ALOGW("Atom %d is mistakenly skipped - there is a matcher %lld for it", tagId,
               (long long)firstMatcherId);
         return;
@@ -617,10 +651,7 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
     vector<MatchingState> matcherCache(mAllAtomMatchingTrackers.size(),
                                        MatchingState::kNotComputed);
 
-    for (const auto& matcherIndex : matchersIt->second) {
-        mAllAtomMatchingTrackers[matcherIndex]->onLogEvent(event, mAllAtomMatchingTrackers,
-                                                           matcherCache);
-    }
+    evaluateAtomMatchers(matchersIt->second, event, mAllAtomMatchingTrackers, matcherCache);
 
     // Set of metrics that received an activation cancellation.
     unordered_set<int> metricIndicesWithCanceledActivations;
@@ -659,54 +690,67 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
 
     mIsActive = isActive;
 
-    // A bitmap to see which ConditionTracker needs to be re-evaluated.
-    vector<bool> conditionToBeEvaluated(mAllConditionTrackers.size(), false);
-
-    for (const auto& pair : mTrackerToConditionMap) {
-        if (matcherCache[pair.first] == MatchingState::kMatched) {
-            const auto& conditionList = pair.second;
-            for (const int conditionIndex : conditionList) {
-                conditionToBeEvaluated[conditionIndex] = true;
-            }
-        }
-    }
-
-    vector<ConditionState> conditionCache(mAllConditionTrackers.size(),
-                                          ConditionState::kNotEvaluated);
-    // A bitmap to track if a condition has changed value.
-    vector<bool> changedCache(mAllConditionTrackers.size(), false);
-    for (size_t i = 0; i < mAllConditionTrackers.size(); i++) {
-        if (conditionToBeEvaluated[i] == false) {
+    // A bitmap over mConditionEvaluationPlan.order of the ConditionTrackers to be re-evaluated:
+    // the conditions that use the matched AtomMatchers, and their descendants.
+    const size_t conditionWords = (mAllConditionTrackers.size() + 63) / 64;
+    vector<uint64_t> conditionToBeEvaluated(conditionWords, 0);
+    bool hasConditionToBeEvaluated = false;
+    for (size_t i = 0; i < mConditionEvaluationPlan.matcherConditionCones.size(); i++) {
+        const vector<uint64_t>& cone = mConditionEvaluationPlan.matcherConditionCones[i];
+        if (cone.empty() || matcherCache[i] != MatchingState::kMatched) {
             continue;
         }
-        sp<ConditionTracker>& condition = mAllConditionTrackers[i];
-        condition->evaluateCondition(event, matcherCache, mAllConditionTrackers, conditionCache,
-                                     changedCache);
-    }
-
-    for (size_t i = 0; i < mAllConditionTrackers.size(); i++) {
-        if (changedCache[i] == false) {
-            continue;
+        for (size_t w = 0; w < conditionWords; w++) {
+            conditionToBeEvaluated[w] |= cone[w];
         }
-        auto pair = mConditionToMetricMap.find(i);
-        if (pair != mConditionToMetricMap.end()) {
-            auto& metricList = pair->second;
-            for (auto metricIndex : metricList) {
-                // Metric cares about non sliced condition, and it's changed.
-                // Push the new condition to it directly.
-                if (!mAllMetricProducers[metricIndex]->isConditionSliced()) {
-                    mAllMetricProducers[metricIndex]->onConditionChanged(conditionCache[i],
-                                                                         eventTimeNs);
-                    // Metric cares about sliced conditions, and it may have changed. Send
-                    // notification, and the metric can query the sliced conditions that are
-                    // interesting to it.
-                } else {
-                    mAllMetricProducers[metricIndex]->onSlicedConditionMayChange(conditionCache[i],
-                                                                                 eventTimeNs);
+        hasConditionToBeEvaluated = true;
+    }
+
+    if (hasConditionToBeEvaluated) {
+        vector<ConditionState> conditionCache(mAllConditionTrackers.size(),
+                                              ConditionState::kNotEvaluated);
+        // A bitmap to track if a condition has changed value.
+        vector<bool> changedCache(mAllConditionTrackers.size(), false);
+        // Children come before their parents in the plan order, so each condition is evaluated
+        // after the conditions it combines.
+        for (size_t w = 0; w < conditionWords; w++) {
+            for (uint64_t bits = conditionToBeEvaluated[w]; bits != 0; bits &= bits - 1) {
+                const int conditionIndex =
+                        mConditionEvaluationPlan.order[w * 64 + __builtin_ctzll(bits)];
+                mAllConditionTrackers[conditionIndex]->evaluateCondition(
+                        event, matcherCache, mAllConditionTrackers, conditionCache, changedCache);
+            }
+        }
+
+        for (size_t w = 0; w < conditionWords; w++) {
+            for (uint64_t bits = conditionToBeEvaluated[w]; bits != 0; bits &= bits - 1) {
+                const int conditionIndex =
+                        mConditionEvaluationPlan.order[w * 64 + __builtin_ctzll(bits)];
+                if (changedCache[conditionIndex] == false) {
+                    continue;
+                }
+                auto pair = mConditionToMetricMap.find(conditionIndex);
+                if (pair == mConditionToMetricMap.end()) {
+                    continue;
+                }
+                for (auto metricIndex : pair->second) {
+                    // Metric cares about non sliced condition, and it's changed.
+                    // Push the new condition to it directly.
+                    if (!mAllMetricProducers[metricIndex]->isConditionSliced()) {
+                        mAllMetricProducers[metricIndex]->onConditionChanged(
+                                conditionCache[conditionIndex], eventTimeNs);
+                        // Metric cares about sliced conditions, and it may have changed. Send
+                        // notification, and the metric can query the sliced conditions that are
+                        // interesting to it.
+                    } else {
+                        mAllMetricProducers[metricIndex]->onSlicedConditionMayChange(
+                                conditionCache[conditionIndex], eventTimeNs);
+                    }
                 }
             }
         }
     }
+
     // For matched AtomMatchers, tell relevant metrics that a matched event has come.
     for (size_t i = 0; i < mAllAtomMatchingTrackers.size(); i++) {
         if (matcherCache[i] == MatchingState::kMatched) {
@@ -837,20 +881,22 @@ void MetricsManager::loadMetadata(const metadata::StatsMetadata& metadata,
     }
 }
 
-void MetricsManager::enforceRestrictedDataTtls(const int64_t wallClockNs) {
-    if (!hasRestrictedMetricsDelegate()) {
-        return;
+static void enforceProducerDataTtls(const vector<sp<MetricProducer>>& producers,
+                                    const int64_t wallClockNs) {
+    for (const auto& producer : producers) {
+        producer->enforceRestrictedDataTtl(wallClockNs);
     }
-    sqlite3* db = dbutils::getDb(mConfigKey);
-    if (db == nullptr) {
-        ALOGE("Failed to open sqlite db");
-        dbutils::closeDb(db);
+}
+
+void MetricsManager::enforceRestrictedDataTtls(const int64_t wallClockNs,
+                                               RestrictedDbWriter& writer) {
+    if (!hasRestrictedMetricsDelegate()) {
         return;
     }
-    for (const auto& producer : mAllMetricProducers) {
-        producer->enforceRestrictedDataTtl(db, wallClockNs);
-    }
-    dbutils::closeDb(db);
+    // The producers are copied as the config may be updated before the write runs.
+    writer.push([producers = mAllMetricProducers, wallClockNs] {
+        enforceProducerDataTtls(producers, wallClockNs);
+    });
 }
 
 bool MetricsManager::validateRestrictedMetricsDelegate(const int32_t callingUid) {
@@ -875,6 +921,35 @@ void MetricsManager::flushRestrictedData() {
             mConfigKey, getElapsedRealtimeNs() - flushStartNs);
 }
 
+void MetricsManager::queueRestrictedDataFlush(RestrictedDbWriter& writer) {
+    if (!hasRestrictedMetricsDelegate()) {
+        return;
+    }
+    if (writer.isFull()) {
+        // Keep the data in the producers, to be written by the next flush.
+        StatsdStats::getInstance().noteRestrictedDbWriterQueueFull();
+        return;
+    }
+    vector<std::function<void()>> writes;
+    for (const auto& producer : mAllMetricProducers) {
+        std::function<void()> write = producer->takeRestrictedDataWrite();
+        if (write != nullptr) {
+            writes.push_back(std::move(write));
+        }
+    }
+    if (writes.empty()) {
+        return;
+    }
+    writer.push([configKey = mConfigKey, writes = std::move(writes)] {
+        int64_t flushStartNs = getElapsedRealtimeNs();
+        for (const auto& write : writes) {
+            write();
+        }
+        StatsdStats::getInstance().noteRestrictedConfigFlushLatency(
+                configKey, getElapsedRealtimeNs() - flushStartNs);
+    });
+}
+
 vector<int64_t> MetricsManager::getAllMetricIds() const {
     vector<int64_t> metricIds;
     metricIds.reserve(mMetricProducerMap.size());
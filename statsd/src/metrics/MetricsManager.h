@@ -22,6 +22,7 @@
 #include "anomaly/AlarmTracker.h"
 #include "anomaly/AnomalyTracker.h"
 #include "condition/ConditionTracker.h"
+#include "condition/condition_util.h"
 #include "config/ConfigKey.h"
 #include "external/StatsPullerManager.h"
 #include "guardrail/StatsdStats.h"
@@ -31,6 +32,7 @@
 #include "packages/UidMap.h"
 #include "src/statsd_config.pb.h"
 #include "src/statsd_metadata.pb.h"
+#include "utils/RestrictedDbWriter.h"
 
 namespace android {
 namespace os {
@@ -174,12 +176,18 @@ public:
         return mConfigKey;
     }
 
-    void enforceRestrictedDataTtls(const int64_t wallClockNs);
+    // Queues the enforcement of the restricted metric ttls on the db writer thread.
+    void enforceRestrictedDataTtls(const int64_t wallClockNs, RestrictedDbWriter& writer);
 
     bool validateRestrictedMetricsDelegate(const int32_t callingUid);
 
+    // Writes the restricted metric data to the db on the calling thread.
     virtual void flushRestrictedData();
 
+    // Hands the restricted metric data over to the db writer thread, to be written to the db.
+    // The data is kept in the producers if the writer queue is full.
+    virtual void queueRestrictedDataFlush(RestrictedDbWriter& writer);
+
     // Slow, should not be called in a hotpath.
     vector<int64_t> getAllMetricIds() const;
 
@@ -204,6 +212,7 @@ private:
     sp<UidMap> mUidMap;
 
     bool mHashStringsInReport = false;
+    bool mDimensionDictionaryInReport = false;
     bool mVersionStringsInReport = false;
     bool mInstallerInReport = false;
     uint8_t mPackageCertificateHashSizeBytes;
@@ -254,6 +263,9 @@ private:
     // All event tags that are interesting to config metrics matchers.
     std::unordered_map<int, std::vector<int>> mTagIdsToMatchersMap;
 
+    // The matchers of each event tag in mTagIdsToMatchersMap, compiled for evaluation.
+    std::unordered_map<int, AtomMatcherEvaluationPlan> mTagIdsToMatcherPlans;
+
     // We only store the sp of AtomMatchingTracker, MetricProducer, and ConditionTracker in
     // MetricsManager. There are relationships between them, and the relationships are denoted by
     // index instead of pointers. The reasons for this are: (1) the relationship between them are
@@ -307,6 +319,10 @@ private:
     // Maps from AtomMatchingTracker to ConditionTracker
     std::unordered_map<int, std::vector<int>> mTrackerToConditionMap;
 
+    // Conditions to evaluate for each AtomMatchingTracker, and the order to evaluate them in.
+    // Derived from mAllConditionTrackers and mTrackerToConditionMap.
+    ConditionEvaluationPlan mConditionEvaluationPlan;
+
     // Maps from ConditionTracker to MetricProducer
     std::unordered_map<int, std::vector<int>> mConditionToMetricMap;
 
@@ -339,6 +355,14 @@ private:
     // Should be called on config creation/update.
     void initializeConfigActiveStatus();
 
+    // Compiles mTagIdsToMatcherPlans from the atom matching trackers.
+    // Should be called on config creation/update.
+    void initAtomMatcherEvaluationPlans();
+
+    // Compiles mConditionEvaluationPlan from the condition trackers.
+    // Should be called on config creation/update.
+    void initConditionEvaluationPlan();
+
     // The metrics that don't need to be uploaded or even reported.
     std::set<int64_t> mNoReportMetricIds;
 
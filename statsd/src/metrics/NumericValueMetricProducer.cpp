@@ -23,7 +23,9 @@
 #include <stdlib.h>
 
 #include "guardrail/StatsdStats.h"
+#include "metrics/PulledValueAggregator.h"
 #include "metrics/parsing_utils/metrics_manager_util.h"
+#include "metrics/value_metric_util.h"
 #include "stats_log_util.h"
 
 using android::util::FIELD_COUNT_REPEATED;
@@ -80,8 +82,7 @@ NumericValueMetricProducer::NumericValueMetricProducer(
       mSkipZeroDiffOutput(metric.skip_zero_diff_output()),
       mUseZeroDefaultBase(metric.use_zero_default_base()),
       mHasGlobalBase(false),
-      mMaxPullDelayNs(metric.has_max_pull_delay_sec() ? metric.max_pull_delay_sec() * NS_PER_SEC
-                                                      : StatsdStats::kPullMaxDelayNs) {
+      mMaxPullDelayNs(pullOptions.maxPullDelayNs) {
     // TODO(b/186677791): Use initializer list to initialize mUploadThreshold.
     if (metric.has_threshold()) {
         mUploadThreshold = metric.threshold();
@@ -219,23 +220,6 @@ void NumericValueMetricProducer::onDataPulled(const std::vector<std::shared_ptr<
     flushIfNeededLocked(originalPullTimeNs);
 }
 
-void NumericValueMetricProducer::combineValueFields(pair<LogEvent, vector<int>>& eventValues,
-                                                    const LogEvent& newEvent,
-                                                    const vector<int>& newValueIndices) const {
-    if (eventValues.second.size() != newValueIndices.size()) {
-        ALOGE("NumericValueMetricProducer value indices sizes don't match");
-        return;
-    }
-    vector<FieldValue>* const aggregateFieldValues = eventValues.first.getMutableValues();
-    const vector<FieldValue>& newFieldValues = newEvent.getValues();
-    for (size_t i = 0; i < eventValues.second.size(); ++i) {
-        if (newValueIndices[i] != -1 && eventValues.second[i] != -1) {
-            (*aggregateFieldValues)[eventValues.second[i]].mValue +=
-                    newFieldValues[newValueIndices[i]].mValue;
-        }
-    }
-}
-
 // Process events retrieved from a pull.
 void NumericValueMetricProducer::accumulateEvents(const vector<shared_ptr<LogEvent>>& allData,
                                                   int64_t originalPullTimeNs,
@@ -265,7 +249,7 @@ void NumericValueMetricProducer::accumulateEvents(const vector<shared_ptr<LogEve
     if (mUseDiff) {
         // An extra aggregation step is needed to sum values with matching dimensions
         // before calculating the diff between sums of consecutive pulls.
-        std::unordered_map<HashableDimensionKey, pair<LogEvent, vector<int>>> aggregateEvents;
+        PulledValueAggregator aggregator(mFieldMatchers.size());
         for (const auto& data : allData) {
             if (mEventMatcherWizard->matchLogEvent(*data, mWhatMatcherIndex) !=
                 MatchingState::kMatched) {
@@ -279,22 +263,13 @@ void NumericValueMetricProducer::accumulateEvents(const vector<shared_ptr<LogEve
                               dimensionsInWhat, valueIndices)) {
                 StatsdStats::getInstance().noteBadValueType(mMetricId);
             }
-
-            // Store new event in map or combine values in existing event.
-            auto it = aggregateEvents.find(dimensionsInWhat);
-            if (it == aggregateEvents.end()) {
-                aggregateEvents.emplace(std::piecewise_construct,
-                                        std::forward_as_tuple(dimensionsInWhat),
-                                        std::forward_as_tuple(*data, valueIndices));
-            } else {
-                combineValueFields(it->second, *data, valueIndices);
-            }
+            aggregator.addEvent(dimensionsInWhat, *data, valueIndices);
         }
 
-        for (auto& [dimKey, eventInfo] : aggregateEvents) {
-            eventInfo.first.setElapsedTimestampNs(eventElapsedTimeNs);
-            onMatchedLogEventLocked(mWhatMatcherIndex, eventInfo.first);
-        }
+        aggregator.forEachAggregatedEvent([&](LogEvent& aggregatedEvent) {
+            aggregatedEvent.setElapsedTimestampNs(eventElapsedTimeNs);
+            onMatchedLogEventLocked(mWhatMatcherIndex, aggregatedEvent);
+        });
     } else {
         for (const auto& data : allData) {
             if (mEventMatcherWizard->matchLogEvent(*data, mWhatMatcherIndex) ==
@@ -435,62 +410,23 @@ bool NumericValueMetricProducer::aggregateFields(const int64_t eventTimeNs,
                     continue;
                 }
             }
-            Value diff;
-            switch (mValueDirection) {
-                case ValueMetric::INCREASING:
-                    if (value >= base.value()) {
-                        diff = value - base.value();
-                    } else if (mUseAbsoluteValueOnReset) {
-                        diff = value;
-                    } else {
-                        VLOG("Unexpected decreasing value");
-                        StatsdStats::getInstance().notePullDataError(mPullAtomId);
-                        base = value;
-                        // If we've got bad data, do not use anomaly detection
-                        useAnomalyDetection = false;
-                        continue;
-                    }
-                    break;
-                case ValueMetric::DECREASING:
-                    if (base.value() >= value) {
-                        diff = base.value() - value;
-                    } else if (mUseAbsoluteValueOnReset) {
-                        diff = value;
-                    } else {
-                        VLOG("Unexpected increasing value");
-                        StatsdStats::getInstance().notePullDataError(mPullAtomId);
-                        base = value;
-                        // If we've got bad data, do not use anomaly detection
-                        useAnomalyDetection = false;
-                        continue;
-                    }
-                    break;
-                case ValueMetric::ANY:
-                    diff = value - base.value();
-                    break;
-                default:
-                    break;
+            const optional<Value> diff = computeValueDiff(value, base.value(), mValueDirection,
+                                                          mUseAbsoluteValueOnReset);
+            if (!diff.has_value()) {
+                VLOG("Unexpected %s value",
+                     mValueDirection == ValueMetric::INCREASING ? "decreasing" : "increasing");
+                StatsdStats::getInstance().notePullDataError(mPullAtomId);
+                base = value;
+                // If we've got bad data, do not use anomaly detection
+                useAnomalyDetection = false;
+                continue;
             }
             base = value;
-            value = diff;
+            value = diff.value();
         }
 
         if (interval.hasValue()) {
-            switch (mAggregationType) {
-                case ValueMetric::SUM:
-                    // for AVG, we add up and take average when flushing the bucket
-                case ValueMetric::AVG:
-                    interval.aggregate += value;
-                    break;
-                case ValueMetric::MIN:
-                    interval.aggregate = min(value, interval.aggregate);
-                    break;
-                case ValueMetric::MAX:
-                    interval.aggregate = max(value, interval.aggregate);
-                    break;
-                default:
-                    break;
-            }
+            aggregateValue(value, mAggregationType, interval.aggregate);
         } else {
             interval.aggregate = value;
         }
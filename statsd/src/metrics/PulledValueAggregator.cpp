@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "PulledValueAggregator.h"
+
+using std::function;
+using std::vector;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+
+// Adds each value of the column to the sum of its row. sums is laid out row-major with
+// numValueFields entries per row.
+template <typename T>
+void sumColumn(const vector<uint32_t>& rows, const vector<T>& values, const size_t numValueFields,
+               const size_t valueField, vector<T>& sums) {
+    const size_t count = values.size();
+    const uint32_t* rowData = rows.data();
+    const T* valueData = values.data();
+    T* sumData = sums.data() + valueField;
+    for (size_t i = 0; i < count; i++) {
+        sumData[rowData[i] * numValueFields] += valueData[i];
+    }
+}
+
+}  // namespace
+
+PulledValueAggregator::PulledValueAggregator(const size_t numValueFields)
+    : mNumValueFields(numValueFields),
+      mLongColumns(numValueFields),
+      mDoubleColumns(numValueFields) {
+}
+
+void PulledValueAggregator::addEvent(const HashableDimensionKey& dimensionsInWhat,
+                                     const LogEvent& event, const vector<int>& valueIndices) {
+    if (valueIndices.size() != mNumValueFields) {
+        ALOGE("PulledValueAggregator value indices sizes don't match");
+        return;
+    }
+    const vector<FieldValue>& fieldValues = event.getValues();
+    const auto [it, inserted] = mRowIndices.emplace(dimensionsInWhat, mRows.size());
+    const uint32_t rowIndex = it->second;
+    if (inserted) {
+        vector<Type> valueTypes(mNumValueFields, UNKNOWN);
+        for (size_t i = 0; i < mNumValueFields; i++) {
+            if (valueIndices[i] != -1) {
+                valueTypes[i] = fieldValues[valueIndices[i]].mValue.getType();
+            }
+        }
+        mRows.push_back({&event, valueIndices, std::move(valueTypes)});
+    }
+    const Row& row = mRows[rowIndex];
+
+    for (size_t i = 0; i < mNumValueFields; i++) {
+        if (valueIndices[i] == -1 || row.valueIndices[i] == -1) {
+            continue;
+        }
+        const Value& value = fieldValues[valueIndices[i]].mValue;
+        if (value.getType() != row.valueTypes[i]) {
+            ALOGE("Can't operate on different value types, %d, %d", row.valueTypes[i],
+                  value.getType());
+            continue;
+        }
+        switch (value.getType()) {
+            case INT:
+                mLongColumns[i].rows.push_back(rowIndex);
+                mLongColumns[i].values.push_back(value.int_value);
+                break;
+            case LONG:
+                mLongColumns[i].rows.push_back(rowIndex);
+                mLongColumns[i].values.push_back(value.long_value);
+                break;
+            case FLOAT:
+                mDoubleColumns[i].rows.push_back(rowIndex);
+                mDoubleColumns[i].values.push_back(value.float_value);
+                break;
+            case DOUBLE:
+                mDoubleColumns[i].rows.push_back(rowIndex);
+                mDoubleColumns[i].values.push_back(value.double_value);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void PulledValueAggregator::forEachAggregatedEvent(
+        const function<void(LogEvent&)>& consumer) const {
+    vector<int64_t> longSums(mRows.size() * mNumValueFields, 0);
+    vector<double> doubleSums(mRows.size() * mNumValueFields, 0);
+    for (size_t i = 0; i < mNumValueFields; i++) {
+        sumColumn(mLongColumns[i].rows, mLongColumns[i].values, mNumValueFields, i, longSums);
+        sumColumn(mDoubleColumns[i].rows, mDoubleColumns[i].values, mNumValueFields, i,
+                  doubleSums);
+    }
+
+    for (size_t rowIndex = 0; rowIndex < mRows.size(); rowIndex++) {
+        const Row& row = mRows[rowIndex];
+        LogEvent aggregatedEvent = *row.firstEvent;
+        vector<FieldValue>* const fieldValues = aggregatedEvent.getMutableValues();
+        const size_t sumOffset = rowIndex * mNumValueFields;
+        for (size_t i = 0; i < mNumValueFields; i++) {
+            if (row.valueIndices[i] == -1) {
+                continue;
+            }
+            Value& value = (*fieldValues)[row.valueIndices[i]].mValue;
+            switch (row.valueTypes[i]) {
+                case INT:
+                    value.setInt(static_cast<int32_t>(longSums[sumOffset + i]));
+                    break;
+                case LONG:
+                    value.setLong(longSums[sumOffset + i]);
+                    break;
+                case FLOAT:
+                    value.setFloat(static_cast<float>(doubleSums[sumOffset + i]));
+                    break;
+                case DOUBLE:
+                    value.setDouble(doubleSums[sumOffset + i]);
+                    break;
+                default:
+                    break;
+            }
+        }
+        consumer(aggregatedEvent);
+    }
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
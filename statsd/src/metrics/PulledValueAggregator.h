@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "HashableDimensionKey.h"
+#include "logd/LogEvent.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Sums the value fields of pulled events that share the same dimensions in what, so that a diffed
+ * ValueMetric only computes one diff per dimension and pull.
+ *
+ * Instead of combining events one at a time with the type-dispatching Value operators, the value
+ * fields are extracted into one contiguous column per field and type, which are then summed per
+ * dimension in tight loops. The sums are written back into a copy of the first event seen for each
+ * dimension.
+ */
+class PulledValueAggregator {
+public:
+    explicit PulledValueAggregator(const size_t numValueFields);
+
+    // Adds a pulled event. valueIndices holds the position of each value field in
+    // event.getValues(), or -1 if the field is missing. The event must outlive the aggregator.
+    void addEvent(const HashableDimensionKey& dimensionsInWhat, const LogEvent& event,
+                  const std::vector<int>& valueIndices);
+
+    // Calls consumer once per dimension in what, in the order the dimensions were first added,
+    // with a copy of the first event of that dimension holding the summed values.
+    void forEachAggregatedEvent(const std::function<void(LogEvent&)>& consumer) const;
+
+    inline size_t getDimensionCount() const {
+        return mRows.size();
+    }
+
+private:
+    struct Row {
+        const LogEvent* firstEvent;
+        std::vector<int> valueIndices;
+        // Type of each value field in firstEvent. Values of other types are not summed.
+        std::vector<Type> valueTypes;
+    };
+
+    // Values of one value field for one numeric type, along with the row each value belongs to.
+    template <typename T>
+    struct Column {
+        std::vector<uint32_t> rows;
+        std::vector<T> values;
+    };
+
+    const size_t mNumValueFields;
+
+    std::unordered_map<HashableDimensionKey, uint32_t> mRowIndices;
+
+    std::vector<Row> mRows;
+
+    // INT and LONG values are summed in int64 and truncated back for INT, which gives the same
+    // wrapped result as summing in int32.
+    std::vector<Column<int64_t>> mLongColumns;
+
+    // FLOAT and DOUBLE values are summed in double.
+    std::vector<Column<double>> mDoubleColumns;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
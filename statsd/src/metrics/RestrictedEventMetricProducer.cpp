@@ -55,36 +55,50 @@ void RestrictedEventMetricProducer::onMatchedLogEventInternalLocked(
     if (mRestrictedDataCategory != CATEGORY_UNKNOWN &&
         mRestrictedDataCategory != event.getRestrictionCategory()) {
         StatsdStats::getInstance().noteRestrictedMetricCategoryChanged(mConfigKey, mMetricId);
-        deleteMetricTable();
-        mLogEvents.clear();
+        // The table is deleted by the next write, so that the event thread does not wait on
+        // the db.
+        mDataGeneration++;
+        mTableDeletePending = true;
+        mEventBuffer.clear();
         mTotalSize = 0;
     }
     mRestrictedDataCategory = event.getRestrictionCategory();
-    mLogEvents.push_back(event);
-    mTotalSize += getSize(event.getValues()) + sizeof(event);
+    if (!mEventBuffer.append(event)) {
+        ALOGE("Dropping event with a schema that differs from the buffered events of metric %lld",
+              (long long)mMetricId);
+        StatsdStats::getInstance().noteRestrictedMetricInsertError(mConfigKey, mMetricId);
+        return;
+    }
+    mTotalSize = mEventBuffer.byteSize();
 }
 
 void RestrictedEventMetricProducer::onDumpReportLocked(
         const int64_t dumpTimeNs, const bool include_current_partial_bucket, const bool erase_data,
         const DumpLatency dumpLatency, std::set<string>* str_set,
-        android::util::ProtoOutputStream* protoOutput) {
+        DimensionDictionary* dimensionDictionary, android::util::ProtoOutputStream* protoOutput) {
     VLOG("Unexpected call to onDumpReportLocked() in RestrictedEventMetricProducer");
 }
 
 void RestrictedEventMetricProducer::onMetricRemove() {
-    std::lock_guard<std::mutex> lock(mMutex);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEventBuffer.clear();
+        mTotalSize = 0;
+        mDataGeneration++;
+        mTableDeletePending = false;
+    }
+    std::lock_guard<std::mutex> lock(mDbMutex);
     if (!mIsMetricTableCreated) {
         return;
     }
-    deleteMetricTable();
+    deleteMetricTableDbLocked();
 }
 
-void RestrictedEventMetricProducer::enforceRestrictedDataTtl(sqlite3* db,
-                                                             const int64_t wallClockNs) {
+void RestrictedEventMetricProducer::enforceRestrictedDataTtl(const int64_t wallClockNs) {
     int32_t ttlInDays = RestrictedPolicyManager::getInstance().getRestrictedCategoryTtl(
-            mRestrictedDataCategory);
+            getRestrictionCategory());
     int64_t ttlTime = wallClockNs - ttlInDays * NS_PER_DAY;
-    dbutils::flushTtl(db, mMetricId, ttlTime);
+    dbutils::flushTtl(mConfigKey, mMetricId, ttlTime);
 }
 
 void RestrictedEventMetricProducer::clearPastBucketsLocked(const int64_t dumpTimeNs) {
@@ -92,35 +106,101 @@ void RestrictedEventMetricProducer::clearPastBucketsLocked(const int64_t dumpTim
 }
 
 void RestrictedEventMetricProducer::dropDataLocked(const int64_t dropTimeNs) {
-    mLogEvents.clear();
+    mEventBuffer.clear();
     mTotalSize = 0;
     StatsdStats::getInstance().noteBucketDropped(mMetricId);
 }
 
 void RestrictedEventMetricProducer::flushRestrictedData() {
+    // Not written through takeRestrictedDataWrite(), which holds a strong reference to the
+    // producer, so that producers that are not owned by an sp can be flushed.
+    RestrictedEventBuffer eventBuffer;
+    bool deleteTable;
+    const int64_t dataGeneration = takeEventBuffer(eventBuffer, deleteTable);
+    if (!eventBuffer.empty() || deleteTable) {
+        writeRestrictedData(eventBuffer, dataGeneration, deleteTable);
+    }
+}
+
+std::function<void()> RestrictedEventMetricProducer::takeRestrictedDataWrite() {
+    auto eventBuffer = std::make_shared<RestrictedEventBuffer>();
+    bool deleteTable;
+    const int64_t dataGeneration = takeEventBuffer(*eventBuffer, deleteTable);
+    if (eventBuffer->empty() && !deleteTable) {
+        return nullptr;
+    }
+    sp<RestrictedEventMetricProducer> producer = this;
+    return [producer, eventBuffer, dataGeneration, deleteTable] {
+        producer->writeRestrictedData(*eventBuffer, dataGeneration, deleteTable);
+    };
+}
+
+int64_t RestrictedEventMetricProducer::takeEventBuffer(RestrictedEventBuffer& eventBuffer,
+                                                       bool& deleteTable) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::swap(eventBuffer, mEventBuffer);
+    mTotalSize = 0;
+    deleteTable = mTableDeletePending;
+    mTableDeletePending = false;
+    return mDataGeneration;
+}
+
+void RestrictedEventMetricProducer::writeRestrictedData(RestrictedEventBuffer& eventBuffer,
+                                                        const int64_t dataGeneration,
+                                                        const bool deleteTable) {
+    // mMutex is not held while writing to the db, so that the writes run on the db writer thread
+    // do not block matching events.
+    if (writeToDb(eventBuffer, dataGeneration, deleteTable)) {
+        return;
+    }
+    // Keep the events to retry on the next flush.
     std::lock_guard<std::mutex> lock(mMutex);
-    if (mLogEvents.empty()) {
+    if (dataGeneration != mDataGeneration) {
+        return;
+    }
+    if (!eventBuffer.append(mEventBuffer)) {
+        // The events matched since the flush have another schema, and cannot be written to the
+        // same table. Keep them rather than the events that failed.
+        StatsdStats::getInstance().noteRestrictedMetricInsertError(mConfigKey, mMetricId);
         return;
     }
+    std::swap(mEventBuffer, eventBuffer);
+    mTotalSize = mEventBuffer.byteSize();
+}
+
+bool RestrictedEventMetricProducer::writeToDb(const RestrictedEventBuffer& eventBuffer,
+                                              const int64_t dataGeneration,
+                                              const bool deleteTable) {
+    std::lock_guard<std::mutex> lock(mDbMutex);
+    if (dataGeneration != mDataGeneration) {
+        // The data was discarded while the events were waiting to be written.
+        return true;
+    }
+    if (deleteTable) {
+        deleteMetricTableDbLocked();
+    }
+    if (eventBuffer.empty()) {
+        return true;
+    }
     int64_t flushStartNs = getElapsedRealtimeNs();
     if (!mIsMetricTableCreated) {
-        if (!dbutils::isEventCompatible(mConfigKey, mMetricId, mLogEvents[0])) {
+        if (!dbutils::isEventCompatible(mConfigKey, mMetricId, eventBuffer)) {
             // Delete old data if schema changes
             // TODO(b/268150038): report error to statsdstats
             ALOGD("Detected schema change for metric %lld", (long long)mMetricId);
-            deleteMetricTable();
+            deleteMetricTableDbLocked();
         }
         // TODO(b/271481944): add retry.
-        if (!dbutils::createTableIfNeeded(mConfigKey, mMetricId, mLogEvents[0])) {
+        if (!dbutils::createTableIfNeeded(mConfigKey, mMetricId, eventBuffer)) {
             ALOGE("Failed to create table for metric %lld", (long long)mMetricId);
             StatsdStats::getInstance().noteRestrictedMetricTableCreationError(mConfigKey,
                                                                               mMetricId);
-            return;
+            return false;
         }
         mIsMetricTableCreated = true;
     }
     string err;
-    if (!dbutils::insert(mConfigKey, mMetricId, mLogEvents, err)) {
+    if (!dbutils::insert(mConfigKey, mMetricId, eventBuffer, err)) {
         ALOGE("Failed to insert logEvent to table for metric %lld. err=%s", (long long)mMetricId,
               err.c_str());
         StatsdStats::getInstance().noteRestrictedMetricInsertError(mConfigKey, mMetricId);
@@ -128,8 +208,7 @@ void RestrictedEventMetricProducer::flushRestrictedData() {
         StatsdStats::getInstance().noteRestrictedMetricFlushLatency(
                 mConfigKey, mMetricId, getElapsedRealtimeNs() - flushStartNs);
     }
-    mLogEvents.clear();
-    mTotalSize = 0;
+    return true;
 }
 
 bool RestrictedEventMetricProducer::writeMetricMetadataToProto(
@@ -145,7 +224,7 @@ void RestrictedEventMetricProducer::loadMetricMetadataFromProto(
             static_cast<StatsdRestrictionCategory>(metricMetadata.restricted_category());
 }
 
-void RestrictedEventMetricProducer::deleteMetricTable() {
+void RestrictedEventMetricProducer::deleteMetricTableDbLocked() {
     if (!dbutils::deleteTable(mConfigKey, mMetricId)) {
         StatsdStats::getInstance().noteRestrictedMetricTableDeletionError(mConfigKey, mMetricId);
         VLOG("Failed to delete table for metric %lld", (long long)mMetricId);
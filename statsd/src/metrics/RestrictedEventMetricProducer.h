@@ -3,7 +3,10 @@
 
 #include <gtest/gtest_prod.h>
 
+#include <atomic>
+
 #include "EventMetricProducer.h"
+#include "utils/RestrictedEventBuffer.h"
 #include "utils/RestrictedPolicyManager.h"
 
 namespace android {
@@ -24,10 +27,12 @@ public:
 
     void onMetricRemove() override;
 
-    void enforceRestrictedDataTtl(sqlite3* db, const int64_t wallClockNs);
+    void enforceRestrictedDataTtl(const int64_t wallClockNs) override;
 
     void flushRestrictedData() override;
 
+    std::function<void()> takeRestrictedDataWrite() override;
+
     bool writeMetricMetadataToProto(metadata::MetricMetadata* metricMetadata) override;
 
     void loadMetricMetadataFromProto(const metadata::MetricMetadata& metricMetadata) override;
@@ -46,19 +51,49 @@ private:
     void onDumpReportLocked(const int64_t dumpTimeNs, const bool include_current_partial_bucket,
                             const bool erase_data, const DumpLatency dumpLatency,
                             std::set<string>* str_set,
+                            DimensionDictionary* dimensionDictionary,
                             android::util::ProtoOutputStream* protoOutput) override;
 
     void clearPastBucketsLocked(const int64_t dumpTimeNs) override;
 
     void dropDataLocked(const int64_t dropTimeNs) override;
 
-    void deleteMetricTable();
+    // Moves the buffered events into eventBuffer, which must be empty, and returns the current
+    // data generation. deleteTable is set if the table must be deleted before the write.
+    int64_t takeEventBuffer(RestrictedEventBuffer& eventBuffer, bool& deleteTable);
+
+    // Writes the events taken by takeRestrictedDataWrite(). They are put back in memory if the
+    // table could not be created.
+    void writeRestrictedData(RestrictedEventBuffer& eventBuffer, const int64_t dataGeneration,
+                             const bool deleteTable);
+
+    // Writes the events to the metric table, after deleting it if deleteTable is set, unless the
+    // data of the metric was discarded since dataGeneration. Returns false if the table could not
+    // be created, in which case the events are not written.
+    bool writeToDb(const RestrictedEventBuffer& eventBuffer, const int64_t dataGeneration,
+                   const bool deleteTable);
+
+    void deleteMetricTableDbLocked();
+
+    // Serializes the writes to the metric table, which may run on the db writer thread. Guards
+    // mIsMetricTableCreated. Never acquired on the log event path, and after mMutex when both are
+    // needed.
+    std::mutex mDbMutex;
 
     bool mIsMetricTableCreated = false;
 
+    // Incremented under mMutex when the data of the metric is discarded, so that events that were
+    // taken for a flush before are not written. Read by the writes without mMutex.
+    std::atomic<int64_t> mDataGeneration{0};
+
+    // Set when the restriction category changes, until the next write deletes the table. Guarded
+    // by mMutex.
+    bool mTableDeletePending = false;
+
     StatsdRestrictionCategory mRestrictedDataCategory;
 
-    vector<LogEvent> mLogEvents;
+    // Events waiting to be written to the metric table.
+    RestrictedEventBuffer mEventBuffer;
 };
 
 }  // namespace statsd
@@ -23,6 +23,8 @@
 #include <limits.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include "FieldValue.h"
 #include "HashableDimensionKey.h"
 #include "guardrail/StatsdStats.h"
@@ -68,6 +70,7 @@ const int FIELD_ID_DROP_TIME = 2;
 const int FIELD_ID_DIMENSION_IN_WHAT = 1;
 const int FIELD_ID_BUCKET_INFO = 3;
 const int FIELD_ID_DIMENSION_LEAF_IN_WHAT = 4;
+const int FIELD_ID_DIMENSION_IN_WHAT_INDEX = 7;
 const int FIELD_ID_SLICE_BY_STATE = 6;
 
 template <typename AggregatedValue, typename DimExtras>
@@ -108,6 +111,7 @@ ValueMetricProducer<AggregatedValue, DimExtras>::ValueMetricProducer(
             mc.conditionId = link.condition();
             translateFieldMatcher(link.fields_in_what(), &mc.metricFields);
             translateFieldMatcher(link.fields_in_condition(), &mc.conditionFields);
+            initMetric2ConditionValueIndices(&mc);
             mMetric2ConditionLinks.push_back(mc);
         }
 
@@ -130,7 +134,7 @@ ValueMetricProducer<AggregatedValue, DimExtras>::ValueMetricProducer(
 
     if (isPulled()) {
         mPullerManager->RegisterReceiver(mPullAtomId, mConfigKey, this, getCurrentBucketEndTimeNs(),
-                                         mBucketSizeNs);
+                                         mBucketSizeNs, pullOptions.maxPullDelayNs);
     }
 
     // Only do this for partial buckets like first bucket. All other buckets should use
@@ -266,6 +270,49 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::onStateChanged(
     flushIfNeededLocked(eventTimeNs);
 }
 
+template <typename AggregatedValue, typename DimExtras>
+void ValueMetricProducer<AggregatedValue, DimExtras>::onStateReset(
+        int64_t eventTimeNs, int32_t atomId, const std::vector<StateChange>& changes,
+        const FieldValue& newState) {
+    // TODO(b/189353769): Acquire lock.
+    VLOG("ValueMetricProducer %lld onStateReset time %lld, State %d, %zu keys -> %d",
+         (long long)mMetricId, (long long)eventTimeNs, atomId, changes.size(),
+         newState.mValue.int_value);
+
+    // If all the old states are in the same StateGroup as the new state, then we do not need to
+    // pull for this reset.
+    FieldValue newStateCopy = newState;
+    mapStateValue(atomId, &newStateCopy);
+    const bool stateGroupChanged =
+            std::any_of(changes.begin(), changes.end(), [&](const StateChange& change) {
+                FieldValue oldStateCopy = change.oldState;
+                mapStateValue(atomId, &oldStateCopy);
+                return oldStateCopy != newStateCopy;
+            });
+    if (!stateGroupChanged) {
+        return;
+    }
+
+    if (mCondition != ConditionState::kTrue || !mIsActive) {
+        return;
+    }
+
+    if (isEventLateLocked(eventTimeNs)) {
+        VLOG("Skip event due to late arrival: %lld vs %lld", (long long)eventTimeNs,
+             (long long)mCurrentBucketStartTimeNs);
+        invalidateCurrentBucket(eventTimeNs, BucketDropReason::EVENT_IN_WRONG_BUCKET);
+        return;
+    }
+
+    if (isPulled()) {
+        // The pulled data is not filtered by primary key, as it is for the change of a single
+        // primary key. The dimensions whose state did not change are accumulated into the state
+        // they stay in, as on a bucket boundary.
+        pullAndMatchEventsLocked(eventTimeNs);
+    }
+    flushIfNeededLocked(eventTimeNs);
+}
+
 template <typename AggregatedValue, typename DimExtras>
 void ValueMetricProducer<AggregatedValue, DimExtras>::onSlicedConditionMayChangeLocked(
         bool overallCondition, const int64_t eventTime) {
@@ -292,7 +339,8 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::clearPastBucketsLocked(
 template <typename AggregatedValue, typename DimExtras>
 void ValueMetricProducer<AggregatedValue, DimExtras>::onDumpReportLocked(
         const int64_t dumpTimeNs, const bool includeCurrentPartialBucket, const bool eraseData,
-        const DumpLatency dumpLatency, set<string>* strSet, ProtoOutputStream* protoOutput) {
+        const DumpLatency dumpLatency, set<string>* strSet,
+        DimensionDictionary* dimensionDictionary, ProtoOutputStream* protoOutput) {
     VLOG("metric %lld dump report now...", (long long)mMetricId);
 
     // Pulled metrics need to pull before flushing, which is why they do not call flushIfNeeded.
@@ -369,7 +417,11 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::onDumpReportLocked(
                 protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_DATA);
 
         // First fill dimension.
-        if (mShouldUseNestedDimensions) {
+        if (dimensionDictionary != nullptr) {
+            writeDimensionIndexToProto(metricDimensionKey.getDimensionKeyInWhat(),
+                                       FIELD_ID_DIMENSION_IN_WHAT_INDEX, dimensionDictionary,
+                                       protoOutput);
+        } else if (mShouldUseNestedDimensions) {
             uint64_t dimensionToken =
                     protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_ID_DIMENSION_IN_WHAT);
             writeDimensionToProto(metricDimensionKey.getDimensionKeyInWhat(), strSet, protoOutput);
@@ -622,11 +674,13 @@ bool ValueMetricProducer<AggregatedValue, DimExtras>::hitGuardRailLocked(
     if (mCurrentSlicedBucket.find(newKey) != mCurrentSlicedBucket.end()) {
         return false;
     }
+    noteNewDimensionKeyLocked(std::hash<MetricDimensionKey>{}(newKey), mDimensionHardLimit);
     if (mCurrentSlicedBucket.size() > mDimensionSoftLimit - 1) {
         size_t newTupleCount = mCurrentSlicedBucket.size() + 1;
         StatsdStats::getInstance().noteMetricDimensionSize(mConfigKey, mMetricId, newTupleCount);
         // 2. Don't add more tuples, we are above the allowed threshold. Drop the data.
-        if (hasReachedGuardRailLimit()) {
+        if (hasReachedGuardRailLimit() ||
+            exceedsDimensionCardinalityLimitLocked(mDimensionHardLimit)) {
             if (!mHasHitGuardrail) {
                 ALOGE("ValueMetricProducer %lld dropping data for dimension key %s",
                       (long long)mMetricId, newKey.toString().c_str());
@@ -884,6 +938,7 @@ void ValueMetricProducer<AggregatedValue, DimExtras>::initNextSlicedBucket(
     mCurrentSkippedBucket.reset();
 
     mCurrentBucketStartTimeNs = nextBucketStartTimeNs;
+    closeDimensionCardinalityBucketLocked();
     // Reset mHasHitGuardrail boolean since bucket was reset
     mHasHitGuardrail = false;
     VLOG("metric %lld: new bucket start time: %lld", (long long)mMetricId,
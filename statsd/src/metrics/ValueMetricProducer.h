@@ -70,6 +70,7 @@ public:
     struct PullOptions {
         const int pullAtomId;
         const sp<StatsPullerManager>& pullerManager;
+        const int64_t maxPullDelayNs;
     };
 
     struct BucketOptions {
@@ -132,6 +133,10 @@ public:
     void onStateChanged(int64_t eventTimeNs, int32_t atomId, const HashableDimensionKey& primaryKey,
                         const FieldValue& oldState, const FieldValue& newState) override;
 
+    // Pulls once for all the primary keys of a reset, instead of once per primary key.
+    void onStateReset(int64_t eventTimeNs, int32_t atomId, const std::vector<StateChange>& changes,
+                      const FieldValue& newState) override;
+
 protected:
     ValueMetricProducer(const int64_t& metricId, const ConfigKey& key, const uint64_t protoHash,
                         const PullOptions& pullOptions, const BucketOptions& bucketOptions,
@@ -155,6 +160,7 @@ protected:
     void onDumpReportLocked(const int64_t dumpTimeNs, const bool includeCurrentPartialBucket,
                             const bool eraseData, const DumpLatency dumpLatency,
                             std::set<string>* strSet,
+                            DimensionDictionary* dimensionDictionary,
                             android::util::ProtoOutputStream* protoOutput) override;
 
     struct DumpProtoFields {
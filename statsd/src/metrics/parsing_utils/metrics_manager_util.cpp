@@ -943,8 +943,12 @@ optional<sp<MetricProducer>> createNumericValueMetricProducerAndUpdateMetadata(
                     ? optional<int64_t>(metric.condition_correction_threshold_nanos())
                     : nullopt;
 
+    const int64_t maxPullDelayNs = metric.has_max_pull_delay_sec()
+                                           ? metric.max_pull_delay_sec() * NS_PER_SEC
+                                           : StatsdStats::kPullMaxDelayNs;
+
     sp<MetricProducer> metricProducer = new NumericValueMetricProducer(
-            key, metric, metricHash, {pullTagId, pullerManager},
+            key, metric, metricHash, {pullTagId, pullerManager, maxPullDelayNs},
             {timeBaseNs, currentTimeNs, bucketSizeNs, metric.min_bucket_size_nanos(),
              conditionCorrectionThresholdNs, getAppUpgradeBucketSplit(metric)},
             {containsAnyPositionInDimensionsInWhat, shouldUseNestedDimensions, trackerIndex,
@@ -1097,7 +1101,8 @@ optional<sp<MetricProducer>> createKllMetricProducerAndUpdateMetadata(
                     StatsdStats::clampDimensionKeySizeLimit(metric.max_dimensions_per_bucket()));
 
     sp<MetricProducer> metricProducer = new KllMetricProducer(
-            key, metric, metricHash, {/*pullTagId=*/-1, pullerManager},
+            key, metric, metricHash,
+            {/*pullTagId=*/-1, pullerManager, StatsdStats::kPullMaxDelayNs},
             {timeBaseNs, currentTimeNs, bucketSizeNs, metric.min_bucket_size_nanos(),
              /*conditionCorrectionThresholdNs=*/nullopt, getAppUpgradeBucketSplit(metric)},
             {containsAnyPositionInDimensionsInWhat, shouldUseNestedDimensions, trackerIndex,
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <optional>
+
+#include "FieldValue.h"
+#include "src/statsd_config.pb.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Diff and aggregation kernels for ValueMetric values.
+ *
+ * The kernels are templated on the value representation. They are instantiated with int64_t and
+ * double once the type of a value field has been resolved, so that each arithmetic operation does
+ * not have to switch on Value::type. Instantiating them with Value keeps the type-checked
+ * behavior of the Value operators for mismatched types.
+ */
+
+// Returns the diff between value and base according to direction, or nullopt if the value moved
+// in the unexpected direction and useAbsoluteValueOnReset is false.
+template <typename T>
+std::optional<T> computeValueDiff(const T& value, const T& base,
+                                  const ValueMetric::ValueDirection direction,
+                                  const bool useAbsoluteValueOnReset) {
+    switch (direction) {
+        case ValueMetric::INCREASING:
+            if (value >= base) {
+                return value - base;
+            }
+            if (useAbsoluteValueOnReset) {
+                return value;
+            }
+            return std::nullopt;
+        case ValueMetric::DECREASING:
+            if (base >= value) {
+                return base - value;
+            }
+            if (useAbsoluteValueOnReset) {
+                return value;
+            }
+            return std::nullopt;
+        case ValueMetric::ANY:
+            return value - base;
+        default:
+            return T();
+    }
+}
+
+// Folds value into aggregate. AVG is summed here and divided when the bucket is flushed.
+template <typename T>
+void aggregateValue(const T& value, const ValueMetric::AggregationType aggregationType,
+                    T& aggregate) {
+    switch (aggregationType) {
+        case ValueMetric::SUM:
+        case ValueMetric::AVG:
+            aggregate += value;
+            break;
+        case ValueMetric::MIN:
+            aggregate = std::min(value, aggregate);
+            break;
+        case ValueMetric::MAX:
+            aggregate = std::max(value, aggregate);
+            break;
+        default:
+            break;
+    }
+}
+
+// Typed dispatch of computeValueDiff for LONG and DOUBLE values.
+inline std::optional<Value> computeValueDiff(const Value& value, const Value& base,
+                                             const ValueMetric::ValueDirection direction,
+                                             const bool useAbsoluteValueOnReset) {
+    if (value.getType() == base.getType()) {
+        if (value.getType() == LONG) {
+            const std::optional<int64_t> diff = computeValueDiff<int64_t>(
+                    value.long_value, base.long_value, direction, useAbsoluteValueOnReset);
+            return diff ? std::make_optional<Value>(*diff) : std::nullopt;
+        }
+        if (value.getType() == DOUBLE) {
+            const std::optional<double> diff = computeValueDiff<double>(
+                    value.double_value, base.double_value, direction, useAbsoluteValueOnReset);
+            return diff ? std::make_optional<Value>(*diff) : std::nullopt;
+        }
+    }
+    return computeValueDiff<Value>(value, base, direction, useAbsoluteValueOnReset);
+}
+
+// Typed dispatch of aggregateValue for LONG and DOUBLE values.
+inline void aggregateValue(const Value& value, const ValueMetric::AggregationType aggregationType,
+                           Value& aggregate) {
+    if (value.getType() == aggregate.getType()) {
+        if (value.getType() == LONG) {
+            aggregateValue<int64_t>(value.long_value, aggregationType, aggregate.long_value);
+            return;
+        }
+        if (value.getType() == DOUBLE) {
+            aggregateValue<double>(value.double_value, aggregationType, aggregate.double_value);
+            return;
+        }
+    }
+    aggregateValue<Value>(value, aggregationType, aggregate);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -17,12 +17,25 @@
 
 #include <utils/RefBase.h>
 
+#include <vector>
+
 #include "HashableDimensionKey.h"
 
 namespace android {
 namespace os {
 namespace statsd {
 
+/**
+ * A primary key whose state changed, along with its previous state value.
+ */
+struct StateChange {
+    StateChange(const HashableDimensionKey& primaryKey, const FieldValue& oldState)
+        : primaryKey(primaryKey), oldState(oldState){};
+
+    const HashableDimensionKey& primaryKey;
+    FieldValue oldState;
+};
+
 class StateListener : public virtual RefBase {
 public:
     StateListener(){};
@@ -47,6 +60,25 @@ public:
     virtual void onStateChanged(const int64_t eventTimeNs, const int32_t atomId,
                                 const HashableDimensionKey& primaryKey, const FieldValue& oldState,
                                 const FieldValue& newState) = 0;
+
+    /**
+     * Interface for handling a reset event, which sets every primary key of a
+     * state atom to the same state.
+     *
+     * The default implementation calls onStateChanged once per change.
+     *
+     * [eventTimeNs]: Time of the state reset log event.
+     * [atomId]: The id of the state atom
+     * [changes]: The primary keys whose state changed and their previous state values
+     * [newState]: State value of every changed primary key after the reset
+     */
+    virtual void onStateReset(const int64_t eventTimeNs, const int32_t atomId,
+                              const std::vector<StateChange>& changes,
+                              const FieldValue& newState) {
+        for (const StateChange& change : changes) {
+            onStateChanged(eventTimeNs, atomId, change.primaryKey, change.oldState, newState);
+        }
+    }
 };
 
 }  // namespace statsd
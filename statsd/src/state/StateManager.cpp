@@ -21,6 +21,8 @@
 
 #include <private/android_filesystem_config.h>
 
+#include <algorithm>
+
 namespace android {
 namespace os {
 namespace statsd {
@@ -38,27 +40,33 @@ StateManager& StateManager::getInstance() {
 
 void StateManager::clear() {
     mStateTrackers.clear();
+    updateStateTrackersByAtomId();
 }
 
 void StateManager::onLogEvent(const LogEvent& event) {
+    // Most events are not state events, so check for a tracker before checking the uid.
+    StateTracker* stateTracker = getStateTracker(event.GetTagId());
+    if (stateTracker == nullptr) {
+        return;
+    }
     // Only process state events from uids in AID_* and packages that are whitelisted in
     // mAllowedPkg.
     // Allowlisted AIDs are AID_ROOT and all AIDs in [1000, 2000) which is [AID_SYSTEM, AID_SHELL)
     if (event.GetUid() == AID_ROOT ||
         (event.GetUid() >= AID_SYSTEM && event.GetUid() < AID_SHELL) ||
         mAllowedLogSources.find(event.GetUid()) != mAllowedLogSources.end()) {
-        if (mStateTrackers.find(event.GetTagId()) != mStateTrackers.end()) {
-            mStateTrackers[event.GetTagId()]->onLogEvent(event);
-        }
+        stateTracker->onLogEvent(event);
     }
 }
 
 void StateManager::registerListener(const int32_t atomId, wp<StateListener> listener) {
     // Check if state tracker already exists.
-    if (mStateTrackers.find(atomId) == mStateTrackers.end()) {
-        mStateTrackers[atomId] = new StateTracker(atomId);
+    auto it = mStateTrackers.find(atomId);
+    if (it == mStateTrackers.end()) {
+        it = mStateTrackers.emplace(atomId, new StateTracker(atomId)).first;
+        updateStateTrackersByAtomId();
     }
-    mStateTrackers[atomId]->registerListener(listener);
+    it->second->registerListener(listener);
 }
 
 void StateManager::unregisterListener(const int32_t atomId, wp<StateListener> listener) {
@@ -77,6 +85,7 @@ void StateManager::unregisterListener(const int32_t atomId, wp<StateListener> li
         if (it->second->getListenersCount() == 0) {
             toRemove = it->second;
             mStateTrackers.erase(it);
+            updateStateTrackersByAtomId();
         }
     } else {
         ALOGE("StateManager cannot unregister listener, StateTracker for atom %d does not exist",
@@ -109,6 +118,24 @@ void StateManager::notifyAppChanged(const string& apk, const sp<UidMap>& uidMap)
     }
 }
 
+void StateManager::updateStateTrackersByAtomId() {
+    int32_t maxIndexedAtomId = -1;
+    mHasUnindexedStateTrackers = false;
+    for (const auto& [atomId, _] : mStateTrackers) {
+        if (atomId >= 0 && atomId <= kMaxIndexedAtomId) {
+            maxIndexedAtomId = std::max(maxIndexedAtomId, atomId);
+        } else {
+            mHasUnindexedStateTrackers = true;
+        }
+    }
+    mStateTrackersByAtomId.assign(maxIndexedAtomId + 1, nullptr);
+    for (const auto& [atomId, stateTracker] : mStateTrackers) {
+        if (atomId >= 0 && atomId <= kMaxIndexedAtomId) {
+            mStateTrackersByAtomId[atomId] = stateTracker.get();
+        }
+    }
+}
+
 void StateManager::addAllAtomIds(LogEventFilter::AtomIdSet& allIds) const {
     for (const auto& stateTracker : mStateTrackers) {
         allIds.insert(stateTracker.first);
@@ -21,6 +21,7 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "HashableDimensionKey.h"
 #include "packages/UidMap.h"
@@ -88,11 +89,37 @@ public:
     void addAllAtomIds(LogEventFilter::AtomIdSet& allIds) const;
 
 private:
+    // State atoms are platform atoms, so their ids are small enough to index an array.
+    static const int32_t kMaxIndexedAtomId = 10000;
+
+    // Returns the StateTracker of the given atom, or nullptr if there is none.
+    inline StateTracker* getStateTracker(const int32_t atomId) const {
+        if (atomId >= 0 && atomId < (int32_t)mStateTrackersByAtomId.size()) {
+            return mStateTrackersByAtomId[atomId];
+        }
+        if (!mHasUnindexedStateTrackers) {
+            return nullptr;
+        }
+        auto it = mStateTrackers.find(atomId);
+        return it != mStateTrackers.end() ? it->second.get() : nullptr;
+    }
+
+    // Rebuilds mStateTrackersByAtomId from mStateTrackers.
+    void updateStateTrackersByAtomId();
+
     mutable std::mutex mMutex;
 
     // Maps state atom ids to StateTrackers
     std::unordered_map<int32_t, sp<StateTracker>> mStateTrackers;
 
+    // StateTrackers indexed by atom id, for the trackers whose atom id is at most
+    // kMaxIndexedAtomId. Sized to the largest such atom id, so events of atoms without a tracker
+    // are dropped after a bounds check and a load. The trackers are owned by mStateTrackers.
+    std::vector<StateTracker*> mStateTrackersByAtomId;
+
+    // True if mStateTrackers has trackers that are not in mStateTrackersByAtomId.
+    bool mHasUnindexedStateTrackers = false;
+
     // The package names that can log state events.
     const std::set<std::string> mAllowedPkg;
 
@@ -32,13 +32,13 @@ void StateTracker::onLogEvent(const LogEvent& event) {
     const int64_t eventTimeNs = event.GetElapsedTimestampNs();
 
     // Parse event for primary field values i.e. primary key.
-    HashableDimensionKey primaryKey;
-    filterPrimaryKey(event.getValues(), &primaryKey);
+    mPrimaryKeyBuffer.mutableValues()->clear();
+    filterPrimaryKey(event.getValues(), &mPrimaryKeyBuffer);
 
     FieldValue newState;
     if (!getStateFieldValueFromLogEvent(event, &newState)) {
         ALOGE("StateTracker error extracting state from log event. Missing exclusive state field.");
-        clearStateForPrimaryKey(eventTimeNs, primaryKey);
+        clearStateForPrimaryKey(eventTimeNs, mPrimaryKeyBuffer);
         return;
     }
 
@@ -47,7 +47,7 @@ void StateTracker::onLogEvent(const LogEvent& event) {
     if (newState.mValue.getType() != INT) {
         ALOGE("StateTracker error extracting state from log event. Type: %d",
               newState.mValue.getType());
-        clearStateForPrimaryKey(eventTimeNs, primaryKey);
+        clearStateForPrimaryKey(eventTimeNs, mPrimaryKeyBuffer);
         return;
     }
 
@@ -59,7 +59,8 @@ void StateTracker::onLogEvent(const LogEvent& event) {
     }
 
     const bool nested = newState.mAnnotations.isNested();
-    updateStateForPrimaryKey(eventTimeNs, primaryKey, newState, nested, mStateMap[primaryKey]);
+    updateStateForPrimaryKey(eventTimeNs, mPrimaryKeyBuffer, newState, nested,
+                             mStateMap[mPrimaryKeyBuffer]);
 }
 
 void StateTracker::registerListener(wp<StateListener> listener) {
@@ -86,10 +87,30 @@ bool StateTracker::getStateValue(const HashableDimensionKey& queryKey, FieldValu
 
 void StateTracker::handleReset(const int64_t eventTimeNs, const FieldValue& newState) {
     VLOG("StateTracker handle reset");
+    // Every primary key is treated as not nested and moves to the reset state. Listeners are
+    // notified once with all the changes rather than once per primary key.
+    const int32_t newStateValue = newState.mValue.int_value;
+    std::vector<StateChange> changes;
     for (auto& [primaryKey, stateValueInfo] : mStateMap) {
-        updateStateForPrimaryKey(eventTimeNs, primaryKey, newState,
-                                 false /* nested; treat this state change as not nested */,
-                                 stateValueInfo);
+        if (stateValueInfo.state != newStateValue) {
+            changes.emplace_back(primaryKey, FieldValue(mField, Value(stateValueInfo.state)));
+            stateValueInfo.state = newStateValue;
+            stateValueInfo.count = 1;
+        }
+    }
+    if (!changes.empty()) {
+        for (auto l : mListeners) {
+            auto sl = l.promote();
+            if (sl != nullptr) {
+                sl->onStateReset(eventTimeNs, mField.getTag(), changes, newState);
+            }
+        }
+    }
+    // As in updateStateForPrimaryKey, primary keys whose state is now unknown are not kept in the
+    // map. The changes refer to the primary keys in the map, so they are erased only after the
+    // listeners are notified.
+    if (newStateValue == kStateUnknown) {
+        mStateMap.clear();
     }
 }
 
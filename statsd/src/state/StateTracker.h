@@ -68,10 +68,15 @@ private:
     // Maps primary key to state value info
     std::unordered_map<HashableDimensionKey, StateValueInfo> mStateMap;
 
+    // Holds the primary key of the event being processed. Reused across events so that its
+    // values are not reallocated for every event.
+    HashableDimensionKey mPrimaryKeyBuffer;
+
     // Set of all StateListeners (objects listening for state changes)
     std::set<wp<StateListener>> mListeners;
 
-    // Reset all state values in map to the given state.
+    // Reset all state values in map to the given state. The entries are erased if the state is
+    // kStateUnknown.
     void handleReset(const int64_t eventTimeNs, const FieldValue& newState);
 
     // Clears the state value mapped to the given primary key by setting it to kStateUnknown.
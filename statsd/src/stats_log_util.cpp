@@ -85,6 +85,9 @@ const int FIELD_ID_PULL_TIMEOUT_METADATA = 22;
 const int FIELD_ID_PULL_TIMEOUT_METADATA_UPTIME_MILLIS = 1;
 const int FIELD_ID_PULL_TIMEOUT_METADATA_ELAPSED_MILLIS = 2;
 const int FIELD_ID_SUBSCRIPTION_PULL_COUNT = 23;
+const int FIELD_ID_COALESCED_PULL_COUNT = 24;
+const int FIELD_ID_BATCHED_PULL_COUNT = 25;
+const int FIELD_ID_MAX_PULL_BATCHING_DELAY_NS = 26;
 
 // for AtomMetricStats proto
 const int FIELD_ID_ATOM_METRIC_STATS = 17;
@@ -100,6 +103,7 @@ const int FIELD_ID_MIN_BUCKET_BOUNDARY_DELAY_NS = 9;
 const int FIELD_ID_MAX_BUCKET_BOUNDARY_DELAY_NS = 10;
 const int FIELD_ID_BUCKET_UNKNOWN_CONDITION = 11;
 const int FIELD_ID_BUCKET_COUNT = 12;
+const int FIELD_ID_MAX_DIMENSION_CARDINALITY_ESTIMATE = 16;
 
 namespace {
 
@@ -310,6 +314,39 @@ void writeDimensionPathToProto(const std::vector<Matcher>& fieldMatchers,
     protoOutput->end(topToken);
 }
 
+int DimensionDictionary::getOrAddIndex(const HashableDimensionKey& dimension) {
+    auto it = mIndices.find(dimension);
+    if (it != mIndices.end()) {
+        return it->second;
+    }
+    const int index = mDimensions.size();
+    it = mIndices.emplace(dimension, index).first;
+    mDimensions.push_back(&it->first);
+    return index;
+}
+
+void writeDimensionIndexToProto(const HashableDimensionKey& dimension,
+                                const int dimensionIndexFieldId,
+                                DimensionDictionary* dimensionDictionary,
+                                ProtoOutputStream* protoOutput) {
+    if (dimension.getValues().size() == 0) {
+        return;
+    }
+    protoOutput->write(FIELD_TYPE_INT32 | dimensionIndexFieldId,
+                       dimensionDictionary->getOrAddIndex(dimension));
+}
+
+void writeDimensionDictionaryToProto(const DimensionDictionary& dimensionDictionary,
+                                     const int dimensionDictionaryFieldId,
+                                     std::set<string>* str_set, ProtoOutputStream* protoOutput) {
+    for (const HashableDimensionKey* dimension : dimensionDictionary.getDimensions()) {
+        uint64_t token = protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED |
+                                            dimensionDictionaryFieldId);
+        writeDimensionToProto(*dimension, str_set, protoOutput);
+        protoOutput->end(token);
+    }
+}
+
 // Supported Atoms format
 // XYZ_Atom {
 //     repeated SubMsg field_1 = 1;
@@ -519,6 +556,12 @@ void writePullerStatsToStream(const std::pair<int, StatsdStats::PulledAtomStats>
     }
     writeNonZeroStatToStream(FIELD_TYPE_INT32 | FIELD_ID_SUBSCRIPTION_PULL_COUNT,
                              pair.second.subscriptionPullCount, protoOutput);
+    writeNonZeroStatToStream(FIELD_TYPE_INT64 | FIELD_ID_COALESCED_PULL_COUNT,
+                             (long long)pair.second.coalescedPullCount, protoOutput);
+    writeNonZeroStatToStream(FIELD_TYPE_INT64 | FIELD_ID_BATCHED_PULL_COUNT,
+                             (long long)pair.second.batchedPullCount, protoOutput);
+    writeNonZeroStatToStream(FIELD_TYPE_INT64 | FIELD_ID_MAX_PULL_BATCHING_DELAY_NS,
+                             (long long)pair.second.maxPullBatchingDelayNs, protoOutput);
     protoOutput->end(token);
 }
 
@@ -551,6 +594,8 @@ void writeAtomMetricStatsToStream(const std::pair<int64_t, StatsdStats::AtomMetr
                              (long long)pair.second.bucketUnknownCondition, protoOutput);
     writeNonZeroStatToStream(FIELD_TYPE_INT64 | FIELD_ID_BUCKET_COUNT,
                              (long long)pair.second.bucketCount, protoOutput);
+    writeNonZeroStatToStream(FIELD_TYPE_INT64 | FIELD_ID_MAX_DIMENSION_CARDINALITY_ESTIMATE,
+                             (long long)pair.second.maxDimensionCardinalityEstimate, protoOutput);
     protoOutput->end(token);
 }
 
@@ -18,6 +18,8 @@
 
 #include <android/util/ProtoOutputStream.h>
 
+#include <unordered_map>
+
 #include "FieldValue.h"
 #include "HashableDimensionKey.h"
 #include "src/statsd_config.pb.h"
@@ -44,6 +46,39 @@ void writeDimensionLeafNodesToProto(const HashableDimensionKey& dimension,
 void writeDimensionPathToProto(const std::vector<Matcher>& fieldMatchers,
                                ProtoOutputStream* protoOutput);
 
+// Report-level dictionary of dimension keys. Each distinct dimension key written while dumping
+// a config is stored once and referenced by its index from the metric data of every metric.
+class DimensionDictionary {
+public:
+    // Returns the index of the dimension in the dictionary, adding it if it is not present.
+    int getOrAddIndex(const HashableDimensionKey& dimension);
+
+    inline size_t size() const {
+        return mDimensions.size();
+    }
+
+    inline const std::vector<const HashableDimensionKey*>& getDimensions() const {
+        return mDimensions;
+    }
+
+private:
+    std::unordered_map<HashableDimensionKey, int> mIndices;
+
+    // Points to the keys of mIndices, ordered by index.
+    std::vector<const HashableDimensionKey*> mDimensions;
+};
+
+// Writes the dictionary index of the dimension to [dimensionIndexFieldId].
+void writeDimensionIndexToProto(const HashableDimensionKey& dimension,
+                                const int dimensionIndexFieldId,
+                                DimensionDictionary* dimensionDictionary,
+                                ProtoOutputStream* protoOutput);
+
+// Writes every dimension in the dictionary as a repeated DimensionsValue, in index order.
+void writeDimensionDictionaryToProto(const DimensionDictionary& dimensionDictionary,
+                                     const int dimensionDictionaryFieldId,
+                                     std::set<string>* str_set, ProtoOutputStream* protoOutput);
+
 void writeStateToProto(const FieldValue& state, ProtoOutputStream* protoOutput);
 
 // Convert the TimeUnit enum to the bucket size in millis with a guardrail on
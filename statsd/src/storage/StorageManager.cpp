@@ -840,21 +840,29 @@ void StorageManager::enforceDbGuardrails(const char* path, const int64_t currWal
         string fullPathName = StringPrintf("%s/%s", path, name);
         struct stat fileInfo;
         const ConfigKey key = parseDbName(name);
+        // dbutils keeps a connection open to the dbs it writes, which must be closed with the db.
+        auto deleteDbFile = [&fullPathName, &key]() {
+            if (fullPathName == dbutils::getDbName(key)) {
+                dbutils::deleteDb(key);
+            } else {
+                remove(fullPathName.c_str());
+            }
+        };
         if (stat(fullPathName.c_str(), &fileInfo) != 0) {
             StatsdStats::getInstance().noteDbStatFailed(key);
             // Remove file if stat fails.
-            remove(fullPathName.c_str());
+            deleteDbFile();
             continue;
         }
         StatsdStats::getInstance().noteRestrictedConfigDbSize(key, currWallClockSec,
                                                               fileInfo.st_size);
         if (fileInfo.st_mtime <= deleteThresholdSec) {
             StatsdStats::getInstance().noteDbTooOld(key);
-            remove(fullPathName.c_str());
+            deleteDbFile();
         }
         if (fileInfo.st_size >= maxBytes) {
             StatsdStats::getInstance().noteDbSizeExceeded(key);
-            remove(fullPathName.c_str());
+            deleteDbFile();
         }
         if (hasFile(dbutils::getDbName(key).c_str())) {
             dbutils::verifyIntegrityAndDeleteIfNecessary(key);
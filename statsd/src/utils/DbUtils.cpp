@@ -22,6 +22,11 @@
 
 #include <android/api-level.h>
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
 #include "FieldValue.h"
 #include "android-base/properties.h"
 #include "android-base/stringprintf.h"
@@ -57,6 +62,87 @@ const string COLUMN_NAME_BRAND = "brand";
 const string COLUMN_NAME_MANUFACTURER = "manufacturer";
 const string COLUMN_NAME_BOARD = "board";
 
+namespace {
+
+// The db may be written from the db writer thread and the event thread through different
+// connections, so wait for the other connection's lock instead of failing with SQLITE_BUSY.
+const int kBusyTimeoutMs = 1000;
+
+// Maximum number of rows inserted by one statement. Longer statements take more time to prepare
+// and bind, for little gain per row.
+const size_t kMaxRowsPerInsert = 64;
+
+// Connection to the db of a config that is kept open across calls, together with the statements
+// prepared on it.
+struct DbConnection {
+    sqlite3* db = nullptr;
+    std::unordered_map<string, sqlite3_stmt*> statements;
+    // Schemas of the metric tables that were verified on the connection, by metric id. Avoids
+    // querying the table info again until the table is dropped.
+    std::unordered_map<int64_t, vector<string>> tableSchemas;
+};
+
+// Guards the connections and serializes their use.
+std::mutex gDbConnectionsMutex;
+std::map<ConfigKey, DbConnection> gDbConnections;
+
+void finalizeStatementsLocked(DbConnection& connection) {
+    for (const auto& [_, stmt] : connection.statements) {
+        sqlite3_finalize(stmt);
+    }
+    connection.statements.clear();
+}
+
+void closeDbConnectionLocked(const ConfigKey& key) {
+    auto it = gDbConnections.find(key);
+    if (it == gDbConnections.end()) {
+        return;
+    }
+    finalizeStatementsLocked(it->second);
+    sqlite3_close(it->second.db);
+    gDbConnections.erase(it);
+}
+
+// Returns the connection to the db of the config, opening it if needed. Returns nullptr if the db
+// cannot be opened.
+DbConnection* getDbConnectionLocked(const ConfigKey& key, string& err) {
+    auto it = gDbConnections.find(key);
+    if (it != gDbConnections.end()) {
+        return &it->second;
+    }
+    const string dbName = getDbName(key);
+    sqlite3* db;
+    if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
+        err = sqlite3_errmsg(db);
+        sqlite3_close(db);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(db, kBusyTimeoutMs);
+    DbConnection& connection = gDbConnections[key];
+    connection.db = db;
+    return &connection;
+}
+
+// Returns the statement for zSql prepared on the connection. The statement is owned by the
+// connection and must be reset after use.
+sqlite3_stmt* getStatementLocked(DbConnection& connection, const string& zSql, string& err) {
+    auto it = connection.statements.find(zSql);
+    if (it != connection.statements.end()) {
+        return it->second;
+    }
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(connection.db, zSql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt,
+                           nullptr) != SQLITE_OK) {
+        err = sqlite3_errmsg(connection.db);
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    connection.statements[zSql] = stmt;
+    return stmt;
+}
+
+}  // namespace
+
 static std::vector<std::string> getExpectedTableSchema(const LogEvent& logEvent) {
     vector<std::string> result;
     for (const FieldValue& fieldValue : logEvent.getValues()) {
@@ -96,78 +182,84 @@ string getDbName(const ConfigKey& key) {
                         (long long)key.GetId());
 }
 
-static string getCreateSqlString(const int64_t metricId, const LogEvent& event) {
+static string getCreateSqlString(const int64_t metricId, const RestrictedEventBuffer& buffer) {
     string result = StringPrintf("CREATE TABLE IF NOT EXISTS %s%s", TABLE_NAME_PREFIX.c_str(),
                                  reformatMetricId(metricId).c_str());
     result += StringPrintf("(%s INTEGER,%s INTEGER,%s INTEGER,", COLUMN_NAME_ATOM_TAG.c_str(),
                            COLUMN_NAME_EVENT_ELAPSED_CLOCK_NS.c_str(),
                            COLUMN_NAME_EVENT_WALL_CLOCK_NS.c_str());
-    for (size_t fieldId = 1; fieldId <= event.getValues().size(); ++fieldId) {
-        const FieldValue& fieldValue = event.getValues()[fieldId - 1];
-        if (fieldValue.mField.getDepth() > 0) {
-            // Repeated fields are not supported.
-            continue;
-        }
-        switch (fieldValue.mValue.getType()) {
-            case INT:
-            case LONG:
-                result += StringPrintf("field_%d INTEGER,", fieldValue.mField.getPosAtDepth(0));
-                break;
-            case STRING:
-                result += StringPrintf("field_%d TEXT,", fieldValue.mField.getPosAtDepth(0));
-                break;
-            case FLOAT:
-                result += StringPrintf("field_%d REAL,", fieldValue.mField.getPosAtDepth(0));
-                break;
-            default:
-                // Byte array fields are not supported.
-                break;
-        }
+    for (const RestrictedEventBuffer::Column& column : buffer.getColumns()) {
+        result += StringPrintf("field_%d %s,", column.fieldPos,
+                               RestrictedEventBuffer::getColumnTypeName(column.type));
     }
     result.pop_back();
     result += ") STRICT;";
     return result;
 }
 
+// Index of the events by wall clock time, which serves the deletes of flushTtl and the queries
+// of events in a time window. The elapsed time is not indexed as it is reset on reboots.
+static string getCreateIndexSqlString(const int64_t metricId) {
+    const string tableName = TABLE_NAME_PREFIX + reformatMetricId(metricId);
+    return StringPrintf("CREATE INDEX IF NOT EXISTS %s_%s ON %s(%s);", tableName.c_str(),
+                        COLUMN_NAME_EVENT_WALL_CLOCK_NS.c_str(), tableName.c_str(),
+                        COLUMN_NAME_EVENT_WALL_CLOCK_NS.c_str());
+}
+
 string reformatMetricId(const int64_t metricId) {
     return metricId < 0 ? StringPrintf("n%lld", (long long)metricId * -1)
                         : StringPrintf("%lld", (long long)metricId);
 }
 
 bool createTableIfNeeded(const ConfigKey& key, const int64_t metricId, const LogEvent& event) {
-    const string dbName = getDbName(key);
-    sqlite3* db;
-    if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
-        sqlite3_close(db);
+    RestrictedEventBuffer buffer;
+    buffer.append(event);
+    return createTableIfNeeded(key, metricId, buffer);
+}
+
+bool createTableIfNeeded(const ConfigKey& key, const int64_t metricId,
+                         const RestrictedEventBuffer& buffer) {
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    string err;
+    DbConnection* connection = getDbConnectionLocked(key, err);
+    if (connection == nullptr) {
         return false;
     }
 
     char* error = nullptr;
-    string zSql = getCreateSqlString(metricId, event);
-    sqlite3_exec(db, zSql.c_str(), nullptr, nullptr, &error);
-    sqlite3_close(db);
+    // The index is also created for tables that were created without one.
+    string zSql = getCreateSqlString(metricId, buffer) + getCreateIndexSqlString(metricId);
+    sqlite3_exec(connection->db, zSql.c_str(), nullptr, nullptr, &error);
     if (error) {
         ALOGW("Failed to create table to db: %s", error);
+        sqlite3_free(error);
         return false;
     }
     return true;
 }
 
-bool isEventCompatible(const ConfigKey& key, const int64_t metricId, const LogEvent& event) {
-    const string dbName = getDbName(key);
-    sqlite3* db;
-    if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
-        sqlite3_close(db);
+static bool query(sqlite3* db, const string& zSql, vector<vector<string>>& rows,
+                  vector<int32_t>& columnTypes, vector<string>& columnNames, string& err);
+
+// Checks whether the table of the metric has the given schema, or has not been created.
+static bool isSchemaCompatible(const ConfigKey& key, const int64_t metricId,
+                               const vector<string>& expectedSchema) {
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    string err;
+    DbConnection* connection = getDbConnectionLocked(key, err);
+    if (connection == nullptr) {
         return false;
     }
+    auto it = connection->tableSchemas.find(metricId);
+    if (it != connection->tableSchemas.end()) {
+        return expectedSchema == it->second;
+    }
     string zSql = StringPrintf("PRAGMA table_info(metric_%s);", reformatMetricId(metricId).c_str());
-    string err;
     std::vector<int32_t> columnTypes;
     std::vector<string> columnNames;
     std::vector<std::vector<std::string>> rows;
-    if (!query(key, zSql, rows, columnTypes, columnNames, err)) {
+    if (!query(connection->db, zSql, rows, columnTypes, columnNames, err)) {
         ALOGE("Failed to check table schema for metric %lld: %s", (long long)metricId, err.c_str());
-        sqlite3_close(db);
         return false;
     }
     // Sample query result
@@ -182,30 +274,48 @@ bool isEventCompatible(const ConfigKey& key, const int64_t metricId, const LogEv
     for (size_t i = 3; i < rows.size(); ++i) {  // Atom fields start at the third row
         tableSchema.push_back(rows[i][2]);  // The third column stores the data type for the column
     }
-    sqlite3_close(db);
     // An empty rows vector implies the table has not yet been created.
-    return rows.size() == 0 || getExpectedTableSchema(event) == tableSchema;
+    if (rows.size() == 0) {
+        return true;
+    }
+    const bool compatible = expectedSchema == tableSchema;
+    connection->tableSchemas[metricId] = std::move(tableSchema);
+    return compatible;
+}
+
+bool isEventCompatible(const ConfigKey& key, const int64_t metricId, const LogEvent& event) {
+    return isSchemaCompatible(key, metricId, getExpectedTableSchema(event));
+}
+
+bool isEventCompatible(const ConfigKey& key, const int64_t metricId,
+                       const RestrictedEventBuffer& buffer) {
+    return isSchemaCompatible(key, metricId, buffer.getTableSchema());
 }
 
 bool deleteTable(const ConfigKey& key, const int64_t metricId) {
-    const string dbName = getDbName(key);
-    sqlite3* db;
-    if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
-        sqlite3_close(db);
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    string err;
+    DbConnection* connection = getDbConnectionLocked(key, err);
+    if (connection == nullptr) {
         return false;
     }
+    // The table may be created again with another schema, so drop the statements using it.
+    finalizeStatementsLocked(*connection);
+    connection->tableSchemas.erase(metricId);
     string zSql = StringPrintf("DROP TABLE metric_%s", reformatMetricId(metricId).c_str());
     char* error = nullptr;
-    sqlite3_exec(db, zSql.c_str(), nullptr, nullptr, &error);
-    sqlite3_close(db);
+    sqlite3_exec(connection->db, zSql.c_str(), nullptr, nullptr, &error);
     if (error) {
         ALOGW("Failed to drop table from db: %s", error);
+        sqlite3_free(error);
         return false;
     }
     return true;
 }
 
 void deleteDb(const ConfigKey& key) {
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    closeDbConnectionLocked(key);
     const string dbName = getDbName(key);
     StorageManager::deleteFile(dbName.c_str());
 }
@@ -214,6 +324,7 @@ sqlite3* getDb(const ConfigKey& key) {
     const string dbName = getDbName(key);
     sqlite3* db;
     if (sqlite3_open(dbName.c_str(), &db) == SQLITE_OK) {
+        sqlite3_busy_timeout(db, kBusyTimeoutMs);
         return db;
     }
     return nullptr;
@@ -223,108 +334,261 @@ void closeDb(sqlite3* db) {
     sqlite3_close(db);
 }
 
-static bool getInsertSqlStmt(sqlite3* db, sqlite3_stmt** stmt, const int64_t metricId,
-                             const vector<LogEvent>& events, string& err) {
+static string getInsertSqlString(const int64_t metricId, const int numFields,
+                                 const size_t numRows = 1) {
+    string row = "(?,?,?";
+    for (int i = 0; i < numFields; i++) {
+        row += ",?";
+    }
+    row += ")";
     string result =
             StringPrintf("INSERT INTO metric_%s VALUES", reformatMetricId(metricId).c_str());
-    for (auto& logEvent : events) {
-        result += StringPrintf("(%d, %lld, %lld,", logEvent.GetTagId(),
-                               (long long)logEvent.GetElapsedTimestampNs(),
-                               (long long)logEvent.GetLogdTimestampNs());
-        for (auto& fieldValue : logEvent.getValues()) {
-            if (fieldValue.mField.getDepth() > 0 || fieldValue.mValue.getType() == STORAGE) {
-                // Repeated fields and byte fields are not supported.
-                continue;
-            }
-            result += "?,";
-        }
-        result.pop_back();
-        result += "),";
+    for (size_t i = 0; i < numRows; i++) {
+        result += (i == 0 ? "" : ",") + row;
     }
-    result.pop_back();
     result += ";";
-    if (sqlite3_prepare_v2(db, result.c_str(), -1, stmt, nullptr) != SQLITE_OK) {
-        err = sqlite3_errmsg(db);
-        return false;
+    return result;
+}
+
+static int getNumSupportedFields(const LogEvent& logEvent) {
+    int numFields = 0;
+    for (const FieldValue& fieldValue : logEvent.getValues()) {
+        // Repeated fields and byte fields are not supported.
+        if (fieldValue.mField.getDepth() == 0 && fieldValue.mValue.getType() != STORAGE) {
+            numFields++;
+        }
     }
+    return numFields;
+}
+
+static void bindEvent(sqlite3_stmt* stmt, const LogEvent& logEvent) {
     // ? parameters start with an index of 1 from start of query string to the
     // end.
-    int32_t index = 1;
-    for (auto& logEvent : events) {
-        for (auto& fieldValue : logEvent.getValues()) {
-            if (fieldValue.mField.getDepth() > 0 || fieldValue.mValue.getType() == STORAGE) {
-                // Repeated fields and byte fields are not supported.
-                continue;
-            }
-            switch (fieldValue.mValue.getType()) {
-                case INT:
-                    sqlite3_bind_int(*stmt, index, fieldValue.mValue.int_value);
-                    break;
-                case LONG:
-                    sqlite3_bind_int64(*stmt, index, fieldValue.mValue.long_value);
-                    break;
-                case STRING:
-                    sqlite3_bind_text(*stmt, index, fieldValue.mValue.str_value.c_str(), -1,
-                                      SQLITE_STATIC);
-                    break;
-                case FLOAT:
-                    sqlite3_bind_double(*stmt, index, fieldValue.mValue.float_value);
-                    break;
-                default:
-                    // Byte array fields are not supported.
-                    break;
-            }
-            ++index;
+    sqlite3_bind_int(stmt, 1, logEvent.GetTagId());
+    sqlite3_bind_int64(stmt, 2, logEvent.GetElapsedTimestampNs());
+    sqlite3_bind_int64(stmt, 3, logEvent.GetLogdTimestampNs());
+    int32_t index = 4;
+    for (auto& fieldValue : logEvent.getValues()) {
+        if (fieldValue.mField.getDepth() > 0 || fieldValue.mValue.getType() == STORAGE) {
+            // Repeated fields and byte fields are not supported.
+            continue;
         }
+        switch (fieldValue.mValue.getType()) {
+            case INT:
+                sqlite3_bind_int(stmt, index, fieldValue.mValue.int_value);
+                break;
+            case LONG:
+                sqlite3_bind_int64(stmt, index, fieldValue.mValue.long_value);
+                break;
+            case STRING:
+                sqlite3_bind_text(stmt, index, fieldValue.mValue.str_value.c_str(), -1,
+                                  SQLITE_STATIC);
+                break;
+            case FLOAT:
+                sqlite3_bind_double(stmt, index, fieldValue.mValue.float_value);
+                break;
+            default:
+                // Byte array fields are not supported.
+                break;
+        }
+        ++index;
     }
-    return true;
 }
 
-bool insert(const ConfigKey& key, const int64_t metricId, const vector<LogEvent>& events,
-            string& error) {
-    const string dbName = getDbName(key);
-    sqlite3* db;
-    if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
+// Binds numRows rows of the buffer, starting at firstRow, to a statement inserting numRows rows.
+// The values are bound column by column, so that the type of each column is only checked once.
+static void bindBufferRows(sqlite3_stmt* stmt, const RestrictedEventBuffer& buffer,
+                           const size_t firstRow, const size_t numRows) {
+    const vector<RestrictedEventBuffer::Column>& columns = buffer.getColumns();
+    const int numColumns = columns.size() + 3;
+    // ? parameters start with an index of 1, and each row takes numColumns of them.
+    for (size_t i = 0; i < numRows; i++) {
+        const int index = i * numColumns + 1;
+        sqlite3_bind_int(stmt, index, buffer.getAtomId(firstRow + i));
+        sqlite3_bind_int64(stmt, index + 1, buffer.getElapsedTimestampNs(firstRow + i));
+        sqlite3_bind_int64(stmt, index + 2, buffer.getWallTimestampNs(firstRow + i));
+    }
+    int columnIndex = 4;
+    for (const RestrictedEventBuffer::Column& column : columns) {
+        switch (column.type) {
+            case RestrictedEventBuffer::ColumnType::INTEGER:
+                for (size_t i = 0; i < numRows; i++) {
+                    sqlite3_bind_int64(stmt, i * numColumns + columnIndex,
+                                       column.integers[firstRow + i]);
+                }
+                break;
+            case RestrictedEventBuffer::ColumnType::REAL:
+                for (size_t i = 0; i < numRows; i++) {
+                    sqlite3_bind_double(stmt, i * numColumns + columnIndex,
+                                        column.reals[firstRow + i]);
+                }
+                break;
+            case RestrictedEventBuffer::ColumnType::TEXT:
+                for (size_t i = 0; i < numRows; i++) {
+                    sqlite3_bind_text(stmt, i * numColumns + columnIndex,
+                                      buffer.getText(column, firstRow + i),
+                                      buffer.getTextLength(column, firstRow + i), SQLITE_STATIC);
+                }
+                break;
+        }
+        ++columnIndex;
+    }
+}
+
+// Runs the bound insert statement, and resets it for the next rows.
+static bool stepInsert(sqlite3* db, sqlite3_stmt* stmt, string& error) {
+    const int result = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (result != SQLITE_DONE) {
         error = sqlite3_errmsg(db);
-        sqlite3_close(db);
+        ALOGW("Failed to insert data to db: %s", error.c_str());
         return false;
     }
-    bool success = insert(db, metricId, events, error);
-    sqlite3_close(db);
-    return success;
+    return true;
 }
 
-bool insert(sqlite3* db, const int64_t metricId, const vector<LogEvent>& events, string& error) {
-    sqlite3_stmt* stmt = nullptr;
-    if (!getInsertSqlStmt(db, &stmt, metricId, events, error)) {
-        ALOGW("Failed to generate prepared sql insert query %s", error.c_str());
-        sqlite3_finalize(stmt);
+// Runs insertRows in a single transaction, so that either all or none of the rows are inserted.
+// insertRows returns false if a row could not be inserted, which rolls back the transaction.
+template <typename InsertRows>
+static bool insertInTransaction(sqlite3* db, InsertRows insertRows, string& error) {
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
         return false;
     }
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
+    if (!insertRows()) {
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
         error = sqlite3_errmsg(db);
-        ALOGW("Failed to insert data to db: %s", error.c_str());
-        sqlite3_finalize(stmt);
+        ALOGW("Failed to commit data to db: %s", error.c_str());
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
         return false;
     }
-    sqlite3_finalize(stmt);
     return true;
 }
 
-bool query(const ConfigKey& key, const string& zSql, vector<vector<string>>& rows,
-           vector<int32_t>& columnTypes, vector<string>& columnNames, string& err) {
-    const string dbName = getDbName(key);
-    sqlite3* db;
-    if (sqlite3_open_v2(dbName.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
-        err = sqlite3_errmsg(db);
-        sqlite3_close(db);
+// getStmt returns the insert statement for events with the given number of fields.
+template <typename GetStmt>
+static bool insertEvents(sqlite3* db, const int64_t metricId, const vector<LogEvent>& events,
+                         GetStmt getStmt, string& error) {
+    return insertInTransaction(
+            db,
+            [&]() {
+                int numFields = -1;
+                sqlite3_stmt* stmt = nullptr;
+                for (const LogEvent& logEvent : events) {
+                    const int eventNumFields = getNumSupportedFields(logEvent);
+                    if (eventNumFields != numFields) {
+                        numFields = eventNumFields;
+                        stmt = getStmt(getInsertSqlString(metricId, numFields), error);
+                        if (stmt == nullptr) {
+                            ALOGW("Failed to generate prepared sql insert query %s",
+                                  error.c_str());
+                            return false;
+                        }
+                    }
+                    bindEvent(stmt, logEvent);
+                    if (!stepInsert(db, stmt, error)) {
+                        return false;
+                    }
+                }
+                return true;
+            },
+            error);
+}
+
+bool insert(const ConfigKey& key, const int64_t metricId, const vector<LogEvent>& events,
+            string& error) {
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    DbConnection* connection = getDbConnectionLocked(key, error);
+    if (connection == nullptr) {
         return false;
     }
+    return insertEvents(
+            connection->db, metricId, events,
+            [connection](const string& zSql, string& err) {
+                return getStatementLocked(*connection, zSql, err);
+            },
+            error);
+}
+
+bool insert(sqlite3* db, const int64_t metricId, const vector<LogEvent>& events, string& error) {
+    // The statements are only used for this call, as the connection is owned by the caller.
+    vector<sqlite3_stmt*> statements;
+    const bool success = insertEvents(
+            db, metricId, events,
+            [db, &statements](const string& zSql, string& err) -> sqlite3_stmt* {
+                sqlite3_stmt* stmt = nullptr;
+                if (sqlite3_prepare_v2(db, zSql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+                    err = sqlite3_errmsg(db);
+                    sqlite3_finalize(stmt);
+                    return nullptr;
+                }
+                statements.push_back(stmt);
+                return stmt;
+            },
+            error);
+    for (sqlite3_stmt* stmt : statements) {
+        sqlite3_finalize(stmt);
+    }
+    return success;
+}
+
+bool insert(const ConfigKey& key, const int64_t metricId, const RestrictedEventBuffer& buffer,
+            string& error) {
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    DbConnection* connection = getDbConnectionLocked(key, error);
+    if (connection == nullptr) {
+        return false;
+    }
+    sqlite3* db = connection->db;
+    // All the rows of the buffer have the same schema. They are inserted kMaxRowsPerInsert at a
+    // time, or as many as the statement can bind, and the remaining rows one at a time, so that
+    // at most two statements are cached per metric.
+    const int numFields = buffer.getColumns().size();
+    const size_t maxVariables = sqlite3_limit(db, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+    const size_t rowsPerInsert =
+            std::max<size_t>(1, std::min(kMaxRowsPerInsert, maxVariables / (numFields + 3)));
+    sqlite3_stmt* batchStmt = nullptr;
+    if (buffer.size() >= rowsPerInsert) {
+        batchStmt = getStatementLocked(
+                *connection, getInsertSqlString(metricId, numFields, rowsPerInsert), error);
+    }
+    sqlite3_stmt* rowStmt =
+            getStatementLocked(*connection, getInsertSqlString(metricId, numFields), error);
+    if (rowStmt == nullptr || (buffer.size() >= rowsPerInsert && batchStmt == nullptr)) {
+        ALOGW("Failed to generate prepared sql insert query %s", error.c_str());
+        return false;
+    }
+    return insertInTransaction(
+            db,
+            [&]() {
+                size_t row = 0;
+                for (; row + rowsPerInsert <= buffer.size(); row += rowsPerInsert) {
+                    bindBufferRows(batchStmt, buffer, row, rowsPerInsert);
+                    if (!stepInsert(db, batchStmt, error)) {
+                        return false;
+                    }
+                }
+                for (; row < buffer.size(); row++) {
+                    bindBufferRows(rowStmt, buffer, row, /*numRows=*/1);
+                    if (!stepInsert(db, rowStmt, error)) {
+                        return false;
+                    }
+                }
+                return true;
+            },
+            error);
+}
+
+static bool query(sqlite3* db, const string& zSql, vector<vector<string>>& rows,
+                  vector<int32_t>& columnTypes, vector<string>& columnNames, string& err) {
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, zSql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
         err = sqlite3_errmsg(db);
         sqlite3_finalize(stmt);
-        sqlite3_close(db);
         return false;
     }
     int result = sqlite3_step(stmt);
@@ -353,12 +617,26 @@ bool query(const ConfigKey& key, const string& zSql, vector<vector<string>>& row
     }
     sqlite3_finalize(stmt);
     if (result != SQLITE_DONE) {
+        err = sqlite3_errmsg(db);
+        return false;
+    }
+    return true;
+}
+
+bool query(const ConfigKey& key, const string& zSql, vector<vector<string>>& rows,
+           vector<int32_t>& columnTypes, vector<string>& columnNames, string& err) {
+    // The caller's sql is run on a read only connection of its own, never on the cached one.
+    const string dbName = getDbName(key);
+    sqlite3* db;
+    if (sqlite3_open_v2(dbName.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
         err = sqlite3_errmsg(db);
         sqlite3_close(db);
         return false;
     }
+    sqlite3_busy_timeout(db, kBusyTimeoutMs);
+    const bool success = query(db, zSql, rows, columnTypes, columnNames, err);
     sqlite3_close(db);
-    return true;
+    return success;
 }
 
 bool flushTtl(sqlite3* db, const int64_t metricId, const int64_t ttlWallClockNs) {
@@ -375,25 +653,53 @@ bool flushTtl(sqlite3* db, const int64_t metricId, const int64_t ttlWallClockNs)
     return true;
 }
 
+bool flushTtl(const ConfigKey& key, const int64_t metricId, const int64_t ttlWallClockNs) {
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    string err;
+    DbConnection* connection = getDbConnectionLocked(key, err);
+    if (connection == nullptr) {
+        ALOGW("Failed to enforce ttl: %s", err.c_str());
+        return false;
+    }
+    string zSql = StringPrintf("DELETE FROM %s%s WHERE %s <= ?", TABLE_NAME_PREFIX.c_str(),
+                               reformatMetricId(metricId).c_str(),
+                               COLUMN_NAME_EVENT_WALL_CLOCK_NS.c_str());
+    sqlite3_stmt* stmt = getStatementLocked(*connection, zSql, err);
+    if (stmt == nullptr) {
+        ALOGW("Failed to enforce ttl: %s", err.c_str());
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, ttlWallClockNs);
+    const int result = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (result != SQLITE_DONE) {
+        ALOGW("Failed to enforce ttl: %s", sqlite3_errmsg(connection->db));
+        return false;
+    }
+    return true;
+}
+
 void verifyIntegrityAndDeleteIfNecessary(const ConfigKey& configKey) {
-    const string dbName = getDbName(configKey);
-    sqlite3* db;
-    if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
-        sqlite3_close(db);
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    string err;
+    DbConnection* connection = getDbConnectionLocked(configKey, err);
+    if (connection == nullptr) {
         return;
     }
+    // Drop the pages cached by the connection, so that the check reads the file on disk.
+    sqlite3_db_release_memory(connection->db);
     string zSql = "PRAGMA integrity_check";
 
     char* error = nullptr;
-    sqlite3_exec(db, zSql.c_str(), integrityCheckCallback, nullptr, &error);
+    sqlite3_exec(connection->db, zSql.c_str(), integrityCheckCallback, nullptr, &error);
     if (error) {
         StatsdStats::getInstance().noteDbCorrupted(configKey);
         ALOGW("Integrity Check failed %s", error);
-        sqlite3_close(db);
-        deleteDb(configKey);
-        return;
+        sqlite3_free(error);
+        closeDbConnectionLocked(configKey);
+        StorageManager::deleteFile(getDbName(configKey).c_str());
     }
-    sqlite3_close(db);
 }
 
 static bool getDeviceInfoInsertStmt(sqlite3* db, sqlite3_stmt** stmt, string error) {
@@ -450,13 +756,12 @@ static bool getDeviceInfoInsertStmt(sqlite3* db, sqlite3_stmt** stmt, string err
 }
 
 bool updateDeviceInfoTable(const ConfigKey& key, string& error) {
-    const string dbName = getDbName(key);
-    sqlite3* db;
-    if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
-        error = sqlite3_errmsg(db);
-        sqlite3_close(db);
+    std::lock_guard<std::mutex> lock(gDbConnectionsMutex);
+    DbConnection* connection = getDbConnectionLocked(key, error);
+    if (connection == nullptr) {
         return false;
     }
+    sqlite3* db = connection->db;
 
     string dropTableSql = "DROP TABLE device_info";
     // Ignore possible error result code if table has not yet been created.
@@ -473,7 +778,6 @@ bool updateDeviceInfoTable(const ConfigKey& key, string& error) {
     if (sqlite3_exec(db, createTableSql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
         error = sqlite3_errmsg(db);
         ALOGW("Failed to create device info table %s", error.c_str());
-        sqlite3_close(db);
         return false;
     }
 
@@ -481,7 +785,6 @@ bool updateDeviceInfoTable(const ConfigKey& key, string& error) {
     if (!getDeviceInfoInsertStmt(db, &stmt, error)) {
         ALOGW("Failed to generate device info prepared sql insert query %s", error.c_str());
         sqlite3_finalize(stmt);
-        sqlite3_close(db);
         return false;
     }
 
@@ -489,11 +792,9 @@ bool updateDeviceInfoTable(const ConfigKey& key, string& error) {
         error = sqlite3_errmsg(db);
         ALOGW("Failed to insert data to device info table: %s", error.c_str());
         sqlite3_finalize(stmt);
-        sqlite3_close(db);
         return false;
     }
     sqlite3_finalize(stmt);
-    sqlite3_close(db);
     return true;
 }
 }  // namespace dbutils
@@ -19,6 +19,7 @@
 
 #include "config/ConfigKey.h"
 #include "logd/LogEvent.h"
+#include "utils/RestrictedEventBuffer.h"
 
 using std::string;
 using std::vector;
@@ -41,43 +42,73 @@ string reformatMetricId(const int64_t metricId);
 /* Creates a new data table for a specified metric if one does not yet exist. */
 bool createTableIfNeeded(const ConfigKey& key, const int64_t metricId, const LogEvent& event);
 
+/* Creates a new data table for a specified metric, with the schema of the buffered events, if
+ * one does not yet exist. The table is indexed by the wall clock time of the events.
+ */
+bool createTableIfNeeded(const ConfigKey& key, const int64_t metricId,
+                         const RestrictedEventBuffer& buffer);
+
 /* Checks whether the table schema for the given metric matches the event.
- * Returns true if the table has not yet been created.
+ * Returns true if the table has not yet been created. The schema of an existing table is cached
+ * on the connection of the db until the table is deleted.
  */
 bool isEventCompatible(const ConfigKey& key, const int64_t metricId, const LogEvent& event);
 
+/* Checks whether the table schema for the given metric matches the buffered events.
+ * Returns true if the table has not yet been created.
+ */
+bool isEventCompatible(const ConfigKey& key, const int64_t metricId,
+                       const RestrictedEventBuffer& buffer);
+
 /* Deletes a data table for the specified metric. */
 bool deleteTable(const ConfigKey& key, const int64_t metricId);
 
-/* Deletes the SQLite db data file. */
+/* Closes the shared connection to the db, if any, and deletes the SQLite db data file.
+ * The db file must be deleted through this function while statsd may be writing to it.
+ */
 void deleteDb(const ConfigKey& key);
 
-/* Gets a handle to the sqlite db. You must call closeDb to free the allocated memory.
+/* Gets a new handle to the sqlite db. You must call closeDb to free the allocated memory.
  * Returns a nullptr if an error occurs.
+ * The other functions taking a ConfigKey share one connection per db, which is kept open until
+ * the db is deleted.
  */
 sqlite3* getDb(const ConfigKey& key);
 
 /* Closes the handle to the sqlite db. */
 void closeDb(sqlite3* db);
 
-/* Inserts new data into the specified metric data table.
- * A temp sqlite handle is created using the ConfigKey.
+/* Inserts new data into the specified metric data table, in a single transaction.
+ * The insert statements are prepared once and cached on the connection of the db.
  */
 bool insert(const ConfigKey& key, const int64_t metricId, const vector<LogEvent>& events,
             string& error);
 
+/* Inserts the buffered events into the specified metric data table, in a single transaction.
+ * Each statement inserts a batch of rows, whose values are bound column by column.
+ */
+bool insert(const ConfigKey& key, const int64_t metricId, const RestrictedEventBuffer& buffer,
+            string& error);
+
 /* Inserts new data into the specified sqlite db handle. */
 bool insert(sqlite3* db, const int64_t metricId, const vector<LogEvent>& events, string& error);
 
 /* Executes a sql query on the specified SQLite db.
- * A temp sqlite handle is created using the ConfigKey.
+ * A temp read only sqlite handle is created using the ConfigKey.
  */
 bool query(const ConfigKey& key, const string& zSql, vector<vector<string>>& rows,
            vector<int32_t>& columnTypes, vector<string>& columnNames, string& err);
 
 bool flushTtl(sqlite3* db, const int64_t metricId, const int64_t ttlWallClockNs);
 
-/* Checks for database corruption and deletes the db if it is corrupted. */
+/* Deletes the events of the metric table logged at or before ttlWallClockNs, through the shared
+ * connection to the db.
+ */
+bool flushTtl(const ConfigKey& key, const int64_t metricId, const int64_t ttlWallClockNs);
+
+/* Checks for database corruption, through the shared connection to the db, and deletes the db if
+ * it is corrupted.
+ */
 void verifyIntegrityAndDeleteIfNecessary(const ConfigKey& key);
 
 /* Creates and updates the device info table for the given configKey. */
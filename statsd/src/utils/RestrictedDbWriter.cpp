@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "utils/RestrictedDbWriter.h"
+
+#include <algorithm>
+
+#include "guardrail/StatsdStats.h"
+#include "stats_log_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+RestrictedDbWriter::RestrictedDbWriter(size_t maxQueueSize)
+    : mMaxQueueSize(std::max<size_t>(1, maxQueueSize)) {
+}
+
+RestrictedDbWriter::~RestrictedDbWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mQueueCondition.notify_one();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+bool RestrictedDbWriter::push(std::function<void()> write) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mQueue.size() >= mMaxQueueSize) {
+        VLOG("Restricted db writer queue is full, dropping write");
+        StatsdStats::getInstance().noteRestrictedDbWriterQueueFull();
+        return false;
+    }
+    if (!mThread.joinable()) {
+        mThread = std::thread([this] { run(); });
+    }
+    mQueue.push_back({std::move(write), getElapsedRealtimeNs()});
+    mQueueCondition.notify_one();
+    return true;
+}
+
+bool RestrictedDbWriter::isFull() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size() >= mMaxQueueSize;
+}
+
+void RestrictedDbWriter::waitForPendingWrites() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdleCondition.wait(lock, [this] { return mQueue.empty() && !mWriting; });
+}
+
+void RestrictedDbWriter::run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mQueueCondition.wait(lock, [this] { return !mQueue.empty() || mStopping; });
+        if (mQueue.empty()) {
+            // Stopping, and all the queued writes have been run.
+            return;
+        }
+        QueuedWrite queuedWrite = std::move(mQueue.front());
+        mQueue.pop_front();
+        mWriting = true;
+        lock.unlock();
+
+        StatsdStats::getInstance().noteRestrictedDbWriteQueueLatency(getElapsedRealtimeNs() -
+                                                                     queuedWrite.queueTimeNs);
+        queuedWrite.write();
+        // Release what the write holds on to before taking the lock again.
+        queuedWrite.write = nullptr;
+
+        lock.lock();
+        mWriting = false;
+        if (mQueue.empty()) {
+            mIdleCondition.notify_all();
+        }
+    }
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Runs the writes of restricted metric data to their sqlite dbs on a dedicated thread, so that
+ * disk I/O does not block the processing of log events.
+ *
+ * Writes are run one at a time in the order they were queued. The queue is bounded: once it is
+ * full, push() drops the write rather than blocking the caller, which usually holds the metrics
+ * lock on the log event thread. Callers that can keep their data, such as flushes, check isFull()
+ * before taking it, so that it is written by a later write instead. The thread is started on the
+ * first push().
+ */
+class RestrictedDbWriter {
+public:
+    explicit RestrictedDbWriter(size_t maxQueueSize);
+
+    // Runs the writes that are still queued before returning.
+    ~RestrictedDbWriter();
+
+    RestrictedDbWriter(const RestrictedDbWriter&) = delete;
+    RestrictedDbWriter& operator=(const RestrictedDbWriter&) = delete;
+
+    // Queues the write. Returns false, without queueing it, if the queue is full.
+    bool push(std::function<void()> write);
+
+    bool isFull();
+
+    // Blocks until all the writes queued so far have completed.
+    void waitForPendingWrites();
+
+private:
+    struct QueuedWrite {
+        std::function<void()> write;
+        int64_t queueTimeNs;
+    };
+
+    void run();
+
+    const size_t mMaxQueueSize;
+
+    std::mutex mMutex;
+
+    // Notified when a write is queued or the writer is stopping.
+    std::condition_variable mQueueCondition;
+
+    // Notified when the queue is empty and no write is running.
+    std::condition_variable mIdleCondition;
+
+    std::deque<QueuedWrite> mQueue;
+
+    // Whether the thread is running a write that was popped from the queue.
+    bool mWriting = false;
+
+    bool mStopping = false;
+
+    std::thread mThread;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define STATSD_DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "utils/RestrictedEventBuffer.h"
+
+#include "FieldValue.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::string;
+using std::vector;
+
+// Returns false if the field is not stored in the metric table. Matches the table schema of
+// dbutils::getExpectedTableSchema().
+static bool getColumnType(const FieldValue& fieldValue, RestrictedEventBuffer::ColumnType* type) {
+    if (fieldValue.mField.getDepth() > 0) {
+        // Repeated fields are not supported.
+        return false;
+    }
+    switch (fieldValue.mValue.getType()) {
+        case INT:
+        case LONG:
+            *type = RestrictedEventBuffer::ColumnType::INTEGER;
+            return true;
+        case STRING:
+            *type = RestrictedEventBuffer::ColumnType::TEXT;
+            return true;
+        case FLOAT:
+            *type = RestrictedEventBuffer::ColumnType::REAL;
+            return true;
+        default:
+            // Byte array fields are not supported.
+            return false;
+    }
+}
+
+const char* RestrictedEventBuffer::getColumnTypeName(ColumnType type) {
+    switch (type) {
+        case ColumnType::INTEGER:
+            return "INTEGER";
+        case ColumnType::REAL:
+            return "REAL";
+        case ColumnType::TEXT:
+            return "TEXT";
+    }
+    return "";
+}
+
+bool RestrictedEventBuffer::hasSchema(const LogEvent& event) const {
+    size_t columnIndex = 0;
+    ColumnType type;
+    for (const FieldValue& fieldValue : event.getValues()) {
+        if (!getColumnType(fieldValue, &type)) {
+            continue;
+        }
+        if (columnIndex >= mColumns.size() || mColumns[columnIndex].type != type) {
+            return false;
+        }
+        columnIndex++;
+    }
+    return columnIndex == mColumns.size();
+}
+
+bool RestrictedEventBuffer::append(const LogEvent& event) {
+    ColumnType type;
+    if (empty()) {
+        mColumns.clear();
+        for (const FieldValue& fieldValue : event.getValues()) {
+            if (getColumnType(fieldValue, &type)) {
+                Column& column = mColumns.emplace_back();
+                column.fieldPos = fieldValue.mField.getPosAtDepth(0);
+                column.type = type;
+            }
+        }
+    } else if (!hasSchema(event)) {
+        return false;
+    }
+
+    mAtomIds.push_back(event.GetTagId());
+    mElapsedTimestampNs.push_back(event.GetElapsedTimestampNs());
+    mWallTimestampNs.push_back(event.GetLogdTimestampNs());
+    auto column = mColumns.begin();
+    for (const FieldValue& fieldValue : event.getValues()) {
+        if (!getColumnType(fieldValue, &type)) {
+            continue;
+        }
+        switch (fieldValue.mValue.getType()) {
+            case INT:
+                column->integers.push_back(fieldValue.mValue.int_value);
+                break;
+            case LONG:
+                column->integers.push_back(fieldValue.mValue.long_value);
+                break;
+            case FLOAT:
+                column->reals.push_back(fieldValue.mValue.float_value);
+                break;
+            case STRING: {
+                const string& value = fieldValue.mValue.str_value;
+                column->texts.emplace_back(mText.size(), value.size());
+                mText += value;
+                break;
+            }
+            default:
+                break;
+        }
+        ++column;
+    }
+    return true;
+}
+
+bool RestrictedEventBuffer::append(const RestrictedEventBuffer& other) {
+    if (other.empty()) {
+        return true;
+    }
+    if (empty()) {
+        *this = other;
+        return true;
+    }
+    if (getTableSchema() != other.getTableSchema()) {
+        return false;
+    }
+    mAtomIds.insert(mAtomIds.end(), other.mAtomIds.begin(), other.mAtomIds.end());
+    mElapsedTimestampNs.insert(mElapsedTimestampNs.end(), other.mElapsedTimestampNs.begin(),
+                               other.mElapsedTimestampNs.end());
+    mWallTimestampNs.insert(mWallTimestampNs.end(), other.mWallTimestampNs.begin(),
+                            other.mWallTimestampNs.end());
+    const uint32_t textOffset = mText.size();
+    for (size_t i = 0; i < mColumns.size(); i++) {
+        Column& column = mColumns[i];
+        const Column& otherColumn = other.mColumns[i];
+        column.integers.insert(column.integers.end(), otherColumn.integers.begin(),
+                               otherColumn.integers.end());
+        column.reals.insert(column.reals.end(), otherColumn.reals.begin(),
+                            otherColumn.reals.end());
+        for (const auto& [offset, length] : otherColumn.texts) {
+            column.texts.emplace_back(textOffset + offset, length);
+        }
+    }
+    mText += other.mText;
+    return true;
+}
+
+void RestrictedEventBuffer::clear() {
+    mAtomIds.clear();
+    mElapsedTimestampNs.clear();
+    mWallTimestampNs.clear();
+    mColumns.clear();
+    mText.clear();
+}
+
+size_t RestrictedEventBuffer::byteSize() const {
+    size_t size = mAtomIds.size() * sizeof(int32_t) +
+                  (mElapsedTimestampNs.size() + mWallTimestampNs.size()) * sizeof(int64_t) +
+                  mText.size();
+    for (const Column& column : mColumns) {
+        size += column.integers.size() * sizeof(int64_t) + column.reals.size() * sizeof(float) +
+                column.texts.size() * sizeof(std::pair<uint32_t, uint32_t>);
+    }
+    return size;
+}
+
+vector<string> RestrictedEventBuffer::getTableSchema() const {
+    vector<string> schema;
+    for (const Column& column : mColumns) {
+        schema.push_back(getColumnTypeName(column.type));
+    }
+    return schema;
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "logd/LogEvent.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Holds the restricted events of a metric until they are inserted into the metric table.
+ *
+ * The events are stored by column, following the schema of the metric table: one typed vector per
+ * supported atom field, and a single character buffer for all the string values. This avoids
+ * keeping a copy of each LogEvent, with its FieldValue vector and strings, in memory.
+ *
+ * All the events in a buffer must have the same schema, which is set by the first event appended.
+ */
+class RestrictedEventBuffer {
+public:
+    // Sqlite type of the column storing an atom field.
+    enum class ColumnType { INTEGER, REAL, TEXT };
+
+    struct Column {
+        // Position of the atom field, which names the column.
+        int32_t fieldPos;
+        ColumnType type;
+        // Values of INTEGER columns, for INT and LONG fields.
+        std::vector<int64_t> integers;
+        // Values of REAL columns.
+        std::vector<float> reals;
+        // Offset and length in the text buffer of the values of TEXT columns.
+        std::vector<std::pair<uint32_t, uint32_t>> texts;
+    };
+
+    // Appends the event. Returns false, without appending it, if its schema differs from the
+    // schema of the buffer.
+    bool append(const LogEvent& event);
+
+    // Appends all the events of the other buffer. Returns false, without appending them, if its
+    // schema differs from the schema of this buffer.
+    bool append(const RestrictedEventBuffer& other);
+
+    // Removes all the events, and resets the schema.
+    void clear();
+
+    inline bool empty() const {
+        return mAtomIds.empty();
+    }
+
+    inline size_t size() const {
+        return mAtomIds.size();
+    }
+
+    // Returns the number of bytes used by the values of the buffered events.
+    size_t byteSize() const;
+
+    // Returns the sqlite types of the field columns, in the format of the table schema.
+    std::vector<std::string> getTableSchema() const;
+
+    inline const std::vector<Column>& getColumns() const {
+        return mColumns;
+    }
+
+    inline int32_t getAtomId(size_t row) const {
+        return mAtomIds[row];
+    }
+
+    inline int64_t getElapsedTimestampNs(size_t row) const {
+        return mElapsedTimestampNs[row];
+    }
+
+    inline int64_t getWallTimestampNs(size_t row) const {
+        return mWallTimestampNs[row];
+    }
+
+    inline const char* getText(const Column& column, size_t row) const {
+        return mText.data() + column.texts[row].first;
+    }
+
+    inline size_t getTextLength(const Column& column, size_t row) const {
+        return column.texts[row].second;
+    }
+
+    static const char* getColumnTypeName(ColumnType type);
+
+private:
+    bool hasSchema(const LogEvent& event) const;
+
+    std::vector<int32_t> mAtomIds;
+    std::vector<int64_t> mElapsedTimestampNs;
+    std::vector<int64_t> mWallTimestampNs;
+
+    std::vector<Column> mColumns;
+
+    // Values of all the TEXT columns, one after the other.
+    std::string mText;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/WorkerPool.h"
+
+#include <algorithm>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+WorkerPool::WorkerPool(size_t maxThreads) : mMaxThreads(std::max<size_t>(1, maxThreads)) {
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mTaskCondition.notify_all();
+    for (std::thread& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+        if (mNumIdleThreads < mTasks.size() && mThreads.size() < mMaxThreads) {
+            mThreads.emplace_back([this] { work(); });
+        }
+    }
+    mTaskCondition.notify_one();
+}
+
+void WorkerPool::work() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mNumIdleThreads++;
+        mTaskCondition.wait(lock, [this] { return !mTasks.empty() || mStopping; });
+        mNumIdleThreads--;
+        if (mTasks.empty()) {
+            // Stopping, and all the queued tasks have been started.
+            return;
+        }
+        std::function<void()> task = std::move(mTasks.front());
+        mTasks.pop_front();
+        lock.unlock();
+
+        task();
+        // Release what the task holds on to before taking the lock again.
+        task = nullptr;
+
+        lock.lock();
+    }
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Runs tasks on a bounded set of threads that are kept across tasks, so that work that is spread
+ * over threads on every occurrence, such as the pulls of a pull alarm, does not create and join
+ * new threads each time.
+ *
+ * Tasks are started in the order they were queued, on up to maxThreads threads. Threads are
+ * started on demand, when a task is queued and all the threads are busy, and kept until the pool
+ * is destroyed.
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t maxThreads);
+
+    // Runs the tasks that are still queued before returning.
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void run(std::function<void()> task);
+
+private:
+    void work();
+
+    const size_t mMaxThreads;
+
+    std::mutex mMutex;
+
+    // Notified when a task is queued or the pool is stopping.
+    std::condition_variable mTaskCondition;
+
+    std::deque<std::function<void()>> mTasks;
+
+    // Number of threads waiting for a task.
+    size_t mNumIdleThreads = 0;
+
+    bool mStopping = false;
+
+    std::vector<std::thread> mThreads;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -445,6 +445,166 @@ TEST(AtomMatcherTest, TestMetric2ConditionLink) {
     EXPECT_EQ((int32_t)27, link.conditionFields[0].mMatcher.getTag());
 }
 
+TEST(AtomMatcherTest, TestMetric2ConditionValueIndices) {
+    std::vector<int> attributionUids = {1111, 2222, 3333};
+    std::vector<string> attributionTags = {"location1", "location2", "location3"};
+
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event, 10 /*atomId*/, 12345, attributionUids, attributionTags, "some value");
+
+    FieldMatcher conditionMatcher;
+    conditionMatcher.set_field(27);
+    conditionMatcher.add_child()->set_field(1);
+
+    // First uid of the attribution chain, which is the first value of the event.
+    FieldMatcher whatMatcher;
+    whatMatcher.set_field(10);
+    FieldMatcher* child = whatMatcher.add_child();
+    child->set_field(1);
+    child->set_position(Position::FIRST);
+    child->add_child()->set_field(1);
+
+    Metric2Condition link;
+    translateFieldMatcher(whatMatcher, &link.metricFields);
+    translateFieldMatcher(conditionMatcher, &link.conditionFields);
+    initMetric2ConditionValueIndices(&link);
+    EXPECT_EQ(link.metricFieldValueIndices, vector<int>({0}));
+
+    Metric2Condition genericLink = link;
+    genericLink.metricFieldValueIndices.clear();
+    HashableDimensionKey output;
+    HashableDimensionKey expectedOutput;
+    getDimensionForCondition(event.getValues(), link, &output);
+    getDimensionForCondition(event.getValues(), genericLink, &expectedOutput);
+    ASSERT_EQ(1, output.getValues().size());
+    EXPECT_EQ(1111, output.getValues()[0].mValue.int_value);
+    EXPECT_EQ(27, output.getValues()[0].mField.getTag());
+    EXPECT_EQ(expectedOutput, output);
+
+    // Top-level field after the attribution chain. The expected index assumes that the preceding
+    // fields are not repeated, so the event values are matched instead.
+    whatMatcher.clear_child();
+    whatMatcher.add_child()->set_field(2);
+    link.metricFields.clear();
+    translateFieldMatcher(whatMatcher, &link.metricFields);
+    initMetric2ConditionValueIndices(&link);
+    EXPECT_EQ(link.metricFieldValueIndices, vector<int>({1}));
+
+    output = HashableDimensionKey();
+    getDimensionForCondition(event.getValues(), link, &output);
+    ASSERT_EQ(1, output.getValues().size());
+    EXPECT_EQ("some value", output.getValues()[0].mValue.str_value);
+    EXPECT_EQ(27, output.getValues()[0].mField.getTag());
+
+    // A field matching several values can only be resolved by matching the event values.
+    whatMatcher.clear_child();
+    child = whatMatcher.add_child();
+    child->set_field(1);
+    child->set_position(Position::ANY);
+    child->add_child()->set_field(1);
+    link.metricFields.clear();
+    translateFieldMatcher(whatMatcher, &link.metricFields);
+    initMetric2ConditionValueIndices(&link);
+    EXPECT_TRUE(link.metricFieldValueIndices.empty());
+}
+
+TEST(AtomMatcherTest, TestLinkedConditionKey) {
+    std::vector<int> attributionUids = {1111, 2222, 3333};
+    std::vector<string> attributionTags = {"location1", "location2", "location3"};
+
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event, 10 /*atomId*/, 12345, attributionUids, attributionTags, "some value");
+
+    // The string field of the metric's atom is linked to the second field of the condition's.
+    FieldMatcher whatMatcher;
+    whatMatcher.set_field(10);
+    whatMatcher.add_child()->set_field(2);
+    FieldMatcher conditionMatcher;
+    conditionMatcher.set_field(27);
+    conditionMatcher.add_child()->set_field(2);
+    Metric2Condition link;
+    translateFieldMatcher(whatMatcher, &link.metricFields);
+    translateFieldMatcher(conditionMatcher, &link.conditionFields);
+
+    HashableDimensionKey conditionKey;
+    getDimensionForCondition(event.getValues(), link, &conditionKey);
+
+    // A dimension of the condition, which is sliced by both fields.
+    HashableDimensionKey conditionDimension;
+    conditionDimension.addValue(FieldValue(Field(27, getSimpleField(1)), Value(1111)));
+    conditionDimension.addValue(
+            FieldValue(Field(27, getSimpleField(2)), Value(string("some value"))));
+
+    HashableDimensionKey linkedConditionKey;
+    EXPECT_TRUE(getLinkedConditionKey(conditionDimension, link, &linkedConditionKey));
+    EXPECT_EQ(conditionKey, linkedConditionKey);
+
+    // A dimension without the linked field.
+    HashableDimensionKey uidDimension;
+    uidDimension.addValue(FieldValue(Field(27, getSimpleField(1)), Value(1111)));
+    linkedConditionKey = HashableDimensionKey();
+    EXPECT_FALSE(getLinkedConditionKey(uidDimension, link, &linkedConditionKey));
+}
+
+TEST(AtomMatcherTest, TestMetric2ConditionValueIndicesAttributionChainLinks) {
+    std::vector<int> attributionUids = {1111, 2222, 3333};
+    std::vector<string> attributionTags = {"location1", "location2", "location3"};
+
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    makeLogEvent(&event, 10 /*atomId*/, 12345, attributionUids, attributionTags, "some value");
+
+    FieldMatcher conditionMatcher;
+    conditionMatcher.set_field(27);
+    conditionMatcher.add_child()->set_field(1);
+
+    vector<FieldMatcher> whatMatchers;
+    // The whole attribution chain, with or without a position.
+    for (const auto& position : {Position::POSITION_UNKNOWN, Position::FIRST, Position::LAST,
+                                 Position::ALL, Position::ANY}) {
+        FieldMatcher whatMatcher;
+        whatMatcher.set_field(10);
+        FieldMatcher* child = whatMatcher.add_child();
+        child->set_field(1);
+        if (position != Position::POSITION_UNKNOWN) {
+            child->set_position(position);
+        }
+        whatMatchers.push_back(whatMatcher);
+        // The uid and the tag of the nodes at the position.
+        if (position != Position::POSITION_UNKNOWN) {
+            for (int leaf : {1, 2}) {
+                FieldMatcher leafMatcher = whatMatcher;
+                leafMatcher.mutable_child(0)->add_child()->set_field(leaf);
+                whatMatchers.push_back(leafMatcher);
+            }
+        }
+    }
+
+    for (const FieldMatcher& whatMatcher : whatMatchers) {
+        Metric2Condition link;
+        translateFieldMatcher(whatMatcher, &link.metricFields);
+        link.conditionFields.clear();
+        for (size_t i = 0; i < link.metricFields.size(); i++) {
+            translateFieldMatcher(conditionMatcher, &link.conditionFields);
+        }
+        initMetric2ConditionValueIndices(&link);
+
+        // The values matched by each metric field, as the generic path selects them.
+        vector<FieldValue> matchedValues;
+        for (const Matcher& matcher : link.metricFields) {
+            filterGaugeValues({matcher}, event.getValues(), &matchedValues);
+        }
+
+        Metric2Condition genericLink = link;
+        genericLink.metricFieldValueIndices.clear();
+        HashableDimensionKey output;
+        HashableDimensionKey expectedOutput;
+        getDimensionForCondition(event.getValues(), link, &output);
+        getDimensionForCondition(event.getValues(), genericLink, &expectedOutput);
+        EXPECT_EQ(expectedOutput, output) << whatMatcher.DebugString();
+        EXPECT_EQ(matchedValues.size(), output.getValues().size()) << whatMatcher.DebugString();
+    }
+}
+
 TEST(AtomMatcherTest, TestWriteDimensionPath) {
     for (auto position : {Position::ALL, Position::FIRST, Position::LAST}) {
         FieldMatcher matcher1;
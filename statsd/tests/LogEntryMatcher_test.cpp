@@ -16,6 +16,7 @@
 #include <stdio.h>
 
 #include "matchers/matcher_util.h"
+#include "src/metrics/parsing_utils/metrics_manager_util.h"
 #include "src/statsd_config.pb.h"
 #include "stats_annotations.h"
 #include "stats_event.h"
@@ -1500,6 +1501,107 @@ TEST(AtomMatcherTest, TestNeqAnyIntMatcher) {
     EXPECT_FALSE(matchesSimple(uidMap, *simpleMatcher, event));
 }
 
+
+namespace {
+
+AtomMatcher createIntEqAtomMatcher(const string& name, const int32_t atomId, const int32_t value) {
+    AtomMatcher matcher = CreateSimpleAtomMatcher(name, atomId);
+    FieldValueMatcher* fieldValueMatcher =
+            matcher.mutable_simple_atom_matcher()->add_field_value_matcher();
+    fieldValueMatcher->set_field(FIELD_ID_1);
+    fieldValueMatcher->set_eq_int(value);
+    return matcher;
+}
+
+AtomMatcher createCombinationAtomMatcher(const string& name, const LogicalOperation operation,
+                                         const vector<string>& children) {
+    AtomMatcher matcher;
+    matcher.set_id(StringToId(name));
+    matcher.mutable_combination()->set_operation(operation);
+    for (const string& child : children) {
+        matcher.mutable_combination()->add_matcher(StringToId(child));
+    }
+    return matcher;
+}
+
+}  // namespace
+
+TEST(AtomMatcherTest, TestAtomMatcherEvaluationPlan) {
+    StatsdConfig config;
+    *config.add_atom_matcher() = createCombinationAtomMatcher("NotOneOrTwo", LogicalOperation::NOR,
+                                                              {"OneOrTwo"});
+    *config.add_atom_matcher() = createIntEqAtomMatcher("One", TAG_ID, 1);
+    *config.add_atom_matcher() = createIntEqAtomMatcher("Two", TAG_ID, 2);
+    *config.add_atom_matcher() = CreateSimpleAtomMatcher("Other", TAG_ID_2);
+    *config.add_atom_matcher() =
+            createCombinationAtomMatcher("OneOrTwo", LogicalOperation::OR, {"One", "Two"});
+    *config.add_atom_matcher() =
+            createCombinationAtomMatcher("OneAndOther", LogicalOperation::AND, {"One", "Other"});
+    *config.add_atom_matcher() =
+            createCombinationAtomMatcher("NotOther", LogicalOperation::NOT, {"Other"});
+    *config.add_atom_matcher() = createCombinationAtomMatcher("NotOneOrTwoAndOther",
+                                                              LogicalOperation::NAND,
+                                                              {"OneOrTwo", "Other"});
+    *config.add_atom_matcher() =
+            createCombinationAtomMatcher("OneOrTwoAndOne", LogicalOperation::AND,
+                                         {"OneOrTwo", "One"});
+
+    sp<UidMap> uidMap = new UidMap();
+    unordered_map<int64_t, int> atomMatchingTrackerMap;
+    vector<sp<AtomMatchingTracker>> allAtomMatchingTrackers;
+    unordered_map<int, vector<int>> tagIdsToMatchersMap;
+    ASSERT_EQ(initAtomMatchingTrackers(config, uidMap, atomMatchingTrackerMap,
+                                       allAtomMatchingTrackers, tagIdsToMatchersMap),
+              nullopt);
+
+    for (const int32_t tagId : {TAG_ID, TAG_ID_2}) {
+        const AtomMatcherEvaluationPlan plan =
+                createAtomMatcherEvaluationPlan(tagIdsToMatchersMap[tagId],
+                                                allAtomMatchingTrackers);
+        ASSERT_EQ(plan.steps.size(), tagIdsToMatchersMap[tagId].size());
+
+        for (const int32_t value : {0, 1, 2}) {
+            LogEvent event(/*uid=*/0, /*pid=*/0);
+            makeIntLogEvent(&event, tagId, /*timestamp=*/0, value);
+
+            // Results of the recursive evaluation of the matchers.
+            vector<MatchingState> expectedResults(allAtomMatchingTrackers.size(),
+                                                  MatchingState::kNotComputed);
+            for (const int matcherIndex : tagIdsToMatchersMap[tagId]) {
+                allAtomMatchingTrackers[matcherIndex]->onLogEvent(event, allAtomMatchingTrackers,
+                                                                  expectedResults);
+            }
+
+            vector<MatchingState> results(allAtomMatchingTrackers.size(),
+                                          MatchingState::kNotComputed);
+            evaluateAtomMatchers(plan, event, allAtomMatchingTrackers, results);
+            for (const int matcherIndex : tagIdsToMatchersMap[tagId]) {
+                EXPECT_EQ(results[matcherIndex], expectedResults[matcherIndex])
+                        << "tag " << tagId << " value " << value << " matcher " << matcherIndex;
+            }
+        }
+    }
+
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    makeIntLogEvent(&event, TAG_ID, /*timestamp=*/0, 2);
+    vector<MatchingState> results(allAtomMatchingTrackers.size(), MatchingState::kNotComputed);
+    evaluateAtomMatchers(
+            createAtomMatcherEvaluationPlan(tagIdsToMatchersMap[TAG_ID], allAtomMatchingTrackers),
+            event, allAtomMatchingTrackers, results);
+    EXPECT_EQ(results[atomMatchingTrackerMap[StringToId("NotOneOrTwo")]],
+              MatchingState::kNotMatched);
+    EXPECT_EQ(results[atomMatchingTrackerMap[StringToId("OneOrTwo")]], MatchingState::kMatched);
+    EXPECT_EQ(results[atomMatchingTrackerMap[StringToId("OneAndOther")]],
+              MatchingState::kNotMatched);
+    EXPECT_EQ(results[atomMatchingTrackerMap[StringToId("NotOther")]], MatchingState::kMatched);
+    EXPECT_EQ(results[atomMatchingTrackerMap[StringToId("NotOneOrTwoAndOther")]],
+              MatchingState::kMatched);
+    EXPECT_EQ(results[atomMatchingTrackerMap[StringToId("OneOrTwoAndOne")]],
+              MatchingState::kNotMatched);
+    // Matchers that cannot match the atom are not evaluated.
+    EXPECT_EQ(results[atomMatchingTrackerMap[StringToId("Other")]], MatchingState::kNotComputed);
+}
+
 #else
 GTEST_LOG_(INFO) << "This test does nothing.\n";
 #endif
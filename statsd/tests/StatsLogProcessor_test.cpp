@@ -219,6 +219,7 @@ public:
                 (override));
     MOCK_METHOD(size_t, byteSize, (), (override));
     MOCK_METHOD(void, flushRestrictedData, (), (override));
+    MOCK_METHOD(void, queueRestrictedDataFlush, (RestrictedDbWriter & writer), (override));
 };
 
 TEST(StatsLogProcessorTest, TestUidMapHasSnapshot) {
@@ -2273,7 +2274,7 @@ TEST_F(StatsLogProcessorTestRestricted, RestrictedMetricFlushIfReachMemoryLimit)
             /*timeBaseNs=*/1, /*currentTimeNs=*/1, makeRestrictedConfig(/*includeMetric=*/true),
             mConfigKey);
     sp<MockRestrictedMetricsManager> metricsManager = new MockRestrictedMetricsManager(mConfigKey);
-    EXPECT_CALL(*metricsManager, flushRestrictedData).Times(1);
+    EXPECT_CALL(*metricsManager, queueRestrictedDataFlush).Times(1);
     EXPECT_CALL(*metricsManager, byteSize)
             .Times(1)
             .WillOnce(Return(StatsdStats::kBytesPerRestrictedConfigTriggerFlush + 1));
@@ -2289,7 +2290,7 @@ TEST_F(StatsLogProcessorTestRestricted, RestrictedMetricNotFlushIfNotReachMemory
             /*timeBaseNs=*/1, /*currentTimeNs=*/1, makeRestrictedConfig(/*includeMetric=*/true),
             mConfigKey);
     sp<MockRestrictedMetricsManager> metricsManager = new MockRestrictedMetricsManager(mConfigKey);
-    EXPECT_CALL(*metricsManager, flushRestrictedData).Times(0);
+    EXPECT_CALL(*metricsManager, queueRestrictedDataFlush).Times(0);
     EXPECT_CALL(*metricsManager, byteSize)
             .Times(1)
             .WillOnce(Return(StatsdStats::kBytesPerRestrictedConfigTriggerFlush - 1));
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/anomaly/AlarmTimerWheel.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "src/anomaly/AlarmMonitor.h"
+
+using namespace android::os::statsd;
+using std::unordered_set;
+
+#ifdef __ANDROID__
+TEST(AlarmTimerWheelTest, TestPushAndRemove) {
+    AlarmTimerWheel wheel;
+    sp<const InternalAlarm> a = new InternalAlarm{10};
+    sp<const InternalAlarm> b = new InternalAlarm{10};
+    sp<const InternalAlarm> c = new InternalAlarm{300};
+
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(0u, wheel.getSoonestTimestampSec());
+
+    wheel.push(a);
+    wheel.push(b);
+    wheel.push(c);
+    wheel.push(a);  // Already present.
+    ASSERT_EQ(3u, wheel.size());
+    EXPECT_EQ(10u, wheel.getSoonestTimestampSec());
+
+    EXPECT_TRUE(wheel.remove(a));
+    EXPECT_FALSE(wheel.remove(a));
+    ASSERT_EQ(2u, wheel.size());
+    EXPECT_EQ(10u, wheel.getSoonestTimestampSec());
+
+    EXPECT_TRUE(wheel.remove(b));
+    EXPECT_EQ(300u, wheel.getSoonestTimestampSec());
+
+    EXPECT_TRUE(wheel.remove(c));
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(0u, wheel.getSoonestTimestampSec());
+}
+
+TEST(AlarmTimerWheelTest, TestAlarmInAnotherWheel) {
+    AlarmTimerWheel wheel1;
+    AlarmTimerWheel wheel2;
+    sp<const InternalAlarm> a = new InternalAlarm{10};
+    sp<const InternalAlarm> b = new InternalAlarm{10};
+
+    wheel1.push(a);
+    wheel2.push(b);
+    wheel2.push(a);
+    ASSERT_EQ(1u, wheel2.size());
+    EXPECT_FALSE(wheel2.remove(a));
+    EXPECT_TRUE(wheel1.remove(a));
+}
+
+TEST(AlarmTimerWheelTest, TestPopSoonerThanCascades) {
+    AlarmTimerWheel wheel;
+    // Spread the alarms over all levels of the wheel.
+    const uint32_t base = 1700000000;
+    sp<const InternalAlarm> a = new InternalAlarm{base};
+    sp<const InternalAlarm> b = new InternalAlarm{base + 1};
+    sp<const InternalAlarm> c = new InternalAlarm{base + 1000};
+    sp<const InternalAlarm> d = new InternalAlarm{base + 100000};
+    sp<const InternalAlarm> e = new InternalAlarm{base + 100000000};
+    for (const auto& alarm : {e, d, c, b, a}) {
+        wheel.push(alarm);
+    }
+    unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>> popped;
+
+    wheel.popSoonerThan(base - 1, popped);
+    EXPECT_TRUE(popped.empty());
+    EXPECT_EQ(base, wheel.getSoonestTimestampSec());
+
+    wheel.popSoonerThan(base, popped);
+    ASSERT_EQ(1u, popped.size());
+    EXPECT_EQ(1u, popped.count(a));
+    EXPECT_EQ(base + 1, wheel.getSoonestTimestampSec());
+
+    popped.clear();
+    wheel.popSoonerThan(base + 999, popped);
+    ASSERT_EQ(1u, popped.size());
+    EXPECT_EQ(1u, popped.count(b));
+    EXPECT_EQ(base + 1000, wheel.getSoonestTimestampSec());
+
+    popped.clear();
+    wheel.popSoonerThan(base + 100000, popped);
+    ASSERT_EQ(2u, popped.size());
+    EXPECT_EQ(1u, popped.count(c));
+    EXPECT_EQ(1u, popped.count(d));
+    EXPECT_EQ(base + 100000000, wheel.getSoonestTimestampSec());
+
+    popped.clear();
+    wheel.popSoonerThan(UINT32_MAX, popped);
+    ASSERT_EQ(1u, popped.size());
+    EXPECT_EQ(1u, popped.count(e));
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(AlarmTimerWheelTest, TestPushInThePast) {
+    AlarmTimerWheel wheel;
+    unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>> popped;
+    sp<const InternalAlarm> a = new InternalAlarm{1000};
+    sp<const InternalAlarm> b = new InternalAlarm{2000};
+    wheel.push(a);
+    wheel.push(b);
+    wheel.popSoonerThan(1500, popped);
+    ASSERT_EQ(1u, popped.size());
+
+    // Alarms that are already due are popped by the next call.
+    sp<const InternalAlarm> c = new InternalAlarm{500};
+    wheel.push(c);
+    EXPECT_EQ(500u, wheel.getSoonestTimestampSec());
+    popped.clear();
+    wheel.popSoonerThan(600, popped);
+    ASSERT_EQ(1u, popped.size());
+    EXPECT_EQ(1u, popped.count(c));
+    EXPECT_EQ(2000u, wheel.getSoonestTimestampSec());
+}
+
+TEST(AlarmTimerWheelTest, TestRemoveSoonest) {
+    AlarmTimerWheel wheel;
+    const uint32_t base = 1700000000;
+    std::vector<sp<const InternalAlarm>> alarms;
+    for (uint32_t offsetSec : {3600, 1, 700, 1, 70000, 2}) {
+        alarms.push_back(new InternalAlarm{base + offsetSec});
+        wheel.push(alarms.back());
+    }
+    std::sort(alarms.begin(), alarms.end(),
+              [](const sp<const InternalAlarm>& a, const sp<const InternalAlarm>& b) {
+                  return a->timestampSec < b->timestampSec;
+              });
+    EXPECT_EQ(base + 1, wheel.getSoonestTimestampSec());
+
+    // The lookup advances the wheel to the soonest alarm, so an earlier alarm pushed afterwards
+    // must still be found.
+    sp<const InternalAlarm> early = new InternalAlarm{base - 10};
+    wheel.push(early);
+    EXPECT_EQ(base - 10, wheel.getSoonestTimestampSec());
+    EXPECT_TRUE(wheel.remove(early));
+
+    for (size_t i = 0; i < alarms.size(); i++) {
+        EXPECT_EQ(alarms[i]->timestampSec, wheel.getSoonestTimestampSec());
+        EXPECT_TRUE(wheel.remove(alarms[i]));
+    }
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(0u, wheel.getSoonestTimestampSec());
+}
+
+TEST(AlarmTimerWheelTest, TestMatchesSortedOrder) {
+    AlarmTimerWheel wheel;
+    std::vector<sp<const InternalAlarm>> alarms;
+    uint32_t timestampSec = 1;
+    for (int i = 0; i < 2000; i++) {
+        // Deterministic pseudo-random timestamps over several levels.
+        timestampSec = timestampSec * 1103515245 + 12345;
+        alarms.push_back(new InternalAlarm{1 + (timestampSec >> 12)});
+        wheel.push(alarms.back());
+    }
+    for (size_t i = 0; i < alarms.size(); i += 3) {
+        EXPECT_TRUE(wheel.remove(alarms[i]));
+    }
+
+    std::vector<uint32_t> expected;
+    for (size_t i = 0; i < alarms.size(); i++) {
+        if (i % 3 != 0) {
+            expected.push_back(alarms[i]->timestampSec);
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<uint32_t> actual;
+    unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>> popped;
+    while (!wheel.empty()) {
+        const uint32_t soonest = wheel.getSoonestTimestampSec();
+        popped.clear();
+        wheel.popSoonerThan(soonest, popped);
+        ASSERT_FALSE(popped.empty());
+        for (const auto& alarm : popped) {
+            EXPECT_EQ(soonest, alarm->timestampSec);
+            actual.push_back(alarm->timestampSec);
+        }
+    }
+    EXPECT_EQ(expected, actual);
+}
+
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
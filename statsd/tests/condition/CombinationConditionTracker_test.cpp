@@ -162,6 +162,51 @@ TEST(ConditionTrackerTest, TestNorCondition) {
     EXPECT_FALSE(evaluateCombinationCondition(children, operation, conditionResults));
 }
 
+TEST(ConditionTrackerTest, TestConditionEvaluationPlan) {
+    // Condition 0 = combination(1, 2), 2 = combination(3). 1, 3 and 4 are simple conditions.
+    vector<vector<int>> conditionChildren = {{1, 2}, {}, {3}, {}, {}};
+    // Matcher 0 is used by condition 1, matcher 1 by condition 3 and matcher 2 by condition 4.
+    // Combination conditions use the matchers of their children. Matcher 3 is not used.
+    std::unordered_map<int, vector<int>> trackerToConditionMap = {
+            {0, {0, 1}}, {1, {0, 2, 3}}, {2, {4}}};
+
+    ConditionEvaluationPlan plan =
+            createConditionEvaluationPlan(conditionChildren, trackerToConditionMap, 4);
+
+    EXPECT_EQ(plan.order, vector<int>({1, 3, 2, 0, 4}));
+    ASSERT_EQ(plan.matcherConditionCones.size(), 4);
+    // Condition 0 also needs condition 2 and 3 to be evaluated, even though they do not use
+    // matcher 0.
+    EXPECT_EQ(plan.matcherConditionCones[0], vector<uint64_t>({0b01111}));
+    EXPECT_EQ(plan.matcherConditionCones[1], vector<uint64_t>({0b01111}));
+    EXPECT_EQ(plan.matcherConditionCones[2], vector<uint64_t>({0b10000}));
+    EXPECT_TRUE(plan.matcherConditionCones[3].empty());
+}
+
+TEST(ConditionTrackerTest, TestConditionEvaluationPlanManyConditions) {
+    // A chain of 100 NOT conditions on top of one simple condition: i = NOT(i + 1).
+    const int conditionCount = 101;
+    vector<vector<int>> conditionChildren(conditionCount);
+    vector<int> allConditions;
+    for (int i = 0; i < conditionCount; i++) {
+        if (i + 1 < conditionCount) {
+            conditionChildren[i].push_back(i + 1);
+        }
+        allConditions.push_back(i);
+    }
+    std::unordered_map<int, vector<int>> trackerToConditionMap = {{0, allConditions}};
+
+    ConditionEvaluationPlan plan =
+            createConditionEvaluationPlan(conditionChildren, trackerToConditionMap, 1);
+
+    ASSERT_EQ(plan.order.size(), conditionCount);
+    for (int pos = 0; pos < conditionCount; pos++) {
+        EXPECT_EQ(plan.order[pos], conditionCount - 1 - pos);
+    }
+    EXPECT_EQ(plan.matcherConditionCones[0],
+              vector<uint64_t>({UINT64_MAX, (uint64_t{1} << (conditionCount - 64)) - 1}));
+}
+
 #else
 GTEST_LOG_(INFO) << "This test does nothing.\n";
 #endif
@@ -2008,6 +2008,70 @@ TEST(CountMetricE2eTest, TestDimensionalSampling) {
                         2);
 }
 
+TEST(CountMetricE2eTest, TestDimensionDictionaryInReport) {
+    StatsdConfig config;
+    config.set_dimension_dictionary_in_metric_report(true);
+
+    auto appCrashMatcher = CreateSimpleAtomMatcher("APP_CRASH_OCCURRED", util::APP_CRASH_OCCURRED);
+    *config.add_atom_matcher() = appCrashMatcher;
+
+    // Both metrics slice by uid, so they share their dimension keys.
+    CountMetric countMetric1 = createCountMetric("COUNT1", appCrashMatcher.id(), nullopt, {});
+    *countMetric1.mutable_dimensions_in_what() =
+            CreateDimensions(util::APP_CRASH_OCCURRED, {1 /*uid*/});
+    *config.add_count_metric() = countMetric1;
+    CountMetric countMetric2 = createCountMetric("COUNT2", appCrashMatcher.id(), nullopt, {});
+    *countMetric2.mutable_dimensions_in_what() =
+            CreateDimensions(util::APP_CRASH_OCCURRED, {1 /*uid*/});
+    *config.add_count_metric() = countMetric2;
+
+    const uint64_t bucketStartTimeNs = 10000000000;  // 0:10
+    const uint64_t bucketSizeNs =
+            TimeUnitToBucketSizeInMillis(config.count_metric(0).bucket()) * 1000000LL;
+    int uid = 12345;
+    int64_t cfgId = 98765;
+    ConfigKey cfgKey(uid, cfgId);
+    auto processor = CreateStatsLogProcessor(bucketStartTimeNs, bucketStartTimeNs, config, cfgKey);
+
+    int appUid1 = 1;
+    int appUid2 = 2;
+    std::vector<std::unique_ptr<LogEvent>> events;
+    events.push_back(CreateAppCrashOccurredEvent(bucketStartTimeNs + 20 * NS_PER_SEC, appUid1));
+    events.push_back(CreateAppCrashOccurredEvent(bucketStartTimeNs + 40 * NS_PER_SEC, appUid2));
+    events.push_back(CreateAppCrashOccurredEvent(bucketStartTimeNs + 60 * NS_PER_SEC, appUid1));
+    for (auto& event : events) {
+        processor->OnLogEvent(event.get());
+    }
+
+    vector<uint8_t> buffer;
+    ConfigMetricsReportList reports;
+    processor->onDumpReport(cfgKey, bucketStartTimeNs + bucketSizeNs + 1, false, true, ADB_DUMP,
+                            FAST, &buffer);
+    ASSERT_GT(buffer.size(), 0);
+    EXPECT_TRUE(reports.ParseFromArray(&buffer[0], buffer.size()));
+    ASSERT_EQ(1, reports.reports_size());
+    const ConfigMetricsReport& report = reports.reports(0);
+
+    // Each uid is written once for the whole report.
+    ASSERT_EQ(2, report.dimension_dictionary_size());
+    ASSERT_EQ(2, report.metrics_size());
+    for (const StatsLogReport& metricReport : report.metrics()) {
+        ASSERT_EQ(2, metricReport.count_metrics().data_size());
+        for (const CountMetricData& data : metricReport.count_metrics().data()) {
+            EXPECT_FALSE(data.has_dimensions_in_what());
+            EXPECT_EQ(0, data.dimension_leaf_values_in_what_size());
+            ASSERT_TRUE(data.has_dimension_in_what_index());
+            ASSERT_LT(data.dimension_in_what_index(), report.dimension_dictionary_size());
+            const DimensionsValue& dimension =
+                    report.dimension_dictionary(data.dimension_in_what_index());
+            const int appUid = dimension.value_tuple().dimensions_value(0).value_int();
+            ValidateUidDimension(dimension, util::APP_CRASH_OCCURRED, appUid);
+            ASSERT_EQ(1, data.bucket_info_size());
+            EXPECT_EQ(appUid == appUid1 ? 2 : 1, data.bucket_info(0).count());
+        }
+    }
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
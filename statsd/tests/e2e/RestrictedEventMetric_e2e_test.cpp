@@ -127,6 +127,9 @@ private:
         columnTypesResult.clear();
         rowCountResult = 0;
         error = "";
+        if (processor != nullptr) {
+            processor->mRestrictedDbWriter.waitForPendingWrites();
+        }
         dbutils::deleteDb(configKey);
         dbutils::deleteDb(ConfigKey(config_app_uid + 1, configId));
         FlagProvider::getInstance().resetOverrides();
@@ -795,6 +798,7 @@ TEST_F(RestrictedEventMetricE2eTest, TestLogEventsEnforceTtls) {
     processor->OnLogEvent(event2.get(), newEventElapsedTime);
     processor->OnLogEvent(event3.get(), newEventElapsedTime + 100);
     processor->flushRestrictedDataLocked(newEventElapsedTime);
+    processor->mRestrictedDbWriter.waitForPendingWrites();
 
     std::stringstream query;
     query << "SELECT * FROM metric_" << dbutils::reformatMetricId(restrictedMetricId);
@@ -829,6 +833,7 @@ TEST_F(RestrictedEventMetricE2eTest, TestLogEventsDoesNotEnforceTtls) {
     processor->OnLogEvent(event1.get(), originalEventElapsedTime);
     processor->OnLogEvent(event2.get(), newEventElapsedTime);
     processor->flushRestrictedDataLocked(newEventElapsedTime);
+    processor->mRestrictedDbWriter.waitForPendingWrites();
 
     std::stringstream query;
     query << "SELECT * FROM metric_" << dbutils::reformatMetricId(restrictedMetricId);
@@ -930,6 +935,8 @@ TEST_F(RestrictedEventMetricE2eTest, TestEnforceDbGuardrails) {
                 ElementsAre(SQLITE_INTEGER, SQLITE_INTEGER, SQLITE_INTEGER, SQLITE_INTEGER));
 
     processor->enforceDbGuardrailsIfNecessaryLocked(oneMonthLater, dbEnforcementTimeNs);
+    // The guardrails are enforced on the db writer thread.
+    processor->mRestrictedDbWriter.waitForPendingWrites();
 
     EXPECT_FALSE(StorageManager::hasFile(
             base::StringPrintf("%s/%s", STATS_RESTRICTED_DATA_DIR, "123_12345.db").c_str()));
@@ -965,6 +972,8 @@ TEST_F(RestrictedEventMetricE2eTest, TestEnforceDbGuardrailsDoesNotDeleteBeforeG
                 ElementsAre(SQLITE_INTEGER, SQLITE_INTEGER, SQLITE_INTEGER, SQLITE_INTEGER));
 
     processor->enforceDbGuardrailsIfNecessaryLocked(oneMonthLater, originalEventElapsedTime);
+    // The guardrails are enforced on the db writer thread.
+    processor->mRestrictedDbWriter.waitForPendingWrites();
 
     EXPECT_TRUE(StorageManager::hasFile(
             base::StringPrintf("%s/%s", STATS_RESTRICTED_DATA_DIR, "123_12345.db").c_str()));
@@ -1002,6 +1011,8 @@ TEST_F(RestrictedEventMetricE2eTest, TestFlushPeriodically) {
     for (auto& event : events) {
         processor->OnLogEvent(event.get(), event->GetElapsedTimestampNs());
     }
+    // The flush is done on the db writer thread.
+    processor->mRestrictedDbWriter.waitForPendingWrites();
 
     std::stringstream query;
     query << "SELECT * FROM metric_" << dbutils::reformatMetricId(restrictedMetricId);
@@ -1028,6 +1039,8 @@ TEST_F(RestrictedEventMetricE2eTest, TestOnLogEventMalformedDbNameDeleted) {
     processor->mLastTtlTime = originalEventElapsedTime;
     // Send log events to StatsLogProcessor.
     processor->OnLogEvent(event2.get(), newEventElapsedTime);
+    // The guardrails are enforced on the db writer thread.
+    processor->mRestrictedDbWriter.waitForPendingWrites();
 
     EXPECT_FALSE(StorageManager::hasFile(fileName.c_str()));
     StorageManager::deleteFile(fileName.c_str());
@@ -1070,6 +1083,7 @@ TEST_F(RestrictedEventMetricE2eTest, TestRestrictedMetricLoadsTtlFromDisk) {
     event1->setLogdWallClockTimestampNs(eightDaysAgo);
     processor->OnLogEvent(event1.get(), originalEventElapsedTime);
     processor->flushRestrictedDataLocked(originalEventElapsedTime);
+    processor->mRestrictedDbWriter.waitForPendingWrites();
     int64_t wallClockNs = 1584991200 * NS_PER_SEC;  // random time
     int64_t metadataWriteTime = originalEventElapsedTime + 5000 * NS_PER_SEC;
     processor->SaveMetadataToDisk(wallClockNs, metadataWriteTime);
@@ -1101,6 +1115,7 @@ TEST_F(RestrictedEventMetricE2eTest, TestRestrictedMetricLoadsTtlFromDisk) {
     event2->setLogdWallClockTimestampNs(currentWallTimeNs);
     processor2->OnLogEvent(event2.get(), newEventElapsedTime);
     processor2->flushRestrictedDataLocked(newEventElapsedTime);
+    processor2->mRestrictedDbWriter.waitForPendingWrites();
 
     columnTypes.clear();
     columnNames.clear();
@@ -139,6 +139,27 @@ TEST_F(StatsCallbackPullerTest, PullSuccess) {
     EXPECT_EQ(value, dataHolder[0]->getValues()[0].mValue.int_value);
 }
 
+TEST_F(StatsCallbackPullerTest, PullSuccessMultipleEvents) {
+    shared_ptr<FakePullAtomCallback> cb = SharedRefBase::make<FakePullAtomCallback>();
+    pullSuccess = true;
+    values = {43, 44, 45};
+
+    StatsCallbackPuller puller(pullTagId, cb, pullCoolDownNs, pullTimeoutNs, {});
+
+    vector<std::shared_ptr<LogEvent>> dataHolder;
+    EXPECT_EQ(puller.PullInternal(&dataHolder), PULL_SUCCESS);
+
+    ASSERT_EQ(values.size(), dataHolder.size());
+    for (int i = 0; i < values.size(); i++) {
+        EXPECT_EQ(pullTagId, dataHolder[i]->GetTagId());
+        ASSERT_EQ(1, dataHolder[i]->size());
+        EXPECT_EQ(values[i], dataHolder[i]->getValues()[0].mValue.int_value);
+        // The events are parsed into one batch that is owned by all of them.
+        EXPECT_EQ(dataHolder[0].get() + i, dataHolder[i].get());
+        EXPECT_EQ((long)values.size(), dataHolder[i].use_count());
+    }
+}
+
 TEST_F(StatsCallbackPullerTest, PullFail) {
     shared_ptr<FakePullAtomCallback> cb = SharedRefBase::make<FakePullAtomCallback>();
     pullSuccess = false;
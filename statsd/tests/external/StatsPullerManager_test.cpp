@@ -19,6 +19,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+
 #include "stats_event.h"
 #include "tests/statsd_test_util.h"
 
@@ -27,6 +33,7 @@ using ::ndk::SharedRefBase;
 using std::make_shared;
 using std::shared_ptr;
 using std::vector;
+using testing::ElementsAre;
 
 namespace android {
 namespace os {
@@ -74,6 +81,75 @@ public:
     int32_t mUid;
 };
 
+// Pull callback that blocks until it is released, so that tests can observe what happens while
+// a pull is in flight.
+class BlockingPullAtomCallback : public FakePullAtomCallback {
+public:
+    BlockingPullAtomCallback(int32_t uid)
+        : FakePullAtomCallback(uid), mReleased(mRelease.get_future().share()){};
+    Status onPullAtom(int atomTag,
+                      const shared_ptr<IPullAtomResultReceiver>& resultReceiver) override {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mNumPulls++;
+        }
+        mPullStarted.notify_all();
+        mReleased.wait();
+        return FakePullAtomCallback::onPullAtom(atomTag, resultReceiver);
+    }
+    void waitForPullStarted() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mPullStarted.wait(lock, [this] { return mNumPulls > 0; });
+    }
+    void release() {
+        mRelease.set_value();
+    }
+    int getNumPulls() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mNumPulls;
+    }
+
+private:
+    std::promise<void> mRelease;
+    std::shared_future<void> mReleased;
+    std::mutex mMutex;
+    std::condition_variable mPullStarted;
+    int mNumPulls = 0;
+};
+
+class FakePullDataReceiver : public PullDataReceiver {
+public:
+    void onDataPulled(const vector<shared_ptr<LogEvent>>& data, PullResult pullResult,
+                      int64_t originalPullTimeNs) override {
+        mPullResult = pullResult;
+        mNumEvents = data.size();
+    }
+    bool isPullNeeded() const override {
+        return true;
+    }
+    PullResult mPullResult = PullResult::PULL_NOT_NEEDED;
+    size_t mNumEvents = 0;
+};
+
+// Records the times it was pulled at.
+class PullTimeRecordingReceiver : public FakePullDataReceiver {
+public:
+    void onDataPulled(const vector<shared_ptr<LogEvent>>& data, PullResult pullResult,
+                      int64_t originalPullTimeNs) override {
+        FakePullDataReceiver::onDataPulled(data, pullResult, originalPullTimeNs);
+        mPullTimesNs.push_back(originalPullTimeNs);
+    }
+    vector<int64_t> mPullTimesNs;
+};
+
+// Pulls every atom from uid1.
+class Uid1PullUidProvider : public PullUidProvider {
+public:
+    vector<int32_t> getPullAtomUids(int atomId) override {
+        return {uid1};
+    }
+};
+
 class FakePullUidProvider : public PullUidProvider {
 public:
     vector<int32_t> getPullAtomUids(int atomId) override {
@@ -145,6 +221,212 @@ TEST(StatsPullerManagerTest, TestPullConfigKeyNoPullerWithUid) {
     EXPECT_FALSE(pullerManager->Pull(pullTagId2, configKey, /*timestamp =*/1, &data));
 }
 
+TEST(StatsPullerManagerTest, TestOnAlarmFiredPullsConcurrently) {
+    const int numAtoms = 4;
+    const int firstTagId = 10110;
+    ConfigKey configKey2(50, 54321);
+
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<Uid1PullUidProvider> uidProvider = new Uid1PullUidProvider();
+    pullerManager->RegisterPullUidProvider(configKey, uidProvider);
+    pullerManager->RegisterPullUidProvider(configKey2, uidProvider);
+
+    vector<shared_ptr<BlockingPullAtomCallback>> callbacks;
+    vector<sp<FakePullDataReceiver>> receivers;
+    for (int i = 0; i < numAtoms; i++) {
+        callbacks.push_back(SharedRefBase::make<BlockingPullAtomCallback>(uid1));
+        pullerManager->RegisterPullAtomCallback(uid1, firstTagId + i, coolDownNs,
+                                                /*timeoutNs=*/10 * NS_PER_SEC, {},
+                                                callbacks.back());
+        receivers.push_back(new FakePullDataReceiver());
+        pullerManager->RegisterReceiver(firstTagId + i, configKey, receivers.back(),
+                                        /*nextPullTimeNs=*/1, /*intervalNs=*/60 * NS_PER_SEC,
+                                        StatsdStats::kPullMaxDelayNs);
+    }
+    // A second config pulling the first atom shares its pull.
+    receivers.push_back(new FakePullDataReceiver());
+    pullerManager->RegisterReceiver(firstTagId, configKey2, receivers.back(),
+                                    /*nextPullTimeNs=*/1, /*intervalNs=*/60 * NS_PER_SEC,
+                                    StatsdStats::kPullMaxDelayNs);
+
+    std::thread alarmThread([&pullerManager] { pullerManager->OnAlarmFired(/*elapsedTimeNs=*/1); });
+    // Every pull starts while none of them has returned.
+    for (const shared_ptr<BlockingPullAtomCallback>& callback : callbacks) {
+        callback->waitForPullStarted();
+    }
+    for (const shared_ptr<BlockingPullAtomCallback>& callback : callbacks) {
+        callback->release();
+    }
+    alarmThread.join();
+
+    for (const sp<FakePullDataReceiver>& receiver : receivers) {
+        EXPECT_EQ(PullResult::PULL_RESULT_SUCCESS, receiver->mPullResult);
+        EXPECT_EQ(1u, receiver->mNumEvents);
+    }
+    for (const shared_ptr<BlockingPullAtomCallback>& callback : callbacks) {
+        EXPECT_EQ(1, callback->getNumPulls());
+    }
+}
+
+TEST(StatsPullerManagerTest, TestOnAlarmFiredDoesNotHoldLocksWhilePulling) {
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<Uid1PullUidProvider> uidProvider = new Uid1PullUidProvider();
+    pullerManager->RegisterPullUidProvider(configKey, uidProvider);
+    shared_ptr<BlockingPullAtomCallback> callback =
+            SharedRefBase::make<BlockingPullAtomCallback>(uid1);
+    pullerManager->RegisterPullAtomCallback(uid1, pullTagId1, coolDownNs,
+                                            /*timeoutNs=*/10 * NS_PER_SEC, {}, callback);
+    sp<FakePullDataReceiver> receiver = new FakePullDataReceiver();
+    sp<FakePullDataReceiver> removedReceiver = new FakePullDataReceiver();
+    for (const sp<FakePullDataReceiver>& r : {receiver, removedReceiver}) {
+        pullerManager->RegisterReceiver(pullTagId1, configKey, r, /*nextPullTimeNs=*/1,
+                                        /*intervalNs=*/60 * NS_PER_SEC,
+                                        StatsdStats::kPullMaxDelayNs);
+    }
+
+    std::mutex receiversMutex;
+    std::thread alarmThread([&pullerManager, &receiversMutex] {
+        pullerManager->OnAlarmFired(/*elapsedTimeNs=*/1, &receiversMutex);
+    });
+    callback->waitForPullStarted();
+
+    // The pull is in flight, and holds neither the receivers mutex nor the puller manager lock.
+    ASSERT_TRUE(receiversMutex.try_lock());
+    receiversMutex.unlock();
+    ASSERT_TRUE(pullerManager->mLock.try_lock());
+    pullerManager->mLock.unlock();
+    sp<FakePullDataReceiver> newReceiver = new FakePullDataReceiver();
+    pullerManager->RegisterReceiver(pullTagId2, configKey, newReceiver,
+                                    /*nextPullTimeNs=*/60 * NS_PER_SEC,
+                                    /*intervalNs=*/60 * NS_PER_SEC, StatsdStats::kPullMaxDelayNs);
+    pullerManager->UnRegisterReceiver(pullTagId1, configKey, removedReceiver);
+
+    callback->release();
+    alarmThread.join();
+
+    EXPECT_EQ(1, callback->getNumPulls());
+    EXPECT_EQ(PullResult::PULL_RESULT_SUCCESS, receiver->mPullResult);
+    EXPECT_EQ(1u, receiver->mNumEvents);
+    // Unregistered before the pull finished, so the data is not delivered to it.
+    EXPECT_EQ(PullResult::PULL_NOT_NEEDED, removedReceiver->mPullResult);
+}
+
+TEST(StatsPullerManagerTest, TestPullAlarmsAreBatched) {
+    const int64_t startNs = 600 * NS_PER_SEC;
+    const int64_t hourNs = 3600 * NS_PER_SEC;
+    // Metrics with compatible bucket sizes created at different times. All but the last one are
+    // due within the batching window of the first one.
+    const vector<pair<int64_t, int64_t>> phasesAndIntervalsNs = {
+            {0, 300 * NS_PER_SEC},
+            {NS_PER_SEC / 2, 300 * NS_PER_SEC},
+            {NS_PER_SEC, 300 * NS_PER_SEC},
+            {2 * NS_PER_SEC, 300 * NS_PER_SEC},
+            {0, 900 * NS_PER_SEC},
+            {45 * NS_PER_SEC, 300 * NS_PER_SEC},
+    };
+
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<Uid1PullUidProvider> uidProvider = new Uid1PullUidProvider();
+    pullerManager->RegisterPullUidProvider(configKey, uidProvider);
+    shared_ptr<FakePullAtomCallback> cb = SharedRefBase::make<FakePullAtomCallback>(uid1);
+    pullerManager->RegisterPullAtomCallback(uid1, pullTagId1, coolDownNs, timeoutNs, {}, cb);
+
+    vector<sp<PullTimeRecordingReceiver>> receivers;
+    // Times at which the alarm fires if every receiver gets its own wakeup.
+    std::set<int64_t> unbatchedAlarmTimesNs;
+    for (const auto& [phaseNs, intervalNs] : phasesAndIntervalsNs) {
+        receivers.push_back(new PullTimeRecordingReceiver());
+        pullerManager->RegisterReceiver(pullTagId1, configKey, receivers.back(),
+                                        startNs + phaseNs, intervalNs,
+                                        StatsdStats::kPullMaxDelayNs);
+        for (int64_t timeNs = startNs + phaseNs; timeNs < startNs + hourNs; timeNs += intervalNs) {
+            unbatchedAlarmTimesNs.insert(timeNs);
+        }
+    }
+
+    int numWakeups = 0;
+    while (pullerManager->mNextPullTimeNs < startNs + hourNs) {
+        pullerManager->OnAlarmFired(pullerManager->mNextPullTimeNs);
+        numWakeups++;
+    }
+    GTEST_LOG_(INFO) << "Pull alarm wakeups per hour: " << unbatchedAlarmTimesNs.size()
+                     << " unbatched, " << numWakeups << " batched";
+    EXPECT_EQ(60u, unbatchedAlarmTimesNs.size());
+    EXPECT_EQ(24, numWakeups);
+
+    // Every bucket is still pulled once, never early and at most the batching window late.
+    for (size_t i = 0; i < receivers.size(); i++) {
+        const auto& [phaseNs, intervalNs] = phasesAndIntervalsNs[i];
+        const vector<int64_t>& pullTimesNs = receivers[i]->mPullTimesNs;
+        ASSERT_EQ(hourNs / intervalNs, (int64_t)pullTimesNs.size());
+        for (size_t bucket = 0; bucket < pullTimesNs.size(); bucket++) {
+            const int64_t scheduledTimeNs = startNs + phaseNs + bucket * intervalNs;
+            EXPECT_GE(pullTimesNs[bucket], scheduledTimeNs);
+            EXPECT_LE(pullTimesNs[bucket],
+                      scheduledTimeNs + StatsPullerManager::kPullAlarmBatchingWindowNs);
+        }
+    }
+}
+
+TEST(StatsPullerManagerTest, TestPullAlarmBatchingBoundedByMaxPullDelay) {
+    StatsdStats::getInstance().reset();
+    const int64_t startNs = 600 * NS_PER_SEC;
+    const int64_t intervalNs = 300 * NS_PER_SEC;
+
+    sp<StatsPullerManager> pullerManager = new StatsPullerManager();
+    sp<Uid1PullUidProvider> uidProvider = new Uid1PullUidProvider();
+    pullerManager->RegisterPullUidProvider(configKey, uidProvider);
+    shared_ptr<FakePullAtomCallback> cb = SharedRefBase::make<FakePullAtomCallback>(uid1);
+    pullerManager->RegisterPullAtomCallback(uid1, pullTagId1, coolDownNs, timeoutNs, {}, cb);
+    pullerManager->RegisterPullAtomCallback(uid1, pullTagId2, coolDownNs, timeoutNs, {}, cb);
+
+    const int64_t receiver2StartNs = startNs + NS_PER_SEC;
+    const int64_t receiver3StartNs = startNs + 3 * NS_PER_SEC / 2;
+
+    sp<PullTimeRecordingReceiver> receiver1 = new PullTimeRecordingReceiver();
+    pullerManager->RegisterReceiver(pullTagId1, configKey, receiver1, startNs, intervalNs,
+                                    StatsdStats::kPullMaxDelayNs);
+    // Can only be delayed by 250 ms, so the third receiver is not batched with it, although it
+    // is due within the batching window of the first one.
+    sp<PullTimeRecordingReceiver> receiver2 = new PullTimeRecordingReceiver();
+    pullerManager->RegisterReceiver(pullTagId1, configKey, receiver2, receiver2StartNs,
+                                    intervalNs,
+                                    StatsPullerManager::kMaxTimeoutNs + NS_PER_SEC / 4);
+    sp<PullTimeRecordingReceiver> receiver3 = new PullTimeRecordingReceiver();
+    pullerManager->RegisterReceiver(pullTagId1, configKey, receiver3, receiver3StartNs,
+                                    intervalNs, StatsdStats::kPullMaxDelayNs);
+    // A metric that cannot be delayed is pulled on its own alarm.
+    sp<PullTimeRecordingReceiver> receiver4 = new PullTimeRecordingReceiver();
+    pullerManager->RegisterReceiver(pullTagId2, configKey, receiver4, startNs - NS_PER_SEC,
+                                    intervalNs, /*maxPullDelayNs=*/NS_PER_SEC);
+
+    EXPECT_EQ(startNs - NS_PER_SEC, pullerManager->mNextPullTimeNs);
+    pullerManager->OnAlarmFired(pullerManager->mNextPullTimeNs);
+    EXPECT_EQ(receiver2StartNs, pullerManager->mNextPullTimeNs);
+    pullerManager->OnAlarmFired(pullerManager->mNextPullTimeNs);
+    EXPECT_EQ(receiver3StartNs, pullerManager->mNextPullTimeNs);
+    pullerManager->OnAlarmFired(pullerManager->mNextPullTimeNs);
+
+    EXPECT_THAT(receiver1->mPullTimesNs, ElementsAre(receiver2StartNs));
+    EXPECT_THAT(receiver2->mPullTimesNs, ElementsAre(receiver2StartNs));
+    EXPECT_THAT(receiver3->mPullTimesNs, ElementsAre(receiver3StartNs));
+    EXPECT_THAT(receiver4->mPullTimesNs, ElementsAre(startNs - NS_PER_SEC));
+
+    // The delay of the first receiver is reported.
+    StatsdStatsReport report = getStatsdStatsReport(/*reset stats*/ true);
+    bool foundPullStats = false;
+    for (const auto& pullStats : report.pulled_atom_stats()) {
+        if (pullStats.atom_id() == pullTagId1) {
+            foundPullStats = true;
+            EXPECT_EQ(1, pullStats.batched_pull_count());
+            EXPECT_EQ(receiver2StartNs - startNs, pullStats.max_pull_batching_delay_ns());
+        } else {
+            EXPECT_EQ(0, pullStats.batched_pull_count());
+        }
+    }
+    EXPECT_TRUE(foundPullStats);
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
\ No newline at end of file
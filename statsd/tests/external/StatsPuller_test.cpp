@@ -17,6 +17,8 @@
 #include <stdio.h>
 
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -60,6 +62,53 @@ private:
 
 FakePuller puller;
 
+// Puller whose pulls block until they are released, with a cool down and timeout long enough for
+// requests to come in while a pull is in flight.
+class BlockingPuller : public StatsPuller {
+public:
+    BlockingPuller()
+        : StatsPuller(pullTagId, /*coolDownNs=*/NS_PER_SEC, /*timeoutNs=*/NS_PER_SEC){};
+
+    // Waits until numPulls pulls have started.
+    void waitForPulls(int numPulls) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mPullStarted.wait(lock, [this, numPulls] { return mNumPulls >= numPulls; });
+    }
+
+    // Lets the pull that is in flight and any later pull return.
+    void release() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReleased = true;
+        mPullReleased.notify_all();
+    }
+
+private:
+    PullErrorCode PullInternal(vector<std::shared_ptr<LogEvent>>* data) override {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNumPulls++;
+        mPullStarted.notify_all();
+        mPullReleased.wait(lock, [this] { return mReleased; });
+        data->push_back(createSimpleEvent(/*eventTimeNs=*/1111L, /*value=*/mNumPulls));
+        return PULL_SUCCESS;
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mPullStarted;
+    std::condition_variable mPullReleased;
+    int mNumPulls = 0;
+    bool mReleased = false;
+};
+
+int64_t getCoalescedPullCount() {
+    StatsdStatsReport report = getStatsdStatsReport(/*resetStats=*/false);
+    for (const auto& pullStats : report.pulled_atom_stats()) {
+        if (pullStats.atom_id() == pullTagId) {
+            return pullStats.coalesced_pull_count();
+        }
+    }
+    return 0;
+}
+
 std::unique_ptr<LogEvent> createSimpleEvent(int64_t eventTimeNs, int64_t value) {
     AStatsEvent* statsEvent = AStatsEvent_obtain();
     AStatsEvent_setAtomId(statsEvent, pullTagId);
@@ -261,6 +310,65 @@ TEST_F(StatsPullerTest, PullSameEventTime) {
     EXPECT_EQ(33, dataHolder[0]->getValues()[0].mValue.int_value);
 }
 
+TEST_F(StatsPullerTest, PullConcurrentRequestsShareOnePull) {
+    BlockingPuller blockingPuller;
+    const int64_t coalescedPullCount = getCoalescedPullCount();
+    const int64_t eventTimeNs = getElapsedRealtimeNs();
+
+    vector<std::shared_ptr<LogEvent>> dataHolder1;
+    std::thread pullThread1(
+            [&] { EXPECT_EQ(blockingPuller.Pull(eventTimeNs, &dataHolder1), PULL_SUCCESS); });
+    blockingPuller.waitForPulls(1);
+    // A different event time, within the cool down of the pull that is in flight.
+    vector<std::shared_ptr<LogEvent>> dataHolder2;
+    std::thread pullThread2([&] {
+        EXPECT_EQ(blockingPuller.Pull(eventTimeNs + MillisToNano(1), &dataHolder2), PULL_SUCCESS);
+    });
+    // Give the second request time to join the pull before it is released.
+    sleep_for(std::chrono::milliseconds(10));
+    blockingPuller.release();
+    pullThread1.join();
+    pullThread2.join();
+
+    EXPECT_EQ(coalescedPullCount + 1, getCoalescedPullCount());
+    ASSERT_EQ(1, dataHolder1.size());
+    ASSERT_EQ(1, dataHolder2.size());
+    EXPECT_EQ(dataHolder1[0], dataHolder2[0]);
+    EXPECT_EQ(1, dataHolder2[0]->getValues()[0].mValue.long_value);
+}
+
+TEST_F(StatsPullerTest, PullCacheClearedWhilePulling) {
+    BlockingPuller blockingPuller;
+    const int64_t eventTimeNs = getElapsedRealtimeNs();
+
+    vector<std::shared_ptr<LogEvent>> dataHolder1;
+    std::thread pullThread1(
+            [&] { EXPECT_EQ(blockingPuller.Pull(eventTimeNs, &dataHolder1), PULL_SUCCESS); });
+    blockingPuller.waitForPulls(1);
+    vector<std::shared_ptr<LogEvent>> dataHolder2;
+    std::thread pullThread2(
+            [&] { EXPECT_EQ(blockingPuller.Pull(eventTimeNs, &dataHolder2), PULL_SUCCESS); });
+    // Give the second request time to join the pull before the cache is cleared.
+    sleep_for(std::chrono::milliseconds(10));
+    blockingPuller.ForceClearCache();
+    blockingPuller.release();
+    pullThread1.join();
+    pullThread2.join();
+
+    // The first pull returns its data, but the second request does not share it since the cache
+    // was cleared during the pull.
+    ASSERT_EQ(1, dataHolder1.size());
+    EXPECT_EQ(1, dataHolder1[0]->getValues()[0].mValue.long_value);
+    ASSERT_EQ(1, dataHolder2.size());
+    EXPECT_EQ(2, dataHolder2[0]->getValues()[0].mValue.long_value);
+
+    // The data of the second pull is cached.
+    vector<std::shared_ptr<LogEvent>> dataHolder3;
+    EXPECT_EQ(blockingPuller.Pull(eventTimeNs, &dataHolder3), PULL_SUCCESS);
+    ASSERT_EQ(1, dataHolder3.size());
+    EXPECT_EQ(dataHolder2[0], dataHolder3[0]);
+}
+
 // Test pull takes longer than timeout, 2nd pull happens at same event time
 TEST_F(StatsPullerTest, PullTakeTooLongAndPullSameEventTime) {
     pullData.push_back(createSimpleEvent(1111L, 33));
@@ -230,6 +230,32 @@ TEST(PullerUtilTest, TwoIsolatedUidsOneAtom) {
     EXPECT_EQ(hostUid2, actualFieldValues->at(3).mValue.int_value);
 }
 
+TEST(PullerUtilTest, MergeInterleavedEvents) {
+    const int numStates = 10;
+    vector<shared_ptr<LogEvent>> data;
+    for (int i = 0; i < 3 * numStates; i++) {
+        // Cycles through the uids and the states, so the rows to merge are never next to each
+        // other.
+        const int uid = vector<int>{isolatedUid1, hostUid, isolatedUid2}[i % 3];
+        data.push_back(makeUidLogEvent(uidAtomTagId, timestamp, uid, numStates - 1 - i % numStates,
+                                       /*data2=*/i));
+    }
+
+    sp<MockUidMap> uidMap = makeMockUidMap();
+    mapAndMergeIsolatedUidsToHostUid(data, uidMap, uidAtomTagId, additiveFields);
+
+    ASSERT_EQ(numStates, (int)data.size());
+    for (int state = 0; state < numStates; state++) {
+        const vector<FieldValue>* actualFieldValues = &data[state]->getValues();
+        ASSERT_EQ(3, actualFieldValues->size());
+        EXPECT_EQ(hostUid, actualFieldValues->at(0).mValue.int_value);
+        EXPECT_EQ(state, actualFieldValues->at(1).mValue.int_value);
+        // State s is reported by rows i = 9 - s, 19 - s and 29 - s.
+        EXPECT_EQ(3 * (numStates - 1 - state) + 3 * numStates,
+                  actualFieldValues->at(2).mValue.int_value);
+    }
+}
+
 TEST(PullerUtilTest, NoNeedToMerge) {
     vector<shared_ptr<LogEvent>> data = {
             // 32->31
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/guardrail/DimensionCardinalitySketch.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+
+#include "src/HashableDimensionKey.h"
+
+#ifdef __ANDROID__
+
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+
+size_t getKeyHash(int value) {
+    int pos[] = {1, 0, 0};
+    HashableDimensionKey dim;
+    dim.addValue(FieldValue(Field(10, pos, 0), Value(value)));
+    return std::hash<MetricDimensionKey>{}(MetricDimensionKey(dim, DEFAULT_DIMENSION_KEY));
+}
+
+}  // namespace
+
+TEST(DimensionCardinalitySketchTest, TestEmpty) {
+    DimensionCardinalitySketch sketch;
+    EXPECT_TRUE(sketch.empty());
+    EXPECT_EQ(0u, sketch.estimate());
+
+    sketch.add(getKeyHash(1));
+    EXPECT_FALSE(sketch.empty());
+    EXPECT_EQ(1u, sketch.estimate());
+
+    sketch.clear();
+    EXPECT_TRUE(sketch.empty());
+    EXPECT_EQ(0u, sketch.estimate());
+}
+
+TEST(DimensionCardinalitySketchTest, TestDuplicatesAreNotCounted) {
+    DimensionCardinalitySketch sketch;
+    DimensionCardinalitySketch sketchWithDuplicates;
+    for (int i = 0; i < 10; i++) {
+        sketch.add(getKeyHash(i));
+    }
+    for (int i = 0; i < 1000; i++) {
+        sketchWithDuplicates.add(getKeyHash(i % 10));
+    }
+    EXPECT_EQ(sketch.estimate(), sketchWithDuplicates.estimate());
+    EXPECT_NEAR(10, sketch.estimate(), 1);
+}
+
+TEST(DimensionCardinalitySketchTest, TestEstimateAccuracy) {
+    for (int numKeys : {100, 500, 800, 3000, 100000}) {
+        DimensionCardinalitySketch sketch;
+        for (int i = 0; i < numKeys; i++) {
+            sketch.add(getKeyHash(i));
+        }
+        // About 3 standard errors.
+        EXPECT_NEAR(numKeys, sketch.estimate(), numKeys * 0.2) << numKeys << " keys";
+    }
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -410,6 +410,9 @@ TEST(StatsdStatsTest, TestPullAtomStats) {
     stats.notePullDelay(util::DISK_SPACE, 3335L);
     stats.notePull(util::DISK_SPACE);
     stats.notePullFromCache(util::DISK_SPACE);
+    stats.notePullCoalesced(util::DISK_SPACE);
+    stats.notePullBatchingDelay(util::DISK_SPACE, 5000L);
+    stats.notePullBatchingDelay(util::DISK_SPACE, 2000L);
     stats.notePullerCallbackRegistrationChanged(util::DISK_SPACE, true);
     stats.notePullerCallbackRegistrationChanged(util::DISK_SPACE, false);
     stats.notePullerCallbackRegistrationChanged(util::DISK_SPACE, true);
@@ -426,6 +429,9 @@ TEST(StatsdStatsTest, TestPullAtomStats) {
     EXPECT_EQ(util::DISK_SPACE, report.pulled_atom_stats(0).atom_id());
     EXPECT_EQ(3, report.pulled_atom_stats(0).total_pull());
     EXPECT_EQ(1, report.pulled_atom_stats(0).total_pull_from_cache());
+    EXPECT_EQ(1, report.pulled_atom_stats(0).coalesced_pull_count());
+    EXPECT_EQ(2, report.pulled_atom_stats(0).batched_pull_count());
+    EXPECT_EQ(5000L, report.pulled_atom_stats(0).max_pull_batching_delay_ns());
     EXPECT_EQ(2222L, report.pulled_atom_stats(0).min_pull_interval_sec());
     EXPECT_EQ(2222L, report.pulled_atom_stats(0).average_pull_time_nanos());
     EXPECT_EQ(3333L, report.pulled_atom_stats(0).max_pull_time_nanos());
@@ -457,6 +463,9 @@ TEST(StatsdStatsTest, TestAtomMetricsStats) {
 
     stats.noteBucketBoundaryDelayNs(10000000001LL, 1L);
 
+    stats.noteDimensionCardinalityEstimate(10000000001LL, 2000);
+    stats.noteDimensionCardinalityEstimate(10000000001LL, 600);
+
     StatsdStatsReport report = getStatsdStatsReport(stats, /* reset stats */ false);
     ASSERT_EQ(2, report.atom_metric_stats().size());
 
@@ -471,6 +480,7 @@ TEST(StatsdStatsTest, TestAtomMetricsStats) {
     EXPECT_EQ(0L, atomStats2.bucket_dropped());
     EXPECT_EQ(0L, atomStats2.min_bucket_boundary_delay_ns());
     EXPECT_EQ(1L, atomStats2.max_bucket_boundary_delay_ns());
+    EXPECT_EQ(2000L, atomStats2.max_dimension_cardinality_estimate());
 }
 
 TEST(StatsdStatsTest, TestRestrictedMetricsStats) {
@@ -1090,6 +1100,25 @@ TEST(StatsdStatsTest, TestSocketLossStatsOverflowCounter) {
     }
 }
 
+TEST(StatsdStatsTest, TestRestrictedDbWriterStats) {
+    StatsdStats stats;
+    StatsdStatsReport report = getStatsdStatsReport(stats, /* reset stats */ false);
+    EXPECT_FALSE(report.has_restricted_db_writer_stats());
+
+    stats.noteRestrictedDbWriterQueueFull();
+    stats.noteRestrictedDbWriterQueueFull();
+    stats.noteRestrictedDbWriteQueueLatency(300);
+    stats.noteRestrictedDbWriteQueueLatency(100);
+
+    report = getStatsdStatsReport(stats, /* reset stats */ true);
+    ASSERT_TRUE(report.has_restricted_db_writer_stats());
+    EXPECT_EQ(2, report.restricted_db_writer_stats().queue_full_count());
+    EXPECT_EQ(300, report.restricted_db_writer_stats().max_queue_latency_ns());
+
+    report = getStatsdStatsReport(stats, /* reset stats */ false);
+    EXPECT_FALSE(report.has_restricted_db_writer_stats());
+}
+
 TEST_P(StatsdStatsTest_GetAtomDimensionKeySizeLimit_InMap, TestGetAtomDimensionKeySizeLimits) {
     const auto& [atomId, defaultHardLimit] = GetParam();
     EXPECT_EQ(StatsdStats::getAtomDimensionKeySizeLimits(atomId, defaultHardLimit),
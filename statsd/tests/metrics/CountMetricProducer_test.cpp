@@ -541,6 +541,50 @@ TEST(CountMetricProducerTest, TestOneWeekTimeUnit) {
     EXPECT_EQ(fiveWeeksOneDayNs, countProducer.getCurrentBucketEndTimeNs());
 }
 
+TEST(CountMetricProducerTest, TestDimensionCardinalityGuardrail) {
+    int64_t bucketStartTimeNs = 10000000000;
+    int64_t bucketSizeNs = TimeUnitToBucketSizeInMillis(ONE_MINUTE) * 1000000LL;
+    int64_t bucket2StartTimeNs = bucketStartTimeNs + bucketSizeNs;
+    int tagId = 1;
+
+    CountMetric metric;
+    metric.set_id(1);
+    metric.set_bucket(ONE_MINUTE);
+    *metric.mutable_dimensions_in_what() = CreateDimensions(tagId, {1});
+
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+
+    CountMetricProducer countProducer(kConfigKey, metric, -1 /*-1 meaning no condition*/, {},
+                                      wizard, protoHash, bucketStartTimeNs, bucketStartTimeNs);
+    const size_t hardLimit = countProducer.mDimensionHardLimit;
+
+    // Bucket 1 receives far more dimension keys than the hard limit. Keys are admitted until the
+    // hard limit is reached.
+    for (size_t i = 0; i < hardLimit * 3; i++) {
+        LogEvent event(/*uid=*/0, /*pid=*/0);
+        makeLogEvent(&event, bucketStartTimeNs + 1 + i, tagId, /*uid=*/std::to_string(i));
+        countProducer.onMatchedLogEvent(1 /*log matcher index*/, event);
+    }
+    EXPECT_EQ(hardLimit, countProducer.mCurrentSlicedCounter->size());
+    // Keys past the cardinality limit are not added to the sketch.
+    EXPECT_TRUE(countProducer.mDimensionCardinalityLimitHit);
+
+    // Flushing bucket 1 saves its estimate. Since bucket 1 exceeded the hard limit by far, new
+    // keys of bucket 2 are only admitted up to the soft limit.
+    countProducer.flushIfNeededLocked(bucket2StartTimeNs);
+    EXPECT_GT(countProducer.mLastDimensionCardinalityEstimate,
+              StatsdStats::kDimensionCardinalityOverflowFactor * hardLimit);
+    EXPECT_FALSE(countProducer.mDimensionCardinalityLimitHit);
+    for (size_t i = 0; i < hardLimit; i++) {
+        LogEvent event(/*uid=*/0, /*pid=*/0);
+        makeLogEvent(&event, bucket2StartTimeNs + 1 + i, tagId, /*uid=*/std::to_string(i));
+        countProducer.onMatchedLogEvent(1 /*log matcher index*/, event);
+    }
+    EXPECT_EQ((size_t)StatsdStats::kDimensionKeySizeSoftLimit,
+              countProducer.mCurrentSlicedCounter->size());
+    EXPECT_TRUE(countProducer.mDimensionGuardrailHit);
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -614,6 +614,72 @@ TEST(DurationMetricProducerTest, TestClearCurrentSlicedTrackerMapWhenStop) {
     EXPECT_EQ(1, durationProducer.getCurrentBucketNum());
 }
 
+TEST(DurationMetricProducerTest, TestStateResetNotifiesLinkedTrackers) {
+    int64_t bucketStartTimeNs = 10000000000;
+    int64_t bucketSizeNs = TimeUnitToBucketSizeInMillis(ONE_MINUTE) * 1000000LL;
+    int tagId = 1;
+
+    DurationMetric metric;
+    metric.set_id(1);
+    metric.set_bucket(ONE_MINUTE);
+    metric.set_aggregation_type(DurationMetric_AggregationType_SUM);
+    *metric.mutable_dimensions_in_what() = CreateDimensions(tagId, {1 /* uid */});
+    MetricStateLink* stateLink = metric.add_state_link();
+    stateLink->set_state_atom_id(UID_PROCESS_STATE_ATOM_ID);
+    *stateLink->mutable_fields_in_what() = CreateDimensions(tagId, {1 /* uid */});
+    *stateLink->mutable_fields_in_state() =
+            CreateDimensions(UID_PROCESS_STATE_ATOM_ID, {1 /* uid */});
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+    FieldMatcher dimensions = CreateDimensions(tagId, {1 /* uid */});
+
+    DurationMetricProducer durationProducer(
+            kConfigKey, metric, -1 /* no condition */, {}, -1 /*what index not needed*/,
+            1 /* start index */, 2 /* stop index */, 3 /* stop_all index */, false /*nesting*/,
+            wizard, protoHash, dimensions, bucketStartTimeNs, bucketStartTimeNs, {}, {},
+            {UID_PROCESS_STATE_ATOM_ID});
+
+    // No state tracker is registered, so the durations of uids 1, 2 and 3 start in the unknown
+    // state.
+    for (int uid = 1; uid <= 3; uid++) {
+        shared_ptr<LogEvent> startEvent =
+                CreateTwoValueLogEvent(tagId, bucketStartTimeNs + 1, uid, /*value2=*/0);
+        durationProducer.onMatchedLogEvent(1 /* start index*/, *startEvent);
+    }
+    ASSERT_EQ(3UL, durationProducer.mCurrentSlicedDurationTrackerMap.size());
+
+    // A reset moves uids 1 and 2 to the background state.
+    HashableDimensionKey uid1Key;
+    uid1Key.addValue(FieldValue(Field(UID_PROCESS_STATE_ATOM_ID, getSimpleField(1)), Value(1)));
+    HashableDimensionKey uid2Key;
+    uid2Key.addValue(FieldValue(Field(UID_PROCESS_STATE_ATOM_ID, getSimpleField(1)), Value(2)));
+    const FieldValue unknownState(Field(UID_PROCESS_STATE_ATOM_ID, getSimpleField(2)),
+                                  Value(StateTracker::kStateUnknown));
+    const int backgroundState =
+            android::app::ProcessStateEnum::PROCESS_STATE_IMPORTANT_BACKGROUND;
+    durationProducer.onStateReset(
+            bucketStartTimeNs + 11, UID_PROCESS_STATE_ATOM_ID,
+            {StateChange(uid1Key, unknownState), StateChange(uid2Key, unknownState)},
+            FieldValue(Field(UID_PROCESS_STATE_ATOM_ID, getSimpleField(2)),
+                       Value(backgroundState)));
+
+    durationProducer.flushIfNeededLocked(bucketStartTimeNs + bucketSizeNs + 1);
+    // Uids 1 and 2 have a duration in the unknown state until the reset and in the background
+    // state after it. Uid 3 stays in the unknown state.
+    ASSERT_EQ(5UL, durationProducer.mPastBuckets.size());
+    for (const auto& [key, buckets] : durationProducer.mPastBuckets) {
+        ASSERT_EQ(1UL, buckets.size());
+        const int uid = key.getDimensionKeyInWhat().getValues()[0].mValue.int_value;
+        const int state = key.getStateValuesKey().getValues()[0].mValue.int_value;
+        if (state == StateTracker::kStateUnknown) {
+            EXPECT_EQ(uid == 3 ? bucketSizeNs - 1 : 10, buckets[0].mDuration);
+        } else {
+            EXPECT_NE(3, uid);
+            EXPECT_EQ(backgroundState, state);
+            EXPECT_EQ(bucketSizeNs - 11, buckets[0].mDuration);
+        }
+    }
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -138,7 +138,8 @@ public:
         }
 
         return new KllMetricProducer(
-                kConfigKey, metric, protoHash, {/*pullAtomId=*/-1, /*pullerManager=*/nullptr},
+                kConfigKey, metric, protoHash,
+                {/*pullAtomId=*/-1, /*pullerManager=*/nullptr, StatsdStats::kPullMaxDelayNs},
                 {timeBaseNs, startTimeNs, bucketSizeNs, metric.min_bucket_size_nanos(),
                  /*conditionCorrectionThresholdNs=*/nullopt, metric.split_bucket_for_app_upgrade()},
                 {containsAnyPositionInDimensionsInWhat, shouldUseNestedDimensions,
@@ -184,7 +184,7 @@ public:
         }
         sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
         if (pullAtomId != -1) {
-            EXPECT_CALL(*pullerManager, RegisterReceiver(tagId, kConfigKey, _, _, _))
+            EXPECT_CALL(*pullerManager, RegisterReceiver(tagId, kConfigKey, _, _, _, _))
                     .WillOnce(Return());
             EXPECT_CALL(*pullerManager, UnRegisterReceiver(tagId, kConfigKey, _))
                     .WillRepeatedly(Return());
@@ -215,8 +215,12 @@ public:
                         ? optional<int64_t>(metric.condition_correction_threshold_nanos())
                         : nullopt;
 
+        const int64_t maxPullDelayNs = metric.has_max_pull_delay_sec()
+                                               ? metric.max_pull_delay_sec() * NS_PER_SEC
+                                               : StatsdStats::kPullMaxDelayNs;
+
         sp<NumericValueMetricProducer> valueProducer = new NumericValueMetricProducer(
-                kConfigKey, metric, protoHash, {pullAtomId, pullerManager},
+                kConfigKey, metric, protoHash, {pullAtomId, pullerManager, maxPullDelayNs},
                 {timeBaseNs, startTimeNs, bucketSizeNs, metric.min_bucket_size_nanos(),
                  conditionCorrectionThresholdNs, metric.split_bucket_for_app_upgrade()},
                 {containsAnyPositionInDimensionsInWhat, shouldUseNestedDimensions,
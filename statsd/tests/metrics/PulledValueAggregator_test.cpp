@@ -0,0 +1,96 @@
+// Copyright (C) 2023 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/metrics/PulledValueAggregator.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "tests/statsd_test_util.h"
+
+using std::shared_ptr;
+using std::vector;
+
+#ifdef __ANDROID__
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+
+const int tagId = 1;
+const int64_t eventTimeNs = 1000;
+
+HashableDimensionKey getUidKey(const LogEvent& event) {
+    HashableDimensionKey key;
+    key.addValue(event.getValues()[0]);
+    return key;
+}
+
+}  // namespace
+
+TEST(PulledValueAggregatorTest, TestSumsValuesPerDimension) {
+    vector<shared_ptr<LogEvent>> events;
+    events.push_back(CreateTwoValueLogEvent(tagId, eventTimeNs, 1 /*uid*/, 10));
+    events.push_back(CreateTwoValueLogEvent(tagId, eventTimeNs, 2 /*uid*/, 5));
+    events.push_back(CreateTwoValueLogEvent(tagId, eventTimeNs, 1 /*uid*/, 7));
+
+    PulledValueAggregator aggregator(1);
+    for (const auto& event : events) {
+        aggregator.addEvent(getUidKey(*event), *event, {1});
+    }
+    EXPECT_EQ(2, aggregator.getDimensionCount());
+
+    vector<vector<FieldValue>> aggregatedValues;
+    aggregator.forEachAggregatedEvent(
+            [&](LogEvent& event) { aggregatedValues.push_back(event.getValues()); });
+
+    // Dimensions are visited in the order they were first added.
+    ASSERT_EQ(2, aggregatedValues.size());
+    EXPECT_EQ(1, aggregatedValues[0][0].mValue.int_value);
+    EXPECT_EQ(INT, aggregatedValues[0][1].mValue.getType());
+    EXPECT_EQ(17, aggregatedValues[0][1].mValue.int_value);
+    EXPECT_EQ(2, aggregatedValues[1][0].mValue.int_value);
+    EXPECT_EQ(5, aggregatedValues[1][1].mValue.int_value);
+
+    // The pulled events are not modified.
+    EXPECT_EQ(10, events[0]->getValues()[1].mValue.int_value);
+}
+
+TEST(PulledValueAggregatorTest, TestSkipsMissingValueFields) {
+    vector<shared_ptr<LogEvent>> events;
+    events.push_back(CreateThreeValueLogEvent(tagId, eventTimeNs, 1 /*uid*/, 10, 100));
+    events.push_back(CreateThreeValueLogEvent(tagId, eventTimeNs, 1 /*uid*/, 20, 200));
+
+    PulledValueAggregator aggregator(2);
+    aggregator.addEvent(getUidKey(*events[0]), *events[0], {1, 2});
+    // The second value field is missing from the second event.
+    aggregator.addEvent(getUidKey(*events[1]), *events[1], {1, -1});
+
+    vector<vector<FieldValue>> aggregatedValues;
+    aggregator.forEachAggregatedEvent(
+            [&](LogEvent& event) { aggregatedValues.push_back(event.getValues()); });
+
+    ASSERT_EQ(1, aggregatedValues.size());
+    EXPECT_EQ(30, aggregatedValues[0][1].mValue.int_value);
+    EXPECT_EQ(100, aggregatedValues[0][2].mValue.int_value);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
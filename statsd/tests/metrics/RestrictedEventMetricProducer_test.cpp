@@ -217,9 +217,7 @@ TEST_F(RestrictedEventMetricProducerTest, TestRestrictedEventMetricTtlDeletesFir
     producer.onMatchedLogEvent(/*matcherIndex=*/1, *event1);
     producer.onMatchedLogEvent(/*matcherIndex=*/1, *event2);
     producer.flushRestrictedData();
-    sqlite3* dbHandle = dbutils::getDb(configKey);
-    producer.enforceRestrictedDataTtl(dbHandle, currentTimeNs + 100);
-    dbutils::closeDb(dbHandle);
+    producer.enforceRestrictedDataTtl(currentTimeNs + 100);
 
     std::stringstream query;
     query << "SELECT * FROM metric_" << metricId1;
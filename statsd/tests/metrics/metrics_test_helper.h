@@ -33,9 +33,9 @@ public:
 
 class MockStatsPullerManager : public StatsPullerManager {
 public:
-    MOCK_METHOD5(RegisterReceiver,
+    MOCK_METHOD6(RegisterReceiver,
                  void(int tagId, const ConfigKey& key, wp<PullDataReceiver> receiver,
-                      int64_t nextPulltimeNs, int64_t intervalNs));
+                      int64_t nextPulltimeNs, int64_t intervalNs, int64_t maxPullDelayNs));
     MOCK_METHOD3(UnRegisterReceiver,
                  void(int tagId, const ConfigKey& key, wp<PullDataReceiver> receiver));
     MOCK_METHOD4(Pull, bool(const int pullCode, const ConfigKey& key, const int64_t eventTimeNs,
@@ -0,0 +1,88 @@
+// Copyright (C) 2023 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/metrics/value_metric_util.h"
+
+#include <gtest/gtest.h>
+
+#ifdef __ANDROID__
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(ValueMetricUtilTest, TestComputeDiffLong) {
+    const Value base((int64_t)10);
+    const Value value((int64_t)15);
+
+    std::optional<Value> diff = computeValueDiff(value, base, ValueMetric::INCREASING, false);
+    ASSERT_TRUE(diff.has_value());
+    EXPECT_EQ(Value((int64_t)5), diff.value());
+
+    EXPECT_FALSE(computeValueDiff(base, value, ValueMetric::INCREASING, false).has_value());
+
+    diff = computeValueDiff(base, value, ValueMetric::INCREASING, true);
+    ASSERT_TRUE(diff.has_value());
+    EXPECT_EQ(base, diff.value());
+
+    diff = computeValueDiff(base, value, ValueMetric::DECREASING, false);
+    ASSERT_TRUE(diff.has_value());
+    EXPECT_EQ(Value((int64_t)5), diff.value());
+
+    diff = computeValueDiff(base, value, ValueMetric::ANY, false);
+    ASSERT_TRUE(diff.has_value());
+    EXPECT_EQ(Value((int64_t)-5), diff.value());
+}
+
+TEST(ValueMetricUtilTest, TestComputeDiffDouble) {
+    std::optional<Value> diff =
+            computeValueDiff(Value(3.5), Value(1.25), ValueMetric::INCREASING, false);
+    ASSERT_TRUE(diff.has_value());
+    EXPECT_EQ(Value(2.25), diff.value());
+}
+
+TEST(ValueMetricUtilTest, TestComputeDiffMismatchedTypes) {
+    // Falls back to the Value operators, which do not operate on different types.
+    std::optional<Value> diff =
+            computeValueDiff(Value(3.5), Value((int64_t)1), ValueMetric::ANY, false);
+    ASSERT_TRUE(diff.has_value());
+    EXPECT_EQ(UNKNOWN, diff->getType());
+}
+
+TEST(ValueMetricUtilTest, TestAggregateValue) {
+    Value sum((int64_t)1);
+    aggregateValue(Value((int64_t)2), ValueMetric::SUM, sum);
+    EXPECT_EQ(Value((int64_t)3), sum);
+
+    Value minValue(2.0);
+    aggregateValue(Value(1.5), ValueMetric::MIN, minValue);
+    EXPECT_EQ(Value(1.5), minValue);
+    aggregateValue(Value(4.0), ValueMetric::MIN, minValue);
+    EXPECT_EQ(Value(1.5), minValue);
+
+    Value maxValue((int64_t)2);
+    aggregateValue(Value((int64_t)7), ValueMetric::MAX, maxValue);
+    EXPECT_EQ(Value((int64_t)7), maxValue);
+
+    // Mismatched types are left unchanged by the Value operators.
+    Value mismatched((int64_t)2);
+    aggregateValue(Value(1.0), ValueMetric::SUM, mismatched);
+    EXPECT_EQ(Value((int64_t)2), mismatched);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
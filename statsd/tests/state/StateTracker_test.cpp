@@ -58,6 +58,20 @@ public:
     }
 };
 
+/**
+ * Mock StateListener class that records reset notifications separately.
+ */
+class TestStateResetListener : public TestStateListener {
+public:
+    int resetCount = 0;
+
+    void onStateReset(const int64_t eventTimeNs, const int32_t atomId,
+                      const std::vector<StateChange>& changes, const FieldValue& newState) {
+        resetCount++;
+        TestStateListener::onStateReset(eventTimeNs, atomId, changes, newState);
+    }
+};
+
 int getStateInt(StateManager& mgr, int atomId, const HashableDimensionKey& queryKey) {
     FieldValue output;
     mgr.getStateValue(atomId, queryKey, &output);
@@ -166,6 +180,35 @@ TEST(StateManagerTest, TestOnLogEvent) {
               getStateInt(mgr, util::SCREEN_STATE_CHANGED, queryKey));
 }
 
+TEST(StateManagerTest, TestOnLogEventAfterUnregister) {
+    sp<TestStateListener> listener1 = new TestStateListener();
+    sp<TestStateListener> listener2 = new TestStateListener();
+    StateManager mgr;
+    mgr.registerListener(util::SCREEN_STATE_CHANGED, listener1);
+    mgr.registerListener(util::BLE_SCAN_STATE_CHANGED, listener2);
+
+    // Removing a tracker keeps dispatching events to the remaining ones.
+    mgr.unregisterListener(util::BLE_SCAN_STATE_CHANGED, listener2);
+    std::unique_ptr<LogEvent> event = CreateScreenStateChangedEvent(
+            timestampNs, android::view::DisplayStateEnum::DISPLAY_STATE_ON);
+    mgr.onLogEvent(*event);
+    ASSERT_EQ(1, listener1->updates.size());
+    EXPECT_EQ(android::view::DisplayStateEnum::DISPLAY_STATE_ON, listener1->updates[0].mState);
+
+    // Events of atoms without a tracker are dropped.
+    event = CreateBleScanStateChangedEvent(timestampNs, {1000}, {"tag"},
+                                           BleScanStateChanged::ON, false, false, false);
+    mgr.onLogEvent(*event);
+    EXPECT_EQ(0, listener2->updates.size());
+
+    mgr.unregisterListener(util::SCREEN_STATE_CHANGED, listener1);
+    event = CreateScreenStateChangedEvent(timestampNs,
+                                          android::view::DisplayStateEnum::DISPLAY_STATE_OFF);
+    mgr.onLogEvent(*event);
+    EXPECT_EQ(1, listener1->updates.size());
+    EXPECT_EQ(0, mgr.getStateTrackersCount());
+}
+
 /**
  * Test registering listeners to StateTrackers
  *
@@ -332,6 +375,43 @@ TEST(StateTrackerTest, TestStateChangeReset) {
     }
 }
 
+/**
+ * Test that a reset event notifies each listener once with the changes of all
+ * primary keys.
+ */
+TEST(StateTrackerTest, TestStateResetNotifiesOnce) {
+    sp<TestStateResetListener> listener = new TestStateResetListener();
+    StateManager mgr;
+    mgr.registerListener(util::BLE_SCAN_STATE_CHANGED, listener);
+
+    std::vector<string> attributionTags = {"tag1"};
+    for (int uid : {1000, 2000, 3000}) {
+        mgr.onLogEvent(*CreateBleScanStateChangedEvent(timestampNs, {uid}, attributionTags,
+                                                       BleScanStateChanged::ON, false, false,
+                                                       false));
+    }
+    ASSERT_EQ(3, listener->updates.size());
+    EXPECT_EQ(0, listener->resetCount);
+    listener->updates.clear();
+
+    mgr.onLogEvent(*CreateBleScanStateChangedEvent(timestampNs + 1000, {1000}, attributionTags,
+                                                   BleScanStateChanged::RESET, false, false,
+                                                   false));
+    EXPECT_EQ(1, listener->resetCount);
+    ASSERT_EQ(3, listener->updates.size());
+    for (const TestStateListener::Update& update : listener->updates) {
+        EXPECT_EQ(BleScanStateChanged::OFF, update.mState);
+    }
+    listener->updates.clear();
+
+    // Nothing changes on a second reset, so the listener is not notified.
+    mgr.onLogEvent(*CreateBleScanStateChangedEvent(timestampNs + 2000, {1000}, attributionTags,
+                                                   BleScanStateChanged::RESET, false, false,
+                                                   false));
+    EXPECT_EQ(1, listener->resetCount);
+    EXPECT_EQ(0, listener->updates.size());
+}
+
 /**
  * Test StateManager's onLogEvent and StateListener's onStateChanged correctly
  * updates listener for states without primary keys.
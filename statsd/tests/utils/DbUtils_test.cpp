@@ -270,6 +270,67 @@ TEST_F(DbUtilsTest, TestInsertTwoEventsEnforceTtl) {
                 ElementsAre("atomId", "elapsedTimestampNs", "wallTimestampNs", "field_1"));
 }
 
+TEST_F(DbUtilsTest, TestInsertTwoEventsEnforceTtlOnSharedConnection) {
+    int64_t eventElapsedTimeNs = 10000000000;
+    int64_t eventWallClockNs = 50000000000;
+
+    AStatsEvent* statsEvent1 = makeAStatsEvent(tagId, eventElapsedTimeNs + 10);
+    AStatsEvent_writeString(statsEvent1, "111");
+    LogEvent logEvent1 = makeLogEvent(statsEvent1);
+    logEvent1.setLogdWallClockTimestampNs(eventWallClockNs);
+
+    AStatsEvent* statsEvent2 = makeAStatsEvent(tagId, eventElapsedTimeNs + 20);
+    AStatsEvent_writeString(statsEvent2, "222");
+    LogEvent logEvent2 = makeLogEvent(statsEvent2);
+    logEvent2.setLogdWallClockTimestampNs(eventWallClockNs + eventElapsedTimeNs);
+
+    vector<LogEvent> events{logEvent1, logEvent2};
+
+    EXPECT_TRUE(createTableIfNeeded(key, metricId, logEvent1));
+    string err;
+    EXPECT_TRUE(insert(key, metricId, events, err));
+    EXPECT_TRUE(flushTtl(key, metricId, eventWallClockNs));
+    // The statement is reused by the next enforcement.
+    EXPECT_TRUE(flushTtl(key, metricId, eventWallClockNs));
+
+    std::vector<int32_t> columnTypes;
+    std::vector<string> columnNames;
+    std::vector<std::vector<std::string>> rows;
+    string zSql = "SELECT * FROM metric_111 ORDER BY elapsedTimestampNs";
+    EXPECT_TRUE(query(key, zSql, rows, columnTypes, columnNames, err));
+
+    ASSERT_EQ(rows.size(), 1);
+    EXPECT_THAT(rows[0], ElementsAre("1", to_string(eventElapsedTimeNs + 20), _, "222"));
+}
+
+TEST_F(DbUtilsTest, TestEnforceTtlTableNotCreated) {
+    EXPECT_FALSE(flushTtl(key, metricId, /*ttlWallClockNs=*/50000000000));
+}
+
+TEST_F(DbUtilsTest, TestCreateTableIndexesWallClock) {
+    AStatsEvent* statsEvent = makeAStatsEvent(tagId, /*eventElapsedTime=*/10000000000);
+    AStatsEvent_writeString(statsEvent, "111");
+    LogEvent logEvent = makeLogEvent(statsEvent);
+    EXPECT_TRUE(createTableIfNeeded(key, metricId, logEvent));
+
+    std::vector<int32_t> columnTypes;
+    std::vector<string> columnNames;
+    std::vector<std::vector<std::string>> rows;
+    string err;
+    string zSql = "SELECT name FROM sqlite_master WHERE type = 'index'";
+    EXPECT_TRUE(query(key, zSql, rows, columnTypes, columnNames, err));
+    EXPECT_THAT(rows, ElementsAre(ElementsAre("metric_111_wallTimestampNs")));
+
+    // Time window queries search the index instead of scanning the table.
+    rows.clear();
+    columnTypes.clear();
+    columnNames.clear();
+    zSql = "EXPLAIN QUERY PLAN SELECT * FROM metric_111 WHERE wallTimestampNs >= 100";
+    EXPECT_TRUE(query(key, zSql, rows, columnTypes, columnNames, err));
+    ASSERT_EQ(rows.size(), 1);
+    EXPECT_THAT(rows[0].back(), HasSubstr("USING INDEX metric_111_wallTimestampNs"));
+}
+
 TEST_F(DbUtilsTest, TestMaliciousQuery) {
     int64_t eventElapsedTimeNs = 10000000000;
 
@@ -383,6 +444,107 @@ TEST_F(DbUtilsTest, TestEventCompatibilityTableNotCreated) {
     EXPECT_TRUE(isEventCompatible(key, metricId, logEvent));
 }
 
+TEST_F(DbUtilsTest, TestInsertBuffer) {
+    int64_t eventElapsedTimeNs = 10000000000;
+
+    RestrictedEventBuffer buffer;
+    for (int i = 0; i < 2; i++) {
+        AStatsEvent* statsEvent = makeAStatsEvent(tagId, eventElapsedTimeNs + i);
+        AStatsEvent_writeString(statsEvent, StringPrintf("test_string_%d", i).c_str());
+        AStatsEvent_writeFloat(statsEvent, 1.5 + i);
+        AStatsEvent_writeInt64(statsEvent, 3000000000 + i);
+        ASSERT_TRUE(buffer.append(makeLogEvent(statsEvent)));
+    }
+
+    EXPECT_TRUE(isEventCompatible(key, metricId, buffer));
+    EXPECT_TRUE(createTableIfNeeded(key, metricId, buffer));
+    EXPECT_TRUE(isEventCompatible(key, metricId, buffer));
+    string err;
+    EXPECT_TRUE(insert(key, metricId, buffer, err));
+
+    std::vector<int32_t> columnTypes;
+    std::vector<string> columnNames;
+    std::vector<std::vector<std::string>> rows;
+    string zSql = "SELECT * FROM metric_111 ORDER BY elapsedTimestampNs";
+    EXPECT_TRUE(query(key, zSql, rows, columnTypes, columnNames, err));
+
+    ASSERT_EQ(rows.size(), 2);
+    EXPECT_THAT(rows[0], ElementsAre("1", to_string(eventElapsedTimeNs), _, "test_string_0",
+                                     "1.5", "3000000000"));
+    EXPECT_THAT(rows[1], ElementsAre("1", to_string(eventElapsedTimeNs + 1), _, "test_string_1",
+                                     "2.5", "3000000001"));
+    EXPECT_THAT(columnTypes, ElementsAre(SQLITE_INTEGER, SQLITE_INTEGER, SQLITE_INTEGER,
+                                         SQLITE_TEXT, SQLITE_FLOAT, SQLITE_INTEGER));
+    EXPECT_THAT(columnNames, ElementsAre("atomId", "elapsedTimestampNs", "wallTimestampNs",
+                                         "field_1", "field_2", "field_3"));
+}
+
+TEST_F(DbUtilsTest, TestEventCompatibilityBufferDoesNotMatchTable) {
+    AStatsEvent* statsEvent = makeAStatsEvent(tagId, /*eventElapsedTime=*/10000000000);
+    AStatsEvent_writeString(statsEvent, "111");
+    AStatsEvent_writeInt32(statsEvent, 23);
+    LogEvent logEvent = makeLogEvent(statsEvent);
+    EXPECT_TRUE(createTableIfNeeded(key, metricId, logEvent));
+
+    AStatsEvent* statsEvent2 = makeAStatsEvent(tagId, /*eventElapsedTime=*/10000000000);
+    AStatsEvent_writeString(statsEvent2, "111");
+    AStatsEvent_writeFloat(statsEvent2, 111.0);
+    RestrictedEventBuffer buffer;
+    ASSERT_TRUE(buffer.append(makeLogEvent(statsEvent2)));
+
+    EXPECT_FALSE(isEventCompatible(key, metricId, buffer));
+}
+
+TEST_F(DbUtilsTest, TestInsertBufferMultipleStatements) {
+    int64_t eventElapsedTimeNs = 10000000000;
+
+    // More rows than a single insert statement takes, with some left over.
+    const int numEvents = 150;
+    RestrictedEventBuffer buffer;
+    for (int i = 0; i < numEvents; i++) {
+        AStatsEvent* statsEvent = makeAStatsEvent(tagId, eventElapsedTimeNs + i);
+        AStatsEvent_writeInt32(statsEvent, i);
+        AStatsEvent_writeString(statsEvent, StringPrintf("test_string_%d", i).c_str());
+        ASSERT_TRUE(buffer.append(makeLogEvent(statsEvent)));
+    }
+
+    EXPECT_TRUE(createTableIfNeeded(key, metricId, buffer));
+    string err;
+    EXPECT_TRUE(insert(key, metricId, buffer, err));
+
+    std::vector<int32_t> columnTypes;
+    std::vector<string> columnNames;
+    std::vector<std::vector<std::string>> rows;
+    string zSql = "SELECT * FROM metric_111 ORDER BY elapsedTimestampNs";
+    EXPECT_TRUE(query(key, zSql, rows, columnTypes, columnNames, err));
+
+    ASSERT_EQ(rows.size(), numEvents);
+    for (int i = 0; i < numEvents; i++) {
+        EXPECT_THAT(rows[i], ElementsAre("1", to_string(eventElapsedTimeNs + i), _, to_string(i),
+                                         StringPrintf("test_string_%d", i)));
+    }
+}
+
+TEST_F(DbUtilsTest, TestEventCompatibilityAfterTableRecreated) {
+    AStatsEvent* statsEvent = makeAStatsEvent(tagId, /*eventElapsedTime=*/10000000000);
+    AStatsEvent_writeInt32(statsEvent, 23);
+    LogEvent logEvent = makeLogEvent(statsEvent);
+
+    AStatsEvent* statsEvent2 = makeAStatsEvent(tagId, /*eventElapsedTime=*/10000000000);
+    AStatsEvent_writeString(statsEvent2, "111");
+    LogEvent logEvent2 = makeLogEvent(statsEvent2);
+
+    EXPECT_TRUE(createTableIfNeeded(key, metricId, logEvent));
+    EXPECT_TRUE(isEventCompatible(key, metricId, logEvent));
+    EXPECT_FALSE(isEventCompatible(key, metricId, logEvent2));
+
+    // The schema verified before does not apply to the new table.
+    EXPECT_TRUE(deleteTable(key, metricId));
+    EXPECT_TRUE(createTableIfNeeded(key, metricId, logEvent2));
+    EXPECT_FALSE(isEventCompatible(key, metricId, logEvent));
+    EXPECT_TRUE(isEventCompatible(key, metricId, logEvent2));
+}
+
 TEST_F(DbUtilsTest, TestUpdateDeviceInfoTable) {
     string err;
     updateDeviceInfoTable(key, err);
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/RestrictedDbWriter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __ANDROID__
+
+using namespace std;
+using testing::ElementsAre;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(RestrictedDbWriterTest, TestWritesRunInOrderOnWriterThread) {
+    RestrictedDbWriter writer(/*maxQueueSize=*/100);
+    mutex lock;
+    vector<int> written;
+    vector<thread::id> threadIds;
+    for (int i = 0; i < 50; i++) {
+        writer.push([&, i] {
+            lock_guard<mutex> lg(lock);
+            written.push_back(i);
+            threadIds.push_back(this_thread::get_id());
+        });
+    }
+    writer.waitForPendingWrites();
+
+    lock_guard<mutex> lg(lock);
+    ASSERT_EQ(50, written.size());
+    for (int i = 0; i < 50; i++) {
+        EXPECT_EQ(i, written[i]);
+        EXPECT_NE(this_thread::get_id(), threadIds[i]);
+    }
+}
+
+TEST(RestrictedDbWriterTest, TestFullQueueDropsWrites) {
+    RestrictedDbWriter writer(/*maxQueueSize=*/1);
+    promise<void> writeStarted;
+    promise<void> releaseWrite;
+    shared_future<void> released = releaseWrite.get_future().share();
+    mutex lock;
+    vector<int> written;
+    EXPECT_TRUE(writer.push([&writeStarted, released, &lock, &written] {
+        writeStarted.set_value();
+        released.wait();
+        lock_guard<mutex> lg(lock);
+        written.push_back(0);
+    }));
+    writeStarted.get_future().wait();
+    EXPECT_FALSE(writer.isFull());
+
+    // The first write is running, so this one fills the queue.
+    EXPECT_TRUE(writer.push([&lock, &written] {
+        lock_guard<mutex> lg(lock);
+        written.push_back(1);
+    }));
+    EXPECT_TRUE(writer.isFull());
+
+    // The queue is full: this write is dropped without waiting for the running one.
+    EXPECT_FALSE(writer.push([&lock, &written] {
+        lock_guard<mutex> lg(lock);
+        written.push_back(2);
+    }));
+
+    releaseWrite.set_value();
+    writer.waitForPendingWrites();
+    EXPECT_FALSE(writer.isFull());
+    lock_guard<mutex> lg(lock);
+    EXPECT_THAT(written, ElementsAre(0, 1));
+}
+
+TEST(RestrictedDbWriterTest, TestDestructorRunsQueuedWrites) {
+    int numWrites = 0;
+    {
+        RestrictedDbWriter writer(/*maxQueueSize=*/100);
+        for (int i = 0; i < 10; i++) {
+            writer.push([&numWrites] { numWrites++; });
+        }
+    }
+    EXPECT_EQ(10, numWrites);
+}
+
+TEST(RestrictedDbWriterTest, TestWaitWithoutWrites) {
+    RestrictedDbWriter writer(/*maxQueueSize=*/100);
+    writer.waitForPendingWrites();
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
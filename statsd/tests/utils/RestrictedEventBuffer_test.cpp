@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/RestrictedEventBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include "tests/statsd_test_util.h"
+
+#ifdef __ANDROID__
+
+using namespace std;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+const int32_t tagId = 1;
+
+LogEvent makeLogEvent(int64_t timestampNs, const string& str, float floatValue, int64_t longValue) {
+    AStatsEvent* statsEvent = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(statsEvent, tagId);
+    AStatsEvent_overwriteTimestamp(statsEvent, timestampNs);
+    AStatsEvent_writeString(statsEvent, str.c_str());
+    AStatsEvent_writeFloat(statsEvent, floatValue);
+    AStatsEvent_writeInt64(statsEvent, longValue);
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    parseStatsEventToLogEvent(statsEvent, &event);
+    return event;
+}
+
+string getText(const RestrictedEventBuffer& buffer, size_t column, size_t row) {
+    const RestrictedEventBuffer::Column& textColumn = buffer.getColumns()[column];
+    return string(buffer.getText(textColumn, row), buffer.getTextLength(textColumn, row));
+}
+}  // Anonymous namespace.
+
+TEST(RestrictedEventBufferTest, TestAppendEvents) {
+    RestrictedEventBuffer buffer;
+    EXPECT_TRUE(buffer.empty());
+    ASSERT_TRUE(buffer.append(makeLogEvent(1000, "first", 1.5, 10)));
+    ASSERT_TRUE(buffer.append(makeLogEvent(2000, "second", 2.5, 20)));
+
+    ASSERT_EQ(2, buffer.size());
+    EXPECT_THAT(buffer.getTableSchema(), ElementsAre("TEXT", "REAL", "INTEGER"));
+    const vector<RestrictedEventBuffer::Column>& columns = buffer.getColumns();
+    ASSERT_EQ(3, columns.size());
+    EXPECT_EQ(1, columns[0].fieldPos);
+    EXPECT_EQ(2, columns[1].fieldPos);
+    EXPECT_EQ(3, columns[2].fieldPos);
+
+    EXPECT_EQ(tagId, buffer.getAtomId(0));
+    EXPECT_EQ(1000, buffer.getElapsedTimestampNs(0));
+    EXPECT_EQ(2000, buffer.getElapsedTimestampNs(1));
+    EXPECT_EQ("first", getText(buffer, 0, 0));
+    EXPECT_EQ("second", getText(buffer, 0, 1));
+    EXPECT_THAT(columns[1].reals, ElementsAre(1.5, 2.5));
+    EXPECT_THAT(columns[2].integers, ElementsAre(10, 20));
+}
+
+TEST(RestrictedEventBufferTest, TestAppendEventWithOtherSchema) {
+    RestrictedEventBuffer buffer;
+    ASSERT_TRUE(buffer.append(makeLogEvent(1000, "first", 1.5, 10)));
+
+    AStatsEvent* statsEvent = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(statsEvent, tagId);
+    AStatsEvent_writeInt32(statsEvent, 1);
+    LogEvent event(/*uid=*/0, /*pid=*/0);
+    parseStatsEventToLogEvent(statsEvent, &event);
+
+    EXPECT_FALSE(buffer.append(event));
+    EXPECT_EQ(1, buffer.size());
+
+    // The schema is reset once the buffer is cleared.
+    buffer.clear();
+    EXPECT_TRUE(buffer.append(event));
+    EXPECT_THAT(buffer.getTableSchema(), ElementsAre("INTEGER"));
+}
+
+TEST(RestrictedEventBufferTest, TestAppendBuffer) {
+    RestrictedEventBuffer buffer;
+    ASSERT_TRUE(buffer.append(makeLogEvent(1000, "first", 1.5, 10)));
+    RestrictedEventBuffer other;
+    ASSERT_TRUE(other.append(makeLogEvent(2000, "second", 2.5, 20)));
+    ASSERT_TRUE(other.append(makeLogEvent(3000, "third", 3.5, 30)));
+
+    ASSERT_TRUE(buffer.append(other));
+    ASSERT_EQ(3, buffer.size());
+    EXPECT_EQ(3000, buffer.getElapsedTimestampNs(2));
+    EXPECT_EQ("first", getText(buffer, 0, 0));
+    EXPECT_EQ("second", getText(buffer, 0, 1));
+    EXPECT_EQ("third", getText(buffer, 0, 2));
+    EXPECT_THAT(buffer.getColumns()[2].integers, ElementsAre(10, 20, 30));
+}
+
+TEST(RestrictedEventBufferTest, TestByteSizeSmallerThanEvents) {
+    RestrictedEventBuffer buffer;
+    size_t eventsSize = 0;
+    for (int i = 0; i < 100; i++) {
+        LogEvent event = makeLogEvent(1000 + i, "string_value", 1.5, i);
+        eventsSize += getSize(event.getValues()) + sizeof(event);
+        ASSERT_TRUE(buffer.append(event));
+    }
+    EXPECT_LT(buffer.byteSize(), eventsSize);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/WorkerPool.h"
+
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifdef __ANDROID__
+
+using namespace std;
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(WorkerPoolTest, TestRunsAtMostMaxThreadsTasksConcurrently) {
+    const int maxThreads = 3;
+    const int numTasks = 10;
+    mutex lock;
+    condition_variable cv;
+    int numRunning = 0;
+    int maxRunning = 0;
+    int numDone = 0;
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    {
+        WorkerPool pool(maxThreads);
+        for (int i = 0; i < numTasks; i++) {
+            pool.run([&] {
+                {
+                    lock_guard<mutex> guard(lock);
+                    numRunning++;
+                    maxRunning = max(maxRunning, numRunning);
+                }
+                cv.notify_all();
+                released.wait();
+                lock_guard<mutex> guard(lock);
+                numRunning--;
+                numDone++;
+            });
+        }
+        {
+            // The first tasks are all blocked, so the others can only wait for a thread.
+            unique_lock<mutex> guard(lock);
+            cv.wait(guard, [&] { return numRunning == maxThreads; });
+        }
+        release.set_value();
+    }
+
+    EXPECT_EQ(maxThreads, maxRunning);
+    EXPECT_EQ(numTasks, numDone);
+}
+
+TEST(WorkerPoolTest, TestReusesThreads) {
+    mutex lock;
+    set<thread::id> threadIds;
+    WorkerPool pool(/*maxThreads=*/1);
+    for (int i = 0; i < 5; i++) {
+        promise<void> done;
+        pool.run([&] {
+            {
+                lock_guard<mutex> guard(lock);
+                threadIds.insert(this_thread::get_id());
+            }
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+
+    // The tasks ran on the one pool thread, not on a thread of their own or the caller's.
+    lock_guard<mutex> guard(lock);
+    EXPECT_EQ(1u, threadIds.size());
+    EXPECT_EQ(0u, threadIds.count(this_thread::get_id()));
+}
+
+TEST(WorkerPoolTest, TestDestructorRunsQueuedTasks) {
+    mutex lock;
+    vector<int> ran;
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    {
+        WorkerPool pool(/*maxThreads=*/1);
+        pool.run([&] { released.wait(); });
+        for (int i = 0; i < 5; i++) {
+            pool.run([&, i] {
+                lock_guard<mutex> guard(lock);
+                ran.push_back(i);
+            });
+        }
+        release.set_value();
+    }
+
+    EXPECT_EQ(vector<int>({0, 1, 2, 3, 4}), ran);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif